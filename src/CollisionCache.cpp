@@ -0,0 +1,157 @@
+#include "CollisionCache.hpp"
+
+#include <cstring>
+
+#include "io/AtomicFile.hpp"
+#include "io/ContentHash.hpp"
+#include "logging/Logger.hpp"
+
+namespace {
+
+const char CACHE_MAGIC[4] = {'T', 'B', 'V', 'H'};
+const uint32_t CACHE_VERSION = 1;
+const size_t CACHE_ALIGNMENT = 16; // Bullet's in-place BVH needs 16-byte aligned blobs
+
+// File layout: header, one entry per shape, then one serialized btOptimizedBvh per shape
+struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t bulletVersion;  // The serialized BVH is Bullet's in-memory layout,
+    uint32_t pointerSize;    // so it's only valid for the same build and architecture
+    uint32_t shapeCount;
+    uint32_t reserved;
+};
+static_assert(sizeof(CacheHeader) == 32, "BVH cache header must stay 32 bytes");
+
+} // namespace
+
+uint64_t CollisionCache::computeKey(const TMAPData& mapData, const std::vector<std::vector<uint32_t>>& shapeMeshes) {
+    if (!mapData.storage || !mapData.storage->file.isOpen()) {
+        return 0;
+    }
+    // The triangles all come from the file, the layout decides how they're grouped into BVHs
+    const MappedFile& source = mapData.storage->file;
+    uint64_t key = hashContent(source.data(), source.size());
+    std::vector<uint32_t> layout;
+    for (const auto& meshes : shapeMeshes) {
+        layout.push_back(static_cast<uint32_t>(meshes.size()));
+        layout.insert(layout.end(), meshes.begin(), meshes.end());
+    }
+    key = hashContent(layout.data(), layout.size() * sizeof(uint32_t), key);
+    // Optimizing after load reorders the triangles, so those BVHs are cached separately
+    if (mapData.loadTimeOptimizerVersion != 0) {
+        key = hashContent(&mapData.loadTimeOptimizerVersion, sizeof(mapData.loadTimeOptimizerVersion), key);
+    }
+    return key ? key : 1;
+}
+
+bool CollisionCache::open(const std::string& cachePath, uint64_t key, const std::vector<uint32_t>& shapeTriangleCounts) {
+    if (key == 0 || !file.open(cachePath, true)) {
+        return false;
+    }
+    
+    auto reject = [&](const char* reason) {
+        LOG_INFO(LogCategory::Physics, "Ignoring BVH cache " << cachePath << " (" << reason << ")");
+        file.close();
+        return false;
+    };
+    
+    if (file.size() < sizeof(CacheHeader)) {
+        return reject("truncated");
+    }
+    CacheHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION) {
+        return reject("unknown format");
+    }
+    if (header.bulletVersion != BT_BULLET_VERSION || header.pointerSize != sizeof(void*)) {
+        return reject("built by a different Bullet version");
+    }
+    if (header.key != key || header.shapeCount != shapeTriangleCounts.size()) {
+        return reject("stale");
+    }
+    
+    size_t tableEnd = sizeof(CacheHeader) + header.shapeCount * sizeof(Entry);
+    if (file.size() < tableEnd) {
+        return reject("truncated");
+    }
+    entries = reinterpret_cast<const Entry*>(file.data() + sizeof(CacheHeader));
+    entryCount = header.shapeCount;
+    for (size_t i = 0; i < entryCount; i++) {
+        const Entry& entry = entries[i];
+        if (entry.triangleCount != shapeTriangleCounts[i]) {
+            return reject("stale");
+        }
+        if (entry.size == 0) {
+            continue;
+        }
+        if (entry.offset % CACHE_ALIGNMENT != 0 || entry.offset < tableEnd ||
+            entry.offset > file.size() || entry.size > file.size() - entry.offset) {
+            return reject("damaged");
+        }
+    }
+    return true;
+}
+
+btOptimizedBvh* CollisionCache::takeShapeBvh(size_t shapeIndex) {
+    if (shapeIndex >= entryCount || entries[shapeIndex].size == 0) {
+        return nullptr;
+    }
+    const Entry& entry = entries[shapeIndex];
+    // Rebuilds the object header and node array pointers inside the blob, the nodes
+    // themselves are used straight from the mapping
+    return btOptimizedBvh::deSerializeInPlace(file.mutableData() + entry.offset, entry.size, false);
+}
+
+bool CollisionCache::write(const std::string& cachePath, uint64_t key, const std::vector<btBvhTriangleMeshShape*>& shapes) {
+    if (key == 0) {
+        return false;
+    }
+    
+    CacheHeader header = {};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.key = key;
+    header.bulletVersion = BT_BULLET_VERSION;
+    header.pointerSize = sizeof(void*);
+    header.shapeCount = static_cast<uint32_t>(shapes.size());
+    
+    std::vector<Entry> table(shapes.size());
+    size_t offset = alignFileOffset(sizeof(CacheHeader) + table.size() * sizeof(Entry), CACHE_ALIGNMENT);
+    for (size_t i = 0; i < shapes.size(); i++) {
+        btOptimizedBvh* bvh = shapes[i] ? shapes[i]->getOptimizedBvh() : nullptr;
+        table[i] = {};
+        if (!bvh) {
+            continue;
+        }
+        table[i].offset = offset;
+        table[i].size = bvh->calculateSerializeBufferSize();
+        offset = alignFileOffset(offset + table[i].size, CACHE_ALIGNMENT);
+    }
+    
+    // serializeInPlace wants an aligned buffer to build each blob in
+    std::vector<FileBlob> blobs(shapes.size(), FileBlob{nullptr, 0});
+    bool serialized = true;
+    for (size_t i = 0; i < shapes.size() && serialized; i++) {
+        if (table[i].size == 0) {
+            continue;
+        }
+        void* blob = btAlignedAlloc(table[i].size, CACHE_ALIGNMENT);
+        blobs[i] = {blob, table[i].size};
+        serialized = shapes[i]->getOptimizedBvh()->serializeInPlace(blob, table[i].size, false);
+    }
+    bool written = serialized && writeFileAtomically(cachePath, &header, sizeof(header), table.data(),
+                                                     table.size() * sizeof(Entry), blobs, CACHE_ALIGNMENT);
+    for (const FileBlob& blob : blobs) {
+        if (blob.data) {
+            btAlignedFree(const_cast<void*>(blob.data));
+        }
+    }
+    if (!written) {
+        LOG_ERROR(LogCategory::Physics, "Failed to write BVH cache " << cachePath);
+        return false;
+    }
+    LOG_INFO(LogCategory::Physics, "Wrote BVH cache " << cachePath << " (" << offset / 1024 << " KiB)");
+    return true;
+}
@@ -0,0 +1,47 @@
+#ifndef COLLISION_CACHE_HPP
+#define COLLISION_CACHE_HPP
+
+#include <btBulletDynamicsCommon.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "io/MappedFile.hpp"
+#include "tmap_parser.hpp"
+
+// Prebuilt collision BVHs stored next to a TMAP file (<map>.tmap.bvhcache).
+// The cache is keyed by a hash of the TMAP file's contents plus the Bullet build it
+// was written by, and is memory-mapped copy-on-write so Bullet can use the quantized
+// BVH nodes in place. Anything that doesn't match is ignored and rebuilt.
+class CollisionCache {
+public:
+    static std::string pathFor(const std::string& tmapPath) { return tmapPath + ".bvhcache"; }
+    
+    // Hash of everything the BVHs depend on: the map file and which of its meshes went
+    // into each shape. 0 if the map wasn't loaded from a file.
+    static uint64_t computeKey(const TMAPData& mapData, const std::vector<std::vector<uint32_t>>& shapeMeshes);
+    
+    // Map 'cachePath' and check it was built with 'key' for shapes of these triangle
+    // counts. Returns false if the file is missing, damaged or stale.
+    bool open(const std::string& cachePath, uint64_t key, const std::vector<uint32_t>& shapeTriangleCounts);
+    bool isOpen() const { return file.isOpen(); }
+    
+    // BVH for one shape, living inside the mapping. nullptr for shapes without triangles.
+    // Call once per shape, deserializing patches the mapped pages. Thread-safe across shapes.
+    btOptimizedBvh* takeShapeBvh(size_t shapeIndex);
+    
+    // Write the BVHs of freshly built shapes (nullptr for empty ones) to 'cachePath'
+    static bool write(const std::string& cachePath, uint64_t key, const std::vector<btBvhTriangleMeshShape*>& shapes);
+    
+private:
+    struct Entry {
+        uint64_t offset;
+        uint32_t size;
+        uint32_t triangleCount;
+    };
+    
+    MappedFile file;
+    const Entry* entries = nullptr;
+    size_t entryCount = 0;
+};
+
+#endif // COLLISION_CACHE_HPP
@@ -0,0 +1,22 @@
+#include "FixedStepScheduler.hpp"
+
+#include <algorithm>
+
+FixedStepScheduler::FixedStepScheduler(double tickRate, int maxTicksPerFrame)
+    : tickSeconds(1.0 / std::max(tickRate, 1.0)), maxTicksPerFrame(std::max(maxTicksPerFrame, 1)) {
+}
+
+int FixedStepScheduler::advance(double elapsedSeconds) {
+    accumulator += std::max(elapsedSeconds, 0.0);
+    
+    int ticks = static_cast<int>(accumulator / tickSeconds);
+    accumulator = std::max(accumulator - ticks * tickSeconds, 0.0);
+    if (ticks > maxTicksPerFrame) {
+        // Too far behind to catch up, run what we can and forget the rest
+        droppedTicks += static_cast<uint64_t>(ticks - maxTicksPerFrame);
+        ticks = maxTicksPerFrame;
+    }
+    
+    tickCount += static_cast<uint64_t>(ticks);
+    return ticks;
+}
@@ -0,0 +1,33 @@
+#ifndef FIXED_STEP_SCHEDULER_HPP
+#define FIXED_STEP_SCHEDULER_HPP
+
+#include <cstdint>
+
+// Turns variable frame times into a whole number of fixed simulation ticks.
+// Time that doesn't add up to a full tick carries over to the next frame and is
+// exposed as the interpolation alpha for rendering. After a hitch at most
+// maxTicksPerFrame ticks run, the rest are dropped so the game can't fall
+// further and further behind (the "spiral of death").
+class FixedStepScheduler {
+public:
+    explicit FixedStepScheduler(double tickRate = 60.0, int maxTicksPerFrame = 5);
+
+    // Add a frame's worth of real time, returns how many ticks to run now
+    int advance(double elapsedSeconds);
+
+    double getTickSeconds() const { return tickSeconds; }
+    // How far between the last tick and the next one we are, 0..1
+    float getAlpha() const { return static_cast<float>(accumulator / tickSeconds); }
+
+    uint64_t getTickCount() const { return tickCount; }
+    uint64_t getDroppedTicks() const { return droppedTicks; }
+
+private:
+    double tickSeconds;
+    int maxTicksPerFrame;
+    double accumulator = 0.0;
+    uint64_t tickCount = 0;
+    uint64_t droppedTicks = 0;
+};
+
+#endif // FIXED_STEP_SCHEDULER_HPP
@@ -0,0 +1,92 @@
+#include "LevelLoader.hpp"
+
+#include "MeshOptimizer.hpp"
+#include "ThreadPool.hpp"
+#include "graphics/render.hpp"
+#include "logging/Logger.hpp"
+
+LevelLoadJob::LevelLoadJob(const std::string& filePath, const StaticCollisionOptions& collisionOptions,
+                           bool optimizeMeshes)
+    : filePath(filePath), collisionOptions(collisionOptions), optimizeMeshes(optimizeMeshes) {
+    this->collisionOptions.cachePath = CollisionCache::pathFor(filePath);
+    background = getThreadPool().submit([this]() { runBackground(); });
+}
+
+LevelLoadJob::~LevelLoadJob() {
+    // The background half writes into this object, it has to finish first
+    waitForBackground();
+}
+
+void LevelLoadJob::waitForBackground() {
+    if (background.valid()) {
+        background.wait();
+    }
+}
+
+void LevelLoadJob::runBackground() {
+    if (!loadTMAP(filePath, mapData, &parseProgress)) {
+        stage = LevelLoadStage::Failed;
+        return;
+    }
+    
+    if (optimizeMeshes) {
+        MeshOptimizeStats stats = optimizeTMAPMeshes(mapData);
+        if (stats.meshes > 0) {
+            LOG_INFO(LogCategory::Map, "Optimized " << stats.meshes << " meshes, ACMR " << stats.acmrBefore()
+                                       << " -> " << stats.acmrAfter() << ", vertices " << stats.verticesBefore
+                                       << " -> " << stats.verticesAfter);
+        }
+    }
+    
+    stage = LevelLoadStage::Cooking;
+    cookedCollision = PhysicsManager::cookStaticMeshCollision(mapData, collisionOptions, &meshesCooked);
+    
+    stage = LevelLoadStage::Cooked;
+}
+
+float LevelLoadJob::getProgress() const {
+    // Weights are a rough split of where load time goes
+    const float PARSE_WEIGHT = 0.3f;
+    const float COOK_WEIGHT = 0.5f;
+    const float UPLOAD_WEIGHT = 0.2f;
+    
+    LevelLoadStage current = stage.load();
+    if (current == LevelLoadStage::Done) {
+        return 1.0f;
+    }
+    
+    uint32_t meshCount = parseProgress.meshCount.load();
+    if (meshCount == 0) {
+        return current == LevelLoadStage::Parsing ? 0.0f : PARSE_WEIGHT + COOK_WEIGHT;
+    }
+    
+    float parsed = static_cast<float>(parseProgress.meshesDecoded.load()) / meshCount;
+    float cooked = static_cast<float>(meshesCooked.load()) / meshCount;
+    float uploaded = current == LevelLoadStage::Finalizing ? static_cast<float>(meshesUploaded) / meshCount : 0.0f;
+    return parsed * PARSE_WEIGHT + cooked * COOK_WEIGHT + uploaded * UPLOAD_WEIGHT;
+}
+
+bool LevelLoadJob::uploadRenderMeshes(std::chrono::steady_clock::time_point deadline, uint32_t renderGroup) {
+    LevelLoadStage current = stage.load();
+    if (current == LevelLoadStage::Cooked) {
+        stage = LevelLoadStage::Finalizing;
+    } else if (current != LevelLoadStage::Finalizing) {
+        return false;
+    }
+    
+    // Always make progress, even when the budget is already spent
+    do {
+        if (meshesUploaded >= mapData.meshes.size()) {
+            return true;
+        }
+        UploadTMAPMeshRange(mapData, meshesUploaded, 1, renderGroup);
+        meshesUploaded++;
+    } while (std::chrono::steady_clock::now() < deadline);
+    
+    return meshesUploaded >= mapData.meshes.size();
+}
+
+CookedStaticCollision LevelLoadJob::takeCookedCollision() {
+    stage = LevelLoadStage::Done;
+    return std::move(cookedCollision);
+}
@@ -0,0 +1,71 @@
+#ifndef LEVEL_LOADER_HPP
+#define LEVEL_LOADER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <string>
+
+#include "tmap_parser.hpp"
+#include "PhysicsManager.hpp"
+
+enum class LevelLoadStage {
+    Parsing,    // Background: mapping and decoding the TMAP
+    Cooking,    // Background: building collision shapes
+    Cooked,     // Background work done, waiting for the main thread to finalize
+    Finalizing, // Main thread: uploading meshes a few at a time
+    Done,
+    Failed
+};
+
+// Loads one TMAP in two halves. The constructor starts parsing and collision cooking
+// on the thread pool, then the main thread calls uploadRenderMeshes each frame with a
+// deadline until it returns true, and takes the cooked collision for its physics world.
+class LevelLoadJob {
+public:
+    // The BVH cache path in collisionOptions is filled in from filePath. optimizeMeshes runs
+    // MeshOptimizer over the meshes before cooking (skipped for files that are already).
+    explicit LevelLoadJob(const std::string& filePath, const StaticCollisionOptions& collisionOptions = {},
+                          bool optimizeMeshes = false);
+    ~LevelLoadJob();
+
+    LevelLoadJob(const LevelLoadJob&) = delete;
+    LevelLoadJob& operator=(const LevelLoadJob&) = delete;
+
+    LevelLoadStage getStage() const { return stage.load(); }
+    const std::string& getFilePath() const { return filePath; }
+
+    // Rough 0..1 progress over parsing, cooking and the GPU upload
+    float getProgress() const;
+
+    // Block until the background half is done (stage Cooked or Failed)
+    void waitForBackground();
+
+    // Main thread only, once the stage is Cooked or Finalizing.
+    // Uploads render meshes (tagged with renderGroup) until 'deadline' passes,
+    // returns true once all of them are in.
+    bool uploadRenderMeshes(std::chrono::steady_clock::time_point deadline, uint32_t renderGroup = 0);
+
+    // Main thread only, after uploadRenderMeshes returned true. Marks the job Done.
+    CookedStaticCollision takeCookedCollision();
+
+    TMAPData& getMapData() { return mapData; }
+
+private:
+    std::string filePath;
+    StaticCollisionOptions collisionOptions;
+    bool optimizeMeshes;
+    std::atomic<LevelLoadStage> stage{LevelLoadStage::Parsing};
+    std::future<void> background;
+
+    TMAPData mapData;
+    TMAPLoadProgress parseProgress;
+    std::atomic<uint32_t> meshesCooked{0};
+    CookedStaticCollision cookedCollision;
+    size_t meshesUploaded = 0;
+
+    void runBackground();
+};
+
+#endif // LEVEL_LOADER_HPP
@@ -0,0 +1,481 @@
+#include "MeshOptimizer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+
+#include "ThreadPool.hpp"
+#include "profiling/Profiler.hpp"
+
+namespace {
+
+struct WeldKey {
+    Vec3 position;
+    Vec3 normal;
+    Vec2 uv;
+
+    bool operator==(const WeldKey& other) const {
+        return std::memcmp(this, &other, sizeof(WeldKey)) == 0;
+    }
+};
+
+struct WeldKeyHash {
+    size_t operator()(const WeldKey& key) const {
+        // FNV-1a over the raw bytes, bitwise-equal vertices are the only ones merged
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&key);
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < sizeof(WeldKey); i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+        return static_cast<size_t>(hash);
+    }
+};
+
+// A mesh's arrays while they're being rewritten. Normals and UVs are either one per
+// vertex or empty.
+struct MeshArrays {
+    std::vector<Vec3> positions;
+    std::vector<Vec3> normals;
+    std::vector<Vec2> uvs;
+    std::vector<uint32_t> indices;
+};
+
+MeshArrays weldArrays(const Mesh& mesh) {
+    bool hasNormals = mesh.normals.size() == mesh.vertices.size();
+    bool hasUVs = mesh.uvs.size() == mesh.vertices.size();
+
+    MeshArrays arrays;
+    std::unordered_map<WeldKey, uint32_t, WeldKeyHash> lookup;
+    lookup.reserve(mesh.vertices.size());
+    arrays.indices.reserve(mesh.triangleCount() * 3);
+
+    for (size_t i = 0; i < mesh.triangleCount() * 3; i++) {
+        WeldKey key{};
+        key.position = mesh.vertices[i];
+        if (hasNormals) key.normal = mesh.normals[i];
+        if (hasUVs) key.uv = mesh.uvs[i];
+
+        auto [it, inserted] = lookup.try_emplace(key, static_cast<uint32_t>(arrays.positions.size()));
+        if (inserted) {
+            arrays.positions.push_back(key.position);
+            if (hasNormals) arrays.normals.push_back(key.normal);
+            if (hasUVs) arrays.uvs.push_back(key.uv);
+        }
+        arrays.indices.push_back(it->second);
+    }
+    return arrays;
+}
+
+MeshArrays copyArrays(const Mesh& mesh) {
+    MeshArrays arrays;
+    arrays.positions.assign(mesh.vertices.begin(), mesh.vertices.end());
+    if (mesh.normals.size() == mesh.vertices.size()) {
+        arrays.normals.assign(mesh.normals.begin(), mesh.normals.end());
+    }
+    if (mesh.uvs.size() == mesh.vertices.size()) {
+        arrays.uvs.assign(mesh.uvs.begin(), mesh.uvs.end());
+    }
+    if (!mesh.indices16.empty()) {
+        arrays.indices.assign(mesh.indices16.begin(), mesh.indices16.end());
+    } else {
+        arrays.indices.assign(mesh.indices32.begin(), mesh.indices32.end());
+    }
+    arrays.indices.resize(arrays.indices.size() / 3 * 3);
+    return arrays;
+}
+
+void storeArrays(Mesh& mesh, const MeshArrays& arrays, TMAPStorage& storage) {
+    mesh.vertices = storage.store<Vec3>(arrays.positions.data(), arrays.positions.size());
+    mesh.normals = storage.store<Vec3>(arrays.normals.data(), arrays.normals.size());
+    mesh.uvs = storage.store<Vec2>(arrays.uvs.data(), arrays.uvs.size());
+    mesh.indices16 = {};
+    mesh.indices32 = {};
+
+    // 16-bit indices whenever every vertex fits
+    if (arrays.positions.size() <= UINT16_MAX + 1) {
+        std::vector<uint16_t> shortIndices(arrays.indices.begin(), arrays.indices.end());
+        mesh.indices16 = storage.store<uint16_t>(shortIndices.data(), shortIndices.size());
+    } else {
+        mesh.indices32 = storage.store<uint32_t>(arrays.indices.data(), arrays.indices.size());
+    }
+}
+
+// Forsyth's scoring, see "Linear-Speed Vertex Cache Optimisation". Vertices in the
+// simulated LRU cache score by position, the three just used a fixed amount (so the
+// next triangle doesn't always pick them), and vertices with few triangles left get
+// a boost so they're finished off instead of left stranded.
+const size_t FORSYTH_CACHE_SIZE = 32;
+const float FORSYTH_DECAY_POWER = 1.5f;
+const float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+const float FORSYTH_VALENCE_BOOST_SCALE = 2.0f;
+const float FORSYTH_VALENCE_BOOST_POWER = 0.5f;
+
+float forsythVertexScore(int cachePosition, uint32_t remainingTriangles) {
+    if (remainingTriangles == 0) {
+        return -1.0f;
+    }
+    float score = 0.0f;
+    if (cachePosition >= 0) {
+        if (cachePosition < 3) {
+            score = FORSYTH_LAST_TRIANGLE_SCORE;
+        } else {
+            float scaled = 1.0f - static_cast<float>(cachePosition - 3) / (FORSYTH_CACHE_SIZE - 3);
+            score = std::pow(scaled, FORSYTH_DECAY_POWER);
+        }
+    }
+    return score + FORSYTH_VALENCE_BOOST_SCALE * std::pow(static_cast<float>(remainingTriangles), -FORSYTH_VALENCE_BOOST_POWER);
+}
+
+} // namespace
+
+void MeshOptimizeStats::add(const MeshOptimizeStats& other) {
+    meshes += other.meshes;
+    triangles += other.triangles;
+    verticesBefore += other.verticesBefore;
+    verticesAfter += other.verticesAfter;
+    cacheMissesBefore += other.cacheMissesBefore;
+    cacheMissesAfter += other.cacheMissesAfter;
+    overdrawOrdered += other.overdrawOrdered;
+}
+
+size_t countVertexCacheMisses(std::span<const uint32_t> indices, size_t vertexCount, size_t cacheSize) {
+    // A vertex is in the FIFO while fewer than cacheSize misses happened since it went in
+    std::vector<size_t> insertedAt(vertexCount, 0);
+    size_t misses = 0;
+    size_t clock = cacheSize + 1;
+    for (uint32_t index : indices) {
+        if (clock - insertedAt[index] > cacheSize) {
+            insertedAt[index] = clock++;
+            misses++;
+        }
+    }
+    return misses;
+}
+
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2) {
+        return;
+    }
+
+    // Triangles using each vertex. The first remaining[v] entries of a vertex's list are
+    // the triangles not emitted yet.
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    for (uint32_t index : indices) {
+        remaining[index]++;
+    }
+    std::vector<uint32_t> adjacencyStart(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) {
+        adjacencyStart[v + 1] = adjacencyStart[v] + remaining[v];
+    }
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++) {
+        adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<int> cachePosition(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        vertexScore[v] = forsythVertexScore(-1, remaining[v]);
+    }
+    std::vector<float> triangleScore(triangleCount);
+    std::vector<char> emitted(triangleCount, 0);
+    uint32_t best = 0;
+    for (size_t t = 0; t < triangleCount; t++) {
+        triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+        if (triangleScore[t] > triangleScore[best]) {
+            best = static_cast<uint32_t>(t);
+        }
+    }
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> nextCache;
+    cache.reserve(FORSYTH_CACHE_SIZE + 3);
+    nextCache.reserve(FORSYTH_CACHE_SIZE + 3);
+    size_t scanCursor = 0;
+
+    for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+        const uint32_t* triangle = &indices[best * 3];
+        output.insert(output.end(), triangle, triangle + 3);
+        emitted[best] = 1;
+
+        // Drop the triangle from its vertices' remaining lists
+        for (int corner = 0; corner < 3; corner++) {
+            uint32_t v = triangle[corner];
+            uint32_t* list = &adjacency[adjacencyStart[v]];
+            for (uint32_t i = 0; i < remaining[v]; i++) {
+                if (list[i] == best) {
+                    list[i] = list[remaining[v] - 1];
+                    remaining[v]--;
+                    break;
+                }
+            }
+        }
+
+        // The triangle's vertices move to the front of the LRU, the rest shift back
+        nextCache.assign(triangle, triangle + 3);
+        for (uint32_t v : cache) {
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+                nextCache.push_back(v);
+            }
+        }
+
+        // Rescore everything that was or is in the cache, then its triangles. Vertices
+        // pushed past the end are out of the cache now.
+        for (size_t i = 0; i < nextCache.size(); i++) {
+            uint32_t v = nextCache[i];
+            cachePosition[v] = i < FORSYTH_CACHE_SIZE ? static_cast<int>(i) : -1;
+            vertexScore[v] = forsythVertexScore(cachePosition[v], remaining[v]);
+        }
+        float bestScore = -1.0f;
+        bool found = false;
+        for (uint32_t v : nextCache) {
+            const uint32_t* list = &adjacency[adjacencyStart[v]];
+            for (uint32_t i = 0; i < remaining[v]; i++) {
+                uint32_t t = list[i];
+                triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+                if (!found || triangleScore[t] > bestScore) {
+                    best = t;
+                    bestScore = triangleScore[t];
+                    found = true;
+                }
+            }
+        }
+        if (nextCache.size() > FORSYTH_CACHE_SIZE) {
+            nextCache.resize(FORSYTH_CACHE_SIZE);
+        }
+        std::swap(cache, nextCache);
+
+        // Nothing left around the cache, carry on from the next triangle in file order
+        if (!found) {
+            while (scanCursor < triangleCount && emitted[scanCursor]) {
+                scanCursor++;
+            }
+            best = static_cast<uint32_t>(scanCursor);
+        }
+    }
+    indices.swap(output);
+}
+
+bool optimizeOverdraw(std::vector<uint32_t>& indices, std::span<const Vec3> positions, float threshold) {
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount < 2) {
+        return false;
+    }
+
+    // Cut the order into clusters that each reach the target ACMR on their own starting
+    // from a cold cache (Tipsify's soft boundaries), so any order of whole clusters stays
+    // close to the current cache efficiency
+    size_t missesBefore = countVertexCacheMisses(indices, positions.size());
+    float targetACMR = threshold * static_cast<float>(missesBefore) / triangleCount;
+    std::vector<size_t> clusterStarts = {0};
+    {
+        std::vector<size_t> insertedAt(positions.size(), 0);
+        size_t clock = VERTEX_CACHE_SIZE + 1;
+        size_t clusterMisses = 0;
+        for (size_t t = 0; t < triangleCount; t++) {
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t v = indices[t * 3 + corner];
+                if (clock - insertedAt[v] > VERTEX_CACHE_SIZE) {
+                    insertedAt[v] = clock++;
+                    clusterMisses++;
+                }
+            }
+            size_t clusterTriangles = t + 1 - clusterStarts.back();
+            if (t + 1 < triangleCount && static_cast<float>(clusterMisses) <= targetACMR * clusterTriangles) {
+                clusterStarts.push_back(t + 1);
+                clusterMisses = 0;
+                clock += VERTEX_CACHE_SIZE + 1; // Everything cached so far is now too old
+            }
+        }
+    }
+    if (clusterStarts.size() < 2) {
+        return false;
+    }
+    clusterStarts.push_back(triangleCount);
+
+    // Area weighted centroid and normal per cluster and for the whole mesh
+    struct Cluster {
+        size_t start;
+        size_t end;
+        double centroid[3];
+        double normal[3];
+        double area;
+        float sortKey;
+    };
+    size_t clusterCount = clusterStarts.size() - 1;
+    std::vector<Cluster> clusters(clusterCount);
+    double meshCentroid[3] = {0.0, 0.0, 0.0};
+    double meshArea = 0.0;
+    for (size_t c = 0; c < clusterCount; c++) {
+        Cluster& cluster = clusters[c];
+        cluster = Cluster{clusterStarts[c], clusterStarts[c + 1], {0.0, 0.0, 0.0}, {0.0, 0.0, 0.0}, 0.0, 0.0f};
+        for (size_t t = cluster.start; t < cluster.end; t++) {
+            const Vec3& a = positions[indices[t * 3]];
+            const Vec3& b = positions[indices[t * 3 + 1]];
+            const Vec3& p = positions[indices[t * 3 + 2]];
+            double e1[3] = {b.x - a.x, b.y - a.y, b.z - a.z};
+            double e2[3] = {p.x - a.x, p.y - a.y, p.z - a.z};
+            double n[3] = {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+            double area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]) * 0.5;
+            double center[3] = {(a.x + b.x + p.x) / 3.0, (a.y + b.y + p.y) / 3.0, (a.z + b.z + p.z) / 3.0};
+            for (int axis = 0; axis < 3; axis++) {
+                cluster.centroid[axis] += center[axis] * area;
+                cluster.normal[axis] += n[axis];
+            }
+            cluster.area += area;
+        }
+        for (int axis = 0; axis < 3; axis++) {
+            meshCentroid[axis] += cluster.centroid[axis];
+        }
+        meshArea += cluster.area;
+    }
+    if (meshArea <= 0.0) {
+        return false;
+    }
+
+    // Clusters further out along their own normal are more likely to be in front
+    for (Cluster& cluster : clusters) {
+        double normalLength = std::sqrt(cluster.normal[0] * cluster.normal[0] + cluster.normal[1] * cluster.normal[1] +
+                                        cluster.normal[2] * cluster.normal[2]);
+        if (cluster.area <= 0.0 || normalLength <= 0.0) {
+            continue;
+        }
+        double key = 0.0;
+        for (int axis = 0; axis < 3; axis++) {
+            double offset = cluster.centroid[axis] / cluster.area - meshCentroid[axis] / meshArea;
+            key += offset * cluster.normal[axis] / normalLength;
+        }
+        cluster.sortKey = static_cast<float>(key);
+    }
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) {
+        return a.sortKey > b.sortKey;
+    });
+
+    std::vector<uint32_t> reordered;
+    reordered.reserve(indices.size());
+    for (const Cluster& cluster : clusters) {
+        reordered.insert(reordered.end(), indices.begin() + cluster.start * 3, indices.begin() + cluster.end * 3);
+    }
+    size_t missesAfter = countVertexCacheMisses(reordered, positions.size());
+    if (static_cast<float>(missesAfter) > static_cast<float>(missesBefore) * threshold) {
+        return false;
+    }
+    indices.swap(reordered);
+    return true;
+}
+
+std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount) {
+    std::vector<uint32_t> remap(vertexCount, UINT32_MAX);
+    uint32_t nextVertex = 0;
+    for (uint32_t& index : indices) {
+        if (remap[index] == UINT32_MAX) {
+            remap[index] = nextVertex++;
+        }
+        index = remap[index];
+    }
+    return remap;
+}
+
+void weldMesh(Mesh& mesh, TMAPStorage& storage) {
+    storeArrays(mesh, weldArrays(mesh), storage);
+}
+
+MeshOptimizeStats optimizeMesh(Mesh& mesh, TMAPStorage& storage, const MeshOptimizeOptions& options) {
+    MeshOptimizeStats stats;
+    if (mesh.triangleCount() == 0) {
+        return stats;
+    }
+    stats.meshes = 1;
+    stats.verticesBefore = mesh.vertices.size();
+
+    MeshArrays arrays;
+    if (mesh.isIndexed()) {
+        arrays = copyArrays(mesh);
+        stats.cacheMissesBefore = countVertexCacheMisses(arrays.indices, arrays.positions.size());
+    } else {
+        arrays = weldArrays(mesh);
+        stats.cacheMissesBefore = arrays.indices.size();
+    }
+    stats.triangles = arrays.indices.size() / 3;
+
+    optimizeVertexCache(arrays.indices, arrays.positions.size());
+    if (options.overdraw && optimizeOverdraw(arrays.indices, arrays.positions, options.overdrawThreshold)) {
+        stats.overdrawOrdered = 1;
+    }
+
+    // Move every attribute to its new place, unused vertices are dropped
+    std::vector<uint32_t> remap = optimizeVertexFetch(arrays.indices, arrays.positions.size());
+    size_t usedVertices = 0;
+    for (uint32_t target : remap) {
+        if (target != UINT32_MAX) {
+            usedVertices++;
+        }
+    }
+    MeshArrays fetchOrdered;
+    fetchOrdered.indices.swap(arrays.indices);
+    fetchOrdered.positions.resize(usedVertices);
+    fetchOrdered.normals.resize(arrays.normals.empty() ? 0 : usedVertices);
+    fetchOrdered.uvs.resize(arrays.uvs.empty() ? 0 : usedVertices);
+    for (size_t v = 0; v < remap.size(); v++) {
+        if (remap[v] == UINT32_MAX) {
+            continue;
+        }
+        fetchOrdered.positions[remap[v]] = arrays.positions[v];
+        if (!arrays.normals.empty()) fetchOrdered.normals[remap[v]] = arrays.normals[v];
+        if (!arrays.uvs.empty()) fetchOrdered.uvs[remap[v]] = arrays.uvs[v];
+    }
+
+    stats.verticesAfter = usedVertices;
+    stats.cacheMissesAfter = countVertexCacheMisses(fetchOrdered.indices, usedVertices);
+    storeArrays(mesh, fetchOrdered, storage);
+
+    // Levels of detail index the same vertices, renumber them to match. Their vertices
+    // are always used by the full mesh too, one that isn't means the levels are broken.
+    for (MeshLod& lod : mesh.lods) {
+        std::vector<uint32_t> lodIndices;
+        if (!lod.indices16.empty()) {
+            lodIndices.assign(lod.indices16.begin(), lod.indices16.end());
+        } else {
+            lodIndices.assign(lod.indices32.begin(), lod.indices32.end());
+        }
+        for (uint32_t& index : lodIndices) {
+            index = index < remap.size() ? remap[index] : UINT32_MAX;
+            if (index == UINT32_MAX) {
+                mesh.lods.clear();
+                return stats;
+            }
+        }
+        lod.indices16 = {};
+        lod.indices32 = {};
+        if (!mesh.indices16.empty()) {
+            std::vector<uint16_t> shortIndices(lodIndices.begin(), lodIndices.end());
+            lod.indices16 = storage.store<uint16_t>(shortIndices.data(), shortIndices.size());
+        } else {
+            lod.indices32 = storage.store<uint32_t>(lodIndices.data(), lodIndices.size());
+        }
+    }
+    return stats;
+}
+
+MeshOptimizeStats optimizeTMAPMeshes(TMAPData& mapData, const MeshOptimizeOptions& options) {
+    PROFILE_FUNCTION();
+    MeshOptimizeStats total;
+    if (!mapData.storage || (mapData.flags & TMAP_FLAG_OPTIMIZED)) {
+        return total;
+    }
+
+    std::mutex totalMutex;
+    getThreadPool().parallelFor(mapData.meshes.size(), [&](size_t i) {
+        MeshOptimizeStats stats = optimizeMesh(mapData.meshes[i], *mapData.storage, options);
+        std::lock_guard<std::mutex> lock(totalMutex);
+        total.add(stats);
+    });
+    mapData.loadTimeOptimizerVersion = MESH_OPTIMIZER_VERSION;
+    return total;
+}
@@ -0,0 +1,68 @@
+#ifndef MESH_OPTIMIZER_HPP
+#define MESH_OPTIMIZER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "tmap_parser.hpp"
+
+// Offline (tmap_convert --optimize) and load-time mesh optimization. Everything here
+// rewrites the mesh's arrays into a TMAPStorage and leaves the triangles themselves
+// unchanged, only their order and the vertex order move.
+
+// Bumped whenever the output for the same input changes, load-time results are cached by it
+const uint32_t MESH_OPTIMIZER_VERSION = 1;
+
+// FIFO size used to measure ACMR (average cache misses per triangle), about what
+// current GPUs reuse between neighbouring triangles
+const size_t VERTEX_CACHE_SIZE = 16;
+
+struct MeshOptimizeOptions {
+    bool overdraw = true;
+    // Overdraw ordering may cost cache efficiency, it's kept only if ACMR stays within this factor
+    float overdrawThreshold = 1.05f;
+};
+
+// Sums over every optimized mesh
+struct MeshOptimizeStats {
+    size_t meshes = 0;
+    size_t triangles = 0;
+    size_t verticesBefore = 0;
+    size_t verticesAfter = 0;
+    size_t cacheMissesBefore = 0; // A triangle soup misses on every vertex
+    size_t cacheMissesAfter = 0;
+    size_t overdrawOrdered = 0;   // Meshes where the overdraw order was kept
+
+    float acmrBefore() const { return triangles ? static_cast<float>(cacheMissesBefore) / triangles : 0.0f; }
+    float acmrAfter() const { return triangles ? static_cast<float>(cacheMissesAfter) / triangles : 0.0f; }
+    void add(const MeshOptimizeStats& other);
+};
+
+// Vertex cache misses drawing indices through a FIFO cache of cacheSize entries
+size_t countVertexCacheMisses(std::span<const uint32_t> indices, size_t vertexCount, size_t cacheSize = VERTEX_CACHE_SIZE);
+
+// Reorder triangles for post-transform cache hits (Forsyth's linear-speed algorithm)
+void optimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+// Reorder the clusters optimizeVertexCache leaves behind so outward facing parts of the
+// mesh come first and hide what's behind them. Returns false (indices untouched) if that
+// would push ACMR over threshold times the current order.
+bool optimizeOverdraw(std::vector<uint32_t>& indices, std::span<const Vec3> positions, float threshold);
+
+// Renumber vertices in order of first use so vertex fetch walks memory forwards.
+// Returns the old -> new map, UINT32_MAX for vertices no triangle uses.
+std::vector<uint32_t> optimizeVertexFetch(std::vector<uint32_t>& indices, size_t vertexCount);
+
+// Merge bitwise-identical vertices of an unindexed mesh into an index buffer
+void weldMesh(Mesh& mesh, TMAPStorage& storage);
+
+// Weld (if unindexed), then cache, overdraw and fetch ordering. New arrays go into storage.
+MeshOptimizeStats optimizeMesh(Mesh& mesh, TMAPStorage& storage, const MeshOptimizeOptions& options = {});
+
+// optimizeMesh over every mesh of a freshly loaded map, in parallel on the thread pool.
+// Skips files tmap_convert already optimized and marks the map as optimized after loading.
+MeshOptimizeStats optimizeTMAPMeshes(TMAPData& mapData, const MeshOptimizeOptions& options = {});
+
+#endif // MESH_OPTIMIZER_HPP
@@ -0,0 +1,290 @@
+#include "MeshSimplifier.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <queue>
+#include <unordered_map>
+
+#include "MeshOptimizer.hpp"
+
+namespace {
+
+// Sum of squared distances to a set of planes, weighted by the area they came from
+struct Quadric {
+    double a2 = 0.0, ab = 0.0, ac = 0.0, ad = 0.0;
+    double b2 = 0.0, bc = 0.0, bd = 0.0;
+    double c2 = 0.0, cd = 0.0;
+    double d2 = 0.0;
+    double weight = 0.0;
+
+    void addPlane(double a, double b, double c, double d, double planeWeight) {
+        a2 += a * a * planeWeight; ab += a * b * planeWeight; ac += a * c * planeWeight; ad += a * d * planeWeight;
+        b2 += b * b * planeWeight; bc += b * c * planeWeight; bd += b * d * planeWeight;
+        c2 += c * c * planeWeight; cd += c * d * planeWeight;
+        d2 += d * d * planeWeight;
+        weight += planeWeight;
+    }
+
+    void add(const Quadric& other) {
+        a2 += other.a2; ab += other.ab; ac += other.ac; ad += other.ad;
+        b2 += other.b2; bc += other.bc; bd += other.bd;
+        c2 += other.c2; cd += other.cd;
+        d2 += other.d2;
+        weight += other.weight;
+    }
+
+    double evaluate(const Vec3& p) const {
+        double x = p.x, y = p.y, z = p.z;
+        return a2 * x * x + b2 * y * y + c2 * z * z + 2.0 * (ab * x * y + ac * x * z + bc * y * z) +
+               2.0 * (ad * x + bd * y + cd * z) + d2;
+    }
+};
+
+// Unnormalized normal, its length is twice the triangle's area
+void triangleNormal(const Vec3& a, const Vec3& b, const Vec3& c, double out[3]) {
+    double e1[3] = {b.x - a.x, b.y - a.y, b.z - a.z};
+    double e2[3] = {c.x - a.x, c.y - a.y, c.z - a.z};
+    out[0] = e1[1] * e2[2] - e1[2] * e2[1];
+    out[1] = e1[2] * e2[0] - e1[0] * e2[2];
+    out[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+struct Collapse {
+    float error;
+    uint32_t from;
+    uint32_t to;
+    uint32_t fromVersion;
+    uint32_t toVersion;
+
+    bool operator>(const Collapse& other) const { return error > other.error; }
+};
+
+uint64_t edgeKey(uint32_t a, uint32_t b) {
+    return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+}
+
+} // namespace
+
+std::vector<uint32_t> simplifyMesh(std::span<const Vec3> positions, std::span<const uint32_t> indices,
+                                   size_t targetIndexCount, float& outError) {
+    outError = 0.0f;
+    size_t vertexCount = positions.size();
+    size_t triangleCount = indices.size() / 3;
+    std::vector<uint32_t> triangles(indices.begin(), indices.begin() + triangleCount * 3);
+    if (triangles.size() <= targetIndexCount) {
+        return triangles;
+    }
+
+    // Seam vertices: more than one vertex at the same position
+    std::vector<char> locked(vertexCount, 0);
+    {
+        std::vector<uint32_t> byPosition(vertexCount);
+        for (uint32_t v = 0; v < vertexCount; v++) {
+            byPosition[v] = v;
+        }
+        auto samePosition = [&](uint32_t a, uint32_t b) {
+            return std::memcmp(&positions[a], &positions[b], sizeof(Vec3)) == 0;
+        };
+        std::sort(byPosition.begin(), byPosition.end(), [&](uint32_t a, uint32_t b) {
+            return std::memcmp(&positions[a], &positions[b], sizeof(Vec3)) < 0;
+        });
+        for (size_t i = 1; i < vertexCount; i++) {
+            if (samePosition(byPosition[i - 1], byPosition[i])) {
+                locked[byPosition[i - 1]] = 1;
+                locked[byPosition[i]] = 1;
+            }
+        }
+    }
+
+    // Boundary and non-manifold edges pin both their vertices
+    std::unordered_map<uint64_t, uint32_t> edgeUses;
+    edgeUses.reserve(triangles.size());
+    for (size_t t = 0; t < triangleCount; t++) {
+        for (int corner = 0; corner < 3; corner++) {
+            edgeUses[edgeKey(triangles[t * 3 + corner], triangles[t * 3 + (corner + 1) % 3])]++;
+        }
+    }
+    for (const auto& [key, uses] : edgeUses) {
+        if (uses != 2) {
+            locked[key >> 32] = 1;
+            locked[key & 0xFFFFFFFFu] = 1;
+        }
+    }
+
+    std::vector<Quadric> quadrics(vertexCount);
+    std::vector<std::vector<uint32_t>> vertexTriangles(vertexCount);
+    for (size_t t = 0; t < triangleCount; t++) {
+        const uint32_t* tri = &triangles[t * 3];
+        double normal[3];
+        triangleNormal(positions[tri[0]], positions[tri[1]], positions[tri[2]], normal);
+        double length = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+        for (int corner = 0; corner < 3; corner++) {
+            vertexTriangles[tri[corner]].push_back(static_cast<uint32_t>(t));
+        }
+        if (length <= 0.0) {
+            continue;
+        }
+        double a = normal[0] / length, b = normal[1] / length, c = normal[2] / length;
+        const Vec3& p = positions[tri[0]];
+        double d = -(a * p.x + b * p.y + c * p.z);
+        for (int corner = 0; corner < 3; corner++) {
+            quadrics[tri[corner]].addPlane(a, b, c, d, length * 0.5);
+        }
+    }
+
+    std::vector<uint32_t> version(vertexCount, 0);
+    std::vector<char> removed(vertexCount, 0);
+    std::vector<char> deadTriangle(triangleCount, 0);
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+
+    // Error is the area-weighted RMS distance from the merged vertex's planes
+    auto pushCollapse = [&](uint32_t from, uint32_t to) {
+        if (locked[from] || from == to) {
+            return;
+        }
+        Quadric merged = quadrics[from];
+        merged.add(quadrics[to]);
+        double cost = std::max(merged.evaluate(positions[to]), 0.0);
+        float error = static_cast<float>(std::sqrt(cost / std::max(merged.weight, 1e-12)));
+        queue.push({error, from, to, version[from], version[to]});
+    };
+    for (const auto& [key, uses] : edgeUses) {
+        uint32_t a = static_cast<uint32_t>(key >> 32);
+        uint32_t b = static_cast<uint32_t>(key & 0xFFFFFFFFu);
+        pushCollapse(a, b);
+        pushCollapse(b, a);
+    }
+
+    // Moving 'from' onto 'to' mustn't flip or flatten any triangle that survives it
+    auto collapseKeepsOrientation = [&](uint32_t from, uint32_t to) {
+        for (uint32_t t : vertexTriangles[from]) {
+            const uint32_t* tri = &triangles[t * 3];
+            if (deadTriangle[t] || tri[0] == to || tri[1] == to || tri[2] == to) {
+                continue;
+            }
+            Vec3 moved[3];
+            for (int corner = 0; corner < 3; corner++) {
+                moved[corner] = positions[tri[corner] == from ? to : tri[corner]];
+            }
+            double before[3], after[3];
+            triangleNormal(positions[tri[0]], positions[tri[1]], positions[tri[2]], before);
+            triangleNormal(moved[0], moved[1], moved[2], after);
+            double dot = before[0] * after[0] + before[1] * after[1] + before[2] * after[2];
+            double beforeLength = std::sqrt(before[0] * before[0] + before[1] * before[1] + before[2] * before[2]);
+            double afterLength = std::sqrt(after[0] * after[0] + after[1] * after[1] + after[2] * after[2]);
+            // Folding past about 80 degrees or collapsing to a sliver both look wrong
+            if (dot <= 0.17 * beforeLength * afterLength || afterLength <= 1e-6 * beforeLength) {
+                return false;
+            }
+        }
+        return true;
+    };
+
+    size_t liveIndices = triangles.size();
+    float maxError = 0.0f;
+    while (liveIndices > targetIndexCount && !queue.empty()) {
+        Collapse collapse = queue.top();
+        queue.pop();
+        uint32_t from = collapse.from;
+        uint32_t to = collapse.to;
+        if (removed[from] || removed[to] || version[from] != collapse.fromVersion || version[to] != collapse.toVersion) {
+            continue;
+        }
+        if (!collapseKeepsOrientation(from, to)) {
+            continue;
+        }
+
+        removed[from] = 1;
+        for (uint32_t t : vertexTriangles[from]) {
+            if (deadTriangle[t]) {
+                continue;
+            }
+            uint32_t* tri = &triangles[t * 3];
+            if (tri[0] == to || tri[1] == to || tri[2] == to) {
+                deadTriangle[t] = 1;
+                liveIndices -= 3;
+                continue;
+            }
+            for (int corner = 0; corner < 3; corner++) {
+                if (tri[corner] == from) {
+                    tri[corner] = to;
+                }
+            }
+            vertexTriangles[to].push_back(t);
+        }
+        vertexTriangles[from].clear();
+        quadrics[to].add(quadrics[from]);
+        version[to]++;
+        maxError = std::max(maxError, collapse.error);
+
+        // Everything around 'to' gets fresh candidates against its new quadric
+        std::vector<uint32_t>& around = vertexTriangles[to];
+        std::erase_if(around, [&](uint32_t t) { return deadTriangle[t] != 0; });
+        std::sort(around.begin(), around.end());
+        around.erase(std::unique(around.begin(), around.end()), around.end());
+        for (uint32_t t : around) {
+            for (int corner = 0; corner < 3; corner++) {
+                uint32_t neighbour = triangles[t * 3 + corner];
+                if (neighbour != to) {
+                    pushCollapse(neighbour, to);
+                    pushCollapse(to, neighbour);
+                }
+            }
+        }
+    }
+
+    std::vector<uint32_t> result;
+    result.reserve(liveIndices);
+    for (size_t t = 0; t < triangleCount; t++) {
+        if (!deadTriangle[t]) {
+            result.insert(result.end(), &triangles[t * 3], &triangles[t * 3] + 3);
+        }
+    }
+    outError = maxError;
+    return result;
+}
+
+size_t generateMeshLods(Mesh& mesh, TMAPStorage& storage, size_t maxLods) {
+    mesh.lods.clear();
+    if (!mesh.isIndexed()) {
+        return 0;
+    }
+    std::vector<uint32_t> base;
+    if (!mesh.indices16.empty()) {
+        base.assign(mesh.indices16.begin(), mesh.indices16.end());
+    } else {
+        base.assign(mesh.indices32.begin(), mesh.indices32.end());
+    }
+
+    // Every level starts from the full mesh so its error is measured against the original
+    size_t previousCount = base.size();
+    float previousError = 0.0f;
+    for (size_t level = 0; level < maxLods; level++) {
+        size_t target = (base.size() >> (level + 1)) / 3 * 3;
+        if (target < MIN_LOD_TRIANGLES * 3) {
+            break;
+        }
+        float error;
+        std::vector<uint32_t> indices = simplifyMesh(mesh.vertices, base, target, error);
+        // Not worth the memory if it's less than a fifth smaller than the level before
+        if (indices.size() * 5 > previousCount * 4) {
+            break;
+        }
+        optimizeVertexCache(indices, mesh.vertices.size());
+
+        MeshLod lod;
+        lod.error = std::max(error, previousError);
+        if (!mesh.indices16.empty()) {
+            std::vector<uint16_t> shortIndices(indices.begin(), indices.end());
+            lod.indices16 = storage.store<uint16_t>(shortIndices.data(), shortIndices.size());
+        } else {
+            lod.indices32 = storage.store<uint32_t>(indices.data(), indices.size());
+        }
+        mesh.lods.push_back(lod);
+        previousCount = indices.size();
+        previousError = lod.error;
+    }
+    return mesh.lods.size();
+}
@@ -0,0 +1,33 @@
+#ifndef MESH_SIMPLIFIER_HPP
+#define MESH_SIMPLIFIER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "tmap_parser.hpp"
+
+// Level of detail generation with quadric error metrics (Garland & Heckbert). Vertices
+// are only ever collapsed onto a neighbour, so every level is a new index buffer into
+// the mesh's existing vertices.
+//
+// Boundary vertices and vertices sharing their position with another one (UV or normal
+// seams) never move. That keeps neighbouring meshes and texture seams from cracking, at
+// the cost of less reduction on meshes that are mostly seams.
+
+const size_t MAX_GENERATED_LODS = 3;
+// Levels stop once a mesh is this small
+const size_t MIN_LOD_TRIANGLES = 32;
+
+// Collapse vertices until at most targetIndexCount indices remain or no collapse is left
+// that keeps the surface from folding over. outError is the largest collapse error used.
+std::vector<uint32_t> simplifyMesh(std::span<const Vec3> positions, std::span<const uint32_t> indices,
+                                   size_t targetIndexCount, float& outError);
+
+// Replace mesh.lods with up to maxLods levels of half, a quarter, ... the triangles,
+// skipping levels that barely reduce anything. Unindexed meshes are left alone.
+// Returns the number of levels made.
+size_t generateMeshLods(Mesh& mesh, TMAPStorage& storage, size_t maxLods = MAX_GENERATED_LODS);
+
+#endif // MESH_SIMPLIFIER_HPP
@@ -1,6 +1,8 @@
 #include "PhysicsManager.hpp"
+#include "ThreadPool.hpp"
+#include "logging/Logger.hpp"
+#include "profiling/Profiler.hpp"
 #include <algorithm>
-#include <iostream>
 
 PhysicsManager::PhysicsManager() {
     // Set up Bullet physics world
@@ -12,7 +14,10 @@ PhysicsManager::PhysicsManager() {
     dynamicsWorld = new btDiscreteDynamicsWorld(dispatcher, broadphase, solver, collisionConfiguration);
     dynamicsWorld->setGravity(btVector3(0, GRAVITY, 0));
     
-    std::cout << "Physics: Initialized Bullet physics world" << std::endl;
+    // Per-triangle friction on merged static shapes
+    gContactAddedCallback = staticSurfaceContactAdded;
+    
+    LOG_INFO(LogCategory::Physics, "Initialized Bullet physics world");
 }
 
 PhysicsManager::~PhysicsManager() {
@@ -32,6 +37,11 @@ PhysicsManager::~PhysicsManager() {
         delete shape;
     }
     
+    // The static bodies themselves went with the rest of the world above
+    for (auto& [groupId, group] : staticGroups) {
+        destroyStaticGroupShapes(group);
+    }
+    
     delete dynamicsWorld;
     delete solver;
     delete dispatcher;
@@ -40,53 +50,400 @@ PhysicsManager::~PhysicsManager() {
 }
 
 void PhysicsManager::step(float deltaTime) {
-    // Step the simulation with substeps for stability
-    dynamicsWorld->stepSimulation(deltaTime, 10);
+    PROFILE_ZONE("PhysicsManager::step");
+    // The caller already runs at a fixed tick rate, so this is exactly one Bullet step of
+    // deltaTime. Bullet's own accumulator would add a second layer of catch-up substeps.
+    dynamicsWorld->stepSimulation(deltaTime, 1, deltaTime);
+}
+
+CookedStaticCollision::~CookedStaticCollision() {
+    release();
+}
+
+CookedStaticCollision::CookedStaticCollision(CookedStaticCollision&& other) noexcept {
+    *this = std::move(other);
+}
+
+CookedStaticCollision& CookedStaticCollision::operator=(CookedStaticCollision&& other) noexcept {
+    if (this != &other) {
+        release();
+        shapes = std::move(other.shapes);
+        surfaces = std::move(other.surfaces);
+        sequentialIndices = std::move(other.sequentialIndices);
+        storage = std::move(other.storage);
+        bvhCache = std::move(other.bvhCache);
+        mapOffset = other.mapOffset;
+        other.shapes.clear();
+    }
+    return *this;
+}
+
+void CookedStaticCollision::release() {
+    for (auto& shape : shapes) {
+        delete shape.shape;
+        delete shape.meshInterface;
+    }
+    shapes.clear();
+    bvhCache.reset();
 }
 
 void PhysicsManager::createStaticMeshCollision(const TMAPData& mapData) {
-    std::cout << "Physics: Creating static collision meshes..." << std::endl;
+    addStaticMeshCollision(cookStaticMeshCollision(mapData));
+}
+
+// Bullet's quantized BVH packs the part id of each triangle into 10 bits
+const size_t MAX_PARTS_PER_SHAPE = 1024;
+
+// Group meshes into shapes. Without merging every mesh is its own shape, otherwise the
+// meshes are split along the longest axis of their centers (at the triangle-weighted
+// median) until each group fits in a partition.
+static std::vector<std::vector<uint32_t>> partitionStaticMeshes(const TMAPData& mapData, const StaticCollisionOptions& options) {
+    std::vector<std::vector<uint32_t>> partitions;
+    std::vector<uint32_t> meshes;
+    for (uint32_t i = 0; i < mapData.meshes.size(); i++) {
+        if (mapData.meshes[i].triangleCount() == 0) {
+            continue;
+        }
+        if (options.merge) {
+            meshes.push_back(i);
+        } else {
+            partitions.push_back({i});
+        }
+    }
+    if (meshes.empty()) {
+        return partitions;
+    }
+    
+    auto center = [&](uint32_t mesh, int axis) {
+        const Mesh& m = mapData.meshes[mesh];
+        const float* boundsMin = &m.boundsMin.x;
+        const float* boundsMax = &m.boundsMax.x;
+        return boundsMin[axis] + boundsMax[axis];
+    };
     
+    std::vector<std::vector<uint32_t>> pending;
+    pending.push_back(std::move(meshes));
+    while (!pending.empty()) {
+        std::vector<uint32_t> group = std::move(pending.back());
+        pending.pop_back();
+        
+        size_t triangles = 0;
+        for (uint32_t mesh : group) {
+            triangles += mapData.meshes[mesh].triangleCount();
+        }
+        if (group.size() == 1 || (triangles <= options.maxPartitionTriangles && group.size() <= MAX_PARTS_PER_SHAPE)) {
+            partitions.push_back(std::move(group));
+            continue;
+        }
+        
+        float centerMin[3], centerMax[3];
+        for (int axis = 0; axis < 3; axis++) {
+            centerMin[axis] = centerMax[axis] = center(group[0], axis);
+            for (uint32_t mesh : group) {
+                centerMin[axis] = std::min(centerMin[axis], center(mesh, axis));
+                centerMax[axis] = std::max(centerMax[axis], center(mesh, axis));
+            }
+        }
+        int axis = 0;
+        for (int i = 1; i < 3; i++) {
+            if (centerMax[i] - centerMin[i] > centerMax[axis] - centerMin[axis]) {
+                axis = i;
+            }
+        }
+        std::sort(group.begin(), group.end(), [&](uint32_t a, uint32_t b) {
+            return center(a, axis) < center(b, axis);
+        });
+        
+        size_t split = 0;
+        size_t before = 0;
+        while (split < group.size() - 1 && before * 2 < triangles) {
+            before += mapData.meshes[group[split]].triangleCount();
+            split++;
+        }
+        split = std::max<size_t>(split, 1);
+        pending.emplace_back(group.begin(), group.begin() + split);
+        pending.emplace_back(group.begin() + split, group.end());
+    }
+    return partitions;
+}
+
+// Point Bullet straight at the TMAP vertex and index data instead of copying it into a btTriangleMesh
+static btIndexedMesh makeIndexedMesh(const Mesh& mesh, const std::vector<int>& sequentialIndices) {
+    btIndexedMesh indexedMesh;
+    indexedMesh.m_numTriangles = static_cast<int>(mesh.triangleCount());
+    indexedMesh.m_numVertices = static_cast<int>(mesh.vertices.size());
+    indexedMesh.m_vertexBase = reinterpret_cast<const unsigned char*>(mesh.vertices.data());
+    indexedMesh.m_vertexStride = sizeof(Vec3);
+    indexedMesh.m_vertexType = PHY_FLOAT;
+    if (!mesh.indices16.empty()) {
+        indexedMesh.m_triangleIndexBase = reinterpret_cast<const unsigned char*>(mesh.indices16.data());
+        indexedMesh.m_triangleIndexStride = 3 * sizeof(uint16_t);
+        indexedMesh.m_indexType = PHY_SHORT;
+    } else if (!mesh.indices32.empty()) {
+        indexedMesh.m_triangleIndexBase = reinterpret_cast<const unsigned char*>(mesh.indices32.data());
+        indexedMesh.m_triangleIndexStride = 3 * sizeof(uint32_t);
+        indexedMesh.m_indexType = PHY_INTEGER;
+    } else {
+        indexedMesh.m_triangleIndexBase = reinterpret_cast<const unsigned char*>(sequentialIndices.data());
+        indexedMesh.m_triangleIndexStride = 3 * sizeof(int);
+        indexedMesh.m_indexType = PHY_INTEGER;
+    }
+    return indexedMesh;
+}
+
+CookedStaticCollision PhysicsManager::cookStaticMeshCollision(const TMAPData& mapData, const StaticCollisionOptions& options,
+                                                              std::atomic<uint32_t>* meshesCooked) {
+    PROFILE_ZONE("PhysicsManager::cookStaticMeshCollision");
+    LOG_INFO(LogCategory::Physics, "Creating static collision meshes...");
+    
+    CookedStaticCollision cooked;
+    cooked.storage = mapData.storage;
+    cooked.mapOffset = mapData.mapOffset;
+    for (const auto& mesh : mapData.meshes) {
+        cooked.surfaces.push_back({mesh.name, mesh.material, DEFAULT_SURFACE_FRICTION});
+    }
+    
+    // Unindexed meshes are triangle soups (every 3 vertices make a triangle), so all of
+    // them can share one sequential index buffer sized for the largest one
+    size_t maxTriangles = 0;
     for (const auto& mesh : mapData.meshes) {
-        // Create a triangle mesh for this mesh
-        btTriangleMesh* triangleMesh = new btTriangleMesh();
+        if (!mesh.isIndexed()) {
+            maxTriangles = std::max(maxTriangles, mesh.triangleCount());
+        }
+        // Meshes without triangles get no shape, they're done already
+        if (mesh.triangleCount() == 0 && meshesCooked) {
+            (*meshesCooked)++;
+        }
+    }
+    cooked.sequentialIndices.resize(maxTriangles * 3);
+    for (size_t i = 0; i < cooked.sequentialIndices.size(); i++) {
+        cooked.sequentialIndices[i] = static_cast<int>(i);
+    }
+    
+    std::vector<std::vector<uint32_t>> partitions = partitionStaticMeshes(mapData, options);
+    cooked.shapes.resize(partitions.size());
+    std::vector<uint32_t> triangleCounts(partitions.size(), 0);
+    for (size_t i = 0; i < partitions.size(); i++) {
+        for (uint32_t mesh : partitions[i]) {
+            triangleCounts[i] += static_cast<uint32_t>(mapData.meshes[mesh].triangleCount());
+        }
+    }
+    
+    // Building the BVHs is most of the load time for big maps, reuse the ones from last time if they still match
+    uint64_t cacheKey = 0;
+    auto cache = std::make_shared<CollisionCache>();
+    if (!options.cachePath.empty()) {
+        cacheKey = CollisionCache::computeKey(mapData, partitions);
+        cache->open(options.cachePath, cacheKey, triangleCounts);
+    }
+    bool useCache = cache->isOpen();
+    
+    // Each BVH build only reads its own meshes, so they all run in parallel
+    getThreadPool().parallelFor(partitions.size(), [&](size_t i) {
+        CookedStaticShape& out = cooked.shapes[i];
+        out.meshIndices = std::move(partitions[i]);
+        out.triangleCount = static_cast<int>(triangleCounts[i]);
+        out.name = out.meshIndices.size() == 1 ? mapData.meshes[out.meshIndices[0]].name
+                                               : "partition " + std::to_string(i) + " (" + std::to_string(out.meshIndices.size()) + " meshes)";
         
-        // Assuming triangles (vertices come in groups of 3)
-        for (size_t i = 0; i + 2 <= mesh.vertices.size(); i += 3) {
-            btVector3 v0(mesh.vertices[i].x, mesh.vertices[i].y, mesh.vertices[i].z);
-            btVector3 v1(mesh.vertices[i+1].x, mesh.vertices[i+1].y, mesh.vertices[i+1].z);
-            btVector3 v2(mesh.vertices[i+2].x, mesh.vertices[i+2].y, mesh.vertices[i+2].z);
+        // One subpart per mesh, in meshIndices order
+        out.meshInterface = new btTriangleIndexVertexArray();
+        btVector3 aabbMin, aabbMax;
+        for (size_t part = 0; part < out.meshIndices.size(); part++) {
+            const Mesh& mesh = mapData.meshes[out.meshIndices[part]];
+            btIndexedMesh indexedMesh = makeIndexedMesh(mesh, cooked.sequentialIndices);
+            out.meshInterface->addIndexedMesh(indexedMesh, indexedMesh.m_indexType);
             
-            // Apply map offset
-            v0 += btVector3(mapData.mapOffset.x, mapData.mapOffset.y, mapData.mapOffset.z);
-            v1 += btVector3(mapData.mapOffset.x, mapData.mapOffset.y, mapData.mapOffset.z);
-            v2 += btVector3(mapData.mapOffset.x, mapData.mapOffset.y, mapData.mapOffset.z);
-            
-            triangleMesh->addTriangle(v0, v1, v2);
+            btVector3 meshMin(mesh.boundsMin.x, mesh.boundsMin.y, mesh.boundsMin.z);
+            btVector3 meshMax(mesh.boundsMax.x, mesh.boundsMax.y, mesh.boundsMax.z);
+            if (part == 0) {
+                aabbMin = meshMin;
+                aabbMax = meshMax;
+            } else {
+                aabbMin.setMin(meshMin);
+                aabbMax.setMax(meshMax);
+            }
+        }
+        // The TMAP already has the bounds, saves Bullet a pass over every triangle
+        out.meshInterface->setPremadeAabb(aabbMin, aabbMax);
+        
+        // Create a static collision shape from the triangle mesh, this is where the BVH gets built
+        btOptimizedBvh* cachedBvh = useCache ? cache->takeShapeBvh(i) : nullptr;
+        if (cachedBvh) {
+            out.shape = new btBvhTriangleMeshShape(out.meshInterface, true, false);
+            out.shape->setOptimizedBvh(cachedBvh);
+        } else {
+            out.shape = new btBvhTriangleMeshShape(out.meshInterface, true);
+        }
+        if (meshesCooked) {
+            (*meshesCooked) += static_cast<uint32_t>(out.meshIndices.size());
+        }
+    });
+    
+    if (useCache) {
+        LOG_INFO(LogCategory::Physics, "Loaded collision BVHs from " << options.cachePath);
+        cooked.bvhCache = std::move(cache);
+    } else if (cacheKey != 0) {
+        std::vector<btBvhTriangleMeshShape*> shapes;
+        for (const auto& shape : cooked.shapes) {
+            shapes.push_back(shape.shape);
         }
+        CollisionCache::write(options.cachePath, cacheKey, shapes);
+    }
+    
+    return cooked;
+}
+
+uint32_t PhysicsManager::addStaticMeshCollision(CookedStaticCollision&& cooked) {
+    uint32_t groupId = nextStaticGroupId++;
+    StaticGroup& group = staticGroups[groupId];
+    
+    // Surfaces and body infos are pointed at from the bodies, so both are sized up front
+    group.surfaces = std::move(cooked.surfaces);
+    for (auto& surface : group.surfaces) {
+        auto it = materialFriction.find(surface.material);
+        surface.friction = it != materialFriction.end() ? it->second : DEFAULT_SURFACE_FRICTION;
+    }
+    group.bodyInfos.reserve(cooked.shapes.size());
+    
+    // The map offset goes on the body transform instead of being baked into the vertices
+    btTransform transform;
+    transform.setIdentity();
+    transform.setOrigin(btVector3(cooked.mapOffset.x, cooked.mapOffset.y, cooked.mapOffset.z));
+    
+    for (auto& shape : cooked.shapes) {
+        group.shapes.push_back(shape.shape);
+        group.meshInterfaces.push_back(shape.meshInterface);
         
-        // Create a static collision shape from the triangle mesh
-        btBvhTriangleMeshShape* meshShape = new btBvhTriangleMeshShape(triangleMesh, true);
-        collisionShapes.push_back(meshShape);
+        StaticBodyInfo& info = group.bodyInfos.emplace_back();
+        bool uniformFriction = true;
+        for (uint32_t mesh : shape.meshIndices) {
+            info.partSurfaces.push_back(&group.surfaces[mesh]);
+            uniformFriction = uniformFriction && group.surfaces[mesh].friction == info.partSurfaces[0]->friction;
+        }
         
         // Create rigid body (mass = 0 means static)
-        btTransform transform;
-        transform.setIdentity();
-        
         btDefaultMotionState* motionState = new btDefaultMotionState(transform);
-        btRigidBody::btRigidBodyConstructionInfo rbInfo(0.0f, motionState, meshShape);
+        btRigidBody::btRigidBodyConstructionInfo rbInfo(0.0f, motionState, shape.shape);
         
         // Set friction for the ground
-        rbInfo.m_friction = 0.8f;
+        rbInfo.m_friction = info.partSurfaces[0]->friction;
         rbInfo.m_restitution = 0.0f; // No bounciness
         
         btRigidBody* body = new btRigidBody(rbInfo);
+        body->setUserPointer(&info);
+        if (!uniformFriction) {
+            // Mixed materials in one shape, friction gets picked per contact from the triangle's part
+            body->setCollisionFlags(body->getCollisionFlags() | btCollisionObject::CF_CUSTOM_MATERIAL_CALLBACK);
+        }
         dynamicsWorld->addRigidBody(body);
-        rigidBodies.push_back(body);
+        group.bodies.push_back(body);
         
-        std::cout << "Physics:   Added collision mesh: " << mesh.name 
-                  << " (" << mesh.vertices.size() / 3 << " triangles)" << std::endl;
+        LOG_DEBUG(LogCategory::Physics, "Added collision mesh: " << shape.name
+                                        << " (" << shape.triangleCount << " triangles)");
+    }
+    
+    // The shapes now belong to this world, along with the memory they read from
+    cooked.shapes.clear();
+    group.sequentialIndices = std::move(cooked.sequentialIndices);
+    group.storage = std::move(cooked.storage);
+    group.bvhCache = std::move(cooked.bvhCache);
+    return groupId;
+}
+
+void PhysicsManager::removeStaticMeshCollision(uint32_t groupId) {
+    auto it = staticGroups.find(groupId);
+    if (it == staticGroups.end()) {
+        return;
+    }
+    
+    StaticGroup& group = it->second;
+    for (btRigidBody* body : group.bodies) {
+        dynamicsWorld->removeRigidBody(body);
+        delete body->getMotionState();
+        delete body;
+    }
+    destroyStaticGroupShapes(group);
+    staticGroups.erase(it);
+}
+
+void PhysicsManager::destroyStaticGroupShapes(StaticGroup& group) {
+    // Mesh interfaces go after the shapes that reference them
+    for (auto shape : group.shapes) {
+        delete shape;
+    }
+    for (auto meshInterface : group.meshInterfaces) {
+        delete meshInterface;
+    }
+    group.shapes.clear();
+    group.meshInterfaces.clear();
+}
+
+void PhysicsManager::setMaterialFriction(const std::string& material, float friction) {
+    materialFriction[material] = friction;
+}
+
+const StaticSurface* PhysicsManager::findStaticSurface(const btCollisionObject* object, int partId) {
+    // Only static TMAP bodies have a user pointer
+    const StaticBodyInfo* info = static_cast<const StaticBodyInfo*>(object->getUserPointer());
+    if (!info || partId < 0 || partId >= static_cast<int>(info->partSurfaces.size())) {
+        return nullptr;
+    }
+    return info->partSurfaces[partId];
+}
+
+bool PhysicsManager::staticSurfaceContactAdded(btManifoldPoint& point,
+                                               const btCollisionObjectWrapper* object0, int partId0, int /*index0*/,
+                                               const btCollisionObjectWrapper* object1, int partId1, int /*index1*/) {
+    auto friction = [](const btCollisionObjectWrapper* wrapper, int partId) {
+        const btCollisionObject* object = wrapper->getCollisionObject();
+        if (object->getCollisionFlags() & btCollisionObject::CF_CUSTOM_MATERIAL_CALLBACK) {
+            if (const StaticSurface* surface = findStaticSurface(object, partId)) {
+                return surface->friction;
+            }
+        }
+        return object->getFriction();
+    };
+    
+    // Same combine rule and clamp Bullet uses by default
+    const btScalar MAX_FRICTION = 10.0f;
+    point.m_combinedFriction = std::clamp(friction(object0, partId0) * friction(object1, partId1), -MAX_FRICTION, MAX_FRICTION);
+    return true;
+}
+
+namespace {
+
+// Closest ray hit that also remembers which triangle of a triangle mesh was hit
+struct SurfaceRayCallback : public btCollisionWorld::ClosestRayResultCallback {
+    int partId = -1;
+    int triangleIndex = -1;
+    
+    SurfaceRayCallback(const btVector3& from, const btVector3& to) : ClosestRayResultCallback(from, to) {}
+    
+    btScalar addSingleResult(btCollisionWorld::LocalRayResult& rayResult, bool normalInWorldSpace) override {
+        partId = rayResult.m_localShapeInfo ? rayResult.m_localShapeInfo->m_shapePart : -1;
+        triangleIndex = rayResult.m_localShapeInfo ? rayResult.m_localShapeInfo->m_triangleIndex : -1;
+        return ClosestRayResultCallback::addSingleResult(rayResult, normalInWorldSpace);
+    }
+};
+
+} // namespace
+
+bool PhysicsManager::raycastSurface(const glm::vec3& from, const glm::vec3& to, SurfaceHit& hit) const {
+    btVector3 start = glmToBt(from);
+    btVector3 end = glmToBt(to);
+    SurfaceRayCallback rayCallback(start, end);
+    dynamicsWorld->rayTest(start, end, rayCallback);
+    if (!rayCallback.hasHit()) {
+        return false;
     }
+    
+    hit.point = btToGlm(rayCallback.m_hitPointWorld);
+    hit.normal = btToGlm(rayCallback.m_hitNormalWorld);
+    hit.distance = (rayCallback.m_hitPointWorld - start).length();
+    hit.surface = findStaticSurface(rayCallback.m_collisionObject, rayCallback.partId);
+    hit.triangleIndex = hit.surface ? rayCallback.triangleIndex : -1;
+    return true;
 }
 
 btRigidBody* PhysicsManager::createPlayerCapsule(const glm::vec3& position, float radius, float height) {
@@ -117,8 +474,8 @@ btRigidBody* PhysicsManager::createPlayerCapsule(const glm::vec3& position, floa
     dynamicsWorld->addRigidBody(body);
     rigidBodies.push_back(body);
     
-    std::cout << "Physics: Created player capsule at (" 
-              << position.x << ", " << position.y << ", " << position.z << ")" << std::endl;
+    LOG_INFO(LogCategory::Physics, "Created player capsule at ("
+                                   << position.x << ", " << position.y << ", " << position.z << ")");
     
     return body;
 }
@@ -3,11 +3,71 @@
 
 #include <btBulletDynamicsCommon.h>
 #include <glm/glm.hpp>
+#include <memory>
+#include <string>
+#include <unordered_map>
 #include <vector>
+#include "CollisionCache.hpp"
 #include "tmap_parser.hpp"
 
 static float GRAVITY = -9.81f; // -9.81 m/s² is the gravity of Earth (May change later if the game feels better with different gravity)
 
+const float DEFAULT_SURFACE_FRICTION = 0.8f;
+
+// How cookStaticMeshCollision turns TMAP meshes into collision shapes
+struct StaticCollisionOptions {
+    // Merge the meshes into a few spatially partitioned shapes instead of one shape and
+    // static body per mesh, keeps the broadphase small on maps with lots of small meshes
+    bool merge = true;
+    size_t maxPartitionTriangles = 65536; // Partitions are split until they're under this
+    std::string cachePath;                // BVH cache to read and refresh, empty for none
+};
+
+// What a static triangle belongs to, for friction and surface queries
+struct StaticSurface {
+    std::string meshName;
+    std::string material;
+    float friction = DEFAULT_SURFACE_FRICTION;
+};
+
+struct SurfaceHit {
+    glm::vec3 point;
+    glm::vec3 normal;
+    float distance = 0.0f;
+    const StaticSurface* surface = nullptr; // nullptr when something other than map geometry was hit
+    int triangleIndex = -1;                 // Within the surface's mesh
+};
+
+// One static collision shape. Each TMAP mesh in it is a subpart of the mesh interface,
+// so the partId Bullet reports for a triangle indexes meshIndices.
+struct CookedStaticShape {
+    std::string name;
+    btTriangleIndexVertexArray* meshInterface = nullptr;
+    btBvhTriangleMeshShape* shape = nullptr;
+    std::vector<uint32_t> meshIndices;
+    int triangleCount = 0;
+};
+
+// Static collision shapes (with their BVHs) for one TMAP, built by cookStaticMeshCollision
+// without touching any dynamics world. Frees everything it still owns if it's never added.
+struct CookedStaticCollision {
+    std::vector<CookedStaticShape> shapes;
+    std::vector<StaticSurface> surfaces;  // Same order as TMAPData::meshes
+    std::vector<int> sequentialIndices;   // Shared index buffer for the unindexed meshes
+    std::shared_ptr<const TMAPStorage> storage;
+    std::shared_ptr<CollisionCache> bvhCache; // Mapping the BVHs live in, when they came from the cache
+    Vec3 mapOffset{0.0f, 0.0f, 0.0f};
+
+    CookedStaticCollision() = default;
+    ~CookedStaticCollision();
+    CookedStaticCollision(CookedStaticCollision&& other) noexcept;
+    CookedStaticCollision& operator=(CookedStaticCollision&& other) noexcept;
+    CookedStaticCollision(const CookedStaticCollision&) = delete;
+    CookedStaticCollision& operator=(const CookedStaticCollision&) = delete;
+
+    void release();
+};
+
 class PhysicsManager {
 private:
     btDiscreteDynamicsWorld* dynamicsWorld;
@@ -19,16 +79,65 @@ private:
     std::vector<btCollisionShape*> collisionShapes;
     std::vector<btRigidBody*> rigidBodies;
     
+    // Static TMAP bodies carry one of these in their user pointer, indexed by partId
+    struct StaticBodyInfo {
+        std::vector<const StaticSurface*> partSurfaces;
+    };
+    
+    // Static collision added by one addStaticMeshCollision call, removable as a unit.
+    // The meshes reference TMAP vertex memory directly, so the storage is kept alive here.
+    struct StaticGroup {
+        std::vector<btRigidBody*> bodies;
+        std::vector<btCollisionShape*> shapes;
+        std::vector<btStridingMeshInterface*> meshInterfaces;
+        std::vector<int> sequentialIndices;
+        std::shared_ptr<const TMAPStorage> storage;
+        std::shared_ptr<CollisionCache> bvhCache;
+        std::vector<StaticSurface> surfaces;
+        std::vector<StaticBodyInfo> bodyInfos;
+    };
+    std::unordered_map<uint32_t, StaticGroup> staticGroups;
+    uint32_t nextStaticGroupId = 1;
+    std::unordered_map<std::string, float> materialFriction;
+    
+    void destroyStaticGroupShapes(StaticGroup& group);
+    
+    static bool staticSurfaceContactAdded(btManifoldPoint& point,
+                                          const btCollisionObjectWrapper* object0, int partId0, int index0,
+                                          const btCollisionObjectWrapper* object1, int partId1, int index1);
+    static const StaticSurface* findStaticSurface(const btCollisionObject* object, int partId);
+    
 public:
     PhysicsManager();
     ~PhysicsManager();
     
-    // Update physics simulation
+    // Advance the simulation by exactly one fixed step of deltaTime
     void step(float deltaTime);
     
     // Create static collision mesh from TMAP data
     void createStaticMeshCollision(const TMAPData& mapData);
     
+    // Build the collision shapes and BVHs for a TMAP on the thread pool, one mesh per job.
+    // Doesn't touch any PhysicsManager, so it can run on a loader thread.
+    // meshesCooked (optional) is bumped as each mesh finishes, for progress reporting.
+    // With a cachePath the BVHs are mapped from there if it matches the map, otherwise
+    // they're built and the cache is rewritten.
+    static CookedStaticCollision cookStaticMeshCollision(const TMAPData& mapData, const StaticCollisionOptions& options = {},
+                                                         std::atomic<uint32_t>* meshesCooked = nullptr);
+    
+    // Insert previously cooked shapes into this world as static bodies (main thread).
+    // Returns a group id that removeStaticMeshCollision takes to remove them again.
+    uint32_t addStaticMeshCollision(CookedStaticCollision&& cooked);
+    
+    // Remove one group of static bodies without touching the rest of the world
+    void removeStaticMeshCollision(uint32_t groupId);
+    
+    // Friction for static geometry using 'material', applies to collision added after this
+    void setMaterialFriction(const std::string& material, float friction);
+    
+    // Closest hit along a ray, with the mesh and material of the triangle that was hit
+    bool raycastSurface(const glm::vec3& from, const glm::vec3& to, SurfaceHit& hit) const;
+    
     // Create player capsule
     btRigidBody* createPlayerCapsule(const glm::vec3& position, float radius, float height);
 
@@ -0,0 +1,194 @@
+#include "SpatialIndex.hpp"
+
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+float boxDistanceSquared(const glm::vec3& point, const glm::vec3& boundsMin, const glm::vec3& boundsMax) {
+    glm::vec3 closest = glm::min(glm::max(point, boundsMin), boundsMax);
+    glm::vec3 offset = point - closest;
+    return glm::dot(offset, offset);
+}
+
+// Slab test, entry distance in outEntry (0 when the ray starts inside)
+bool rayHitsBox(const glm::vec3& origin, const glm::vec3& inverseDirection, float maxDistance,
+                const glm::vec3& boundsMin, const glm::vec3& boundsMax, float& outEntry) {
+    glm::vec3 t0 = (boundsMin - origin) * inverseDirection;
+    glm::vec3 t1 = (boundsMax - origin) * inverseDirection;
+    glm::vec3 tNear = glm::min(t0, t1);
+    glm::vec3 tFar = glm::max(t0, t1);
+    float entry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+    float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+    outEntry = entry;
+    return entry <= exit;
+}
+
+} // namespace
+
+void SpatialIndex::build(const std::vector<BoundingVolume>& volumes) {
+    clear();
+    if (volumes.empty()) {
+        return;
+    }
+    items.reserve(volumes.size());
+    for (size_t i = 0; i < volumes.size(); i++) {
+        items.push_back({volumes[i], static_cast<uint32_t>(i)});
+    }
+    // A binary tree with leaves of at least MAX_LEAF_ITEMS / 2 items stays under this
+    nodes.reserve(2 * volumes.size() / (MAX_LEAF_ITEMS / 2) + 1);
+    buildNode(0, static_cast<uint32_t>(items.size()));
+}
+
+void SpatialIndex::clear() {
+    nodes.clear();
+    items.clear();
+}
+
+uint32_t SpatialIndex::buildNode(uint32_t itemStart, uint32_t itemCount) {
+    uint32_t nodeIndex = static_cast<uint32_t>(nodes.size());
+    nodes.push_back({});
+
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(-std::numeric_limits<float>::max());
+    glm::vec3 centerMin = boundsMin;
+    glm::vec3 centerMax = boundsMax;
+    for (uint32_t i = itemStart; i < itemStart + itemCount; i++) {
+        const BoundingVolume& volume = items[i].volume;
+        boundsMin = glm::min(boundsMin, volume.center - volume.extents);
+        boundsMax = glm::max(boundsMax, volume.center + volume.extents);
+        centerMin = glm::min(centerMin, volume.center);
+        centerMax = glm::max(centerMax, volume.center);
+    }
+
+    Node node;
+    node.boundsMin = boundsMin;
+    node.boundsMax = boundsMax;
+    node.itemStart = itemStart;
+    node.itemCount = itemCount;
+    node.rightChild = 0;
+
+    if (itemCount > MAX_LEAF_ITEMS) {
+        // Median split on the axis the item centers are most spread along
+        glm::vec3 spread = centerMax - centerMin;
+        int axis = spread.x >= spread.y && spread.x >= spread.z ? 0 : (spread.y >= spread.z ? 1 : 2);
+        uint32_t half = itemCount / 2;
+        auto first = items.begin() + itemStart;
+        std::nth_element(first, first + half, first + itemCount, [axis](const Item& a, const Item& b) {
+            return a.volume.center[axis] < b.volume.center[axis];
+        });
+
+        buildNode(itemStart, half);
+        node.rightChild = buildNode(itemStart + half, itemCount - half);
+    }
+    nodes[nodeIndex] = node;
+    return nodeIndex;
+}
+
+void SpatialIndex::queryFrustum(const Frustum& frustum, std::vector<uint32_t>& outIds) const {
+    if (nodes.empty()) {
+        return;
+    }
+
+    struct Entry {
+        uint32_t node;
+        uint8_t planeMask;
+    };
+    Entry stack[64];
+    int stackSize = 0;
+    stack[stackSize++] = {0, Frustum::ALL_PLANES};
+    while (stackSize > 0) {
+        Entry entry = stack[--stackSize];
+        const Node& node = nodes[entry.node];
+        glm::vec3 center = (node.boundsMin + node.boundsMax) * 0.5f;
+        glm::vec3 extents = (node.boundsMax - node.boundsMin) * 0.5f;
+        uint8_t planeMask = entry.planeMask;
+        FrustumOverlap overlap = frustum.classify(center, extents, planeMask);
+        if (overlap == FrustumOverlap::Outside) {
+            continue;
+        }
+
+        if (overlap == FrustumOverlap::Inside) {
+            // Whole subtree is visible, no more tests needed
+            for (uint32_t i = node.itemStart; i < node.itemStart + node.itemCount; i++) {
+                outIds.push_back(items[i].id);
+            }
+        } else if (node.rightChild == 0) {
+            for (uint32_t i = node.itemStart; i < node.itemStart + node.itemCount; i++) {
+                if (frustum.isVisible(items[i].volume)) {
+                    outIds.push_back(items[i].id);
+                }
+            }
+        } else {
+            // Median splits keep the depth around log2(n / MAX_LEAF_ITEMS), far below 64
+            stack[stackSize++] = {node.rightChild, planeMask};
+            stack[stackSize++] = {entry.node + 1, planeMask};
+        }
+    }
+}
+
+void SpatialIndex::querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& outIds) const {
+    if (nodes.empty()) {
+        return;
+    }
+
+    float radiusSquared = radius * radius;
+    uint32_t stack[64];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        uint32_t nodeIndex = stack[--stackSize];
+        const Node& node = nodes[nodeIndex];
+        if (boxDistanceSquared(center, node.boundsMin, node.boundsMax) > radiusSquared) {
+            continue;
+        }
+        if (node.rightChild != 0) {
+            stack[stackSize++] = node.rightChild;
+            stack[stackSize++] = nodeIndex + 1;
+            continue;
+        }
+        for (uint32_t i = node.itemStart; i < node.itemStart + node.itemCount; i++) {
+            const BoundingVolume& volume = items[i].volume;
+            if (boxDistanceSquared(center, volume.center - volume.extents, volume.center + volume.extents) <= radiusSquared) {
+                outIds.push_back(items[i].id);
+            }
+        }
+    }
+}
+
+void SpatialIndex::queryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+                            std::vector<SpatialRayHit>& outHits) const {
+    if (nodes.empty()) {
+        return;
+    }
+
+    // Division by zero gives infinities, which the slab test handles
+    glm::vec3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+    size_t firstHit = outHits.size();
+    uint32_t stack[64];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+    while (stackSize > 0) {
+        uint32_t nodeIndex = stack[--stackSize];
+        const Node& node = nodes[nodeIndex];
+        float entry;
+        if (!rayHitsBox(origin, inverseDirection, maxDistance, node.boundsMin, node.boundsMax, entry)) {
+            continue;
+        }
+        if (node.rightChild != 0) {
+            stack[stackSize++] = node.rightChild;
+            stack[stackSize++] = nodeIndex + 1;
+            continue;
+        }
+        for (uint32_t i = node.itemStart; i < node.itemStart + node.itemCount; i++) {
+            const BoundingVolume& volume = items[i].volume;
+            if (rayHitsBox(origin, inverseDirection, maxDistance, volume.center - volume.extents,
+                           volume.center + volume.extents, entry)) {
+                outHits.push_back({items[i].id, entry});
+            }
+        }
+    }
+    std::sort(outHits.begin() + firstHit, outHits.end(), [](const SpatialRayHit& a, const SpatialRayHit& b) {
+        return a.distance < b.distance;
+    });
+}
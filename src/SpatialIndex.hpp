@@ -0,0 +1,60 @@
+#ifndef SPATIAL_INDEX_HPP
+#define SPATIAL_INDEX_HPP
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "graphics/Frustum.hpp"
+
+struct SpatialRayHit {
+    uint32_t id;
+    float distance; // Where the ray enters the item's box
+};
+
+// Static bounding volume hierarchy over world items (meshes), built once per level.
+// Answers frustum, sphere and ray queries in roughly log time instead of a linear scan.
+// Items are identified by their position in the vector passed to build.
+class SpatialIndex {
+public:
+    static const uint32_t MAX_LEAF_ITEMS = 4;
+
+    void build(const std::vector<BoundingVolume>& volumes);
+    void clear();
+    bool empty() const { return nodes.empty(); }
+    size_t size() const { return items.size(); }
+    size_t getNodeCount() const { return nodes.size(); }
+
+    // Same result as Frustum::cull over the volumes, in no particular order
+    void queryFrustum(const Frustum& frustum, std::vector<uint32_t>& outIds) const;
+    // Items whose box comes within radius of center
+    void querySphere(const glm::vec3& center, float radius, std::vector<uint32_t>& outIds) const;
+    // Items whose box the ray passes through within maxDistance, nearest first.
+    // direction doesn't need to be normalized, distances are in units of its length.
+    void queryRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+                  std::vector<SpatialRayHit>& outHits) const;
+
+private:
+    // Each node covers the contiguous range [itemStart, itemStart + itemCount) of items.
+    // Inner nodes have their left child right after them and store the right child's index.
+    struct Node {
+        glm::vec3 boundsMin;
+        uint32_t itemStart;
+        glm::vec3 boundsMax;
+        uint32_t itemCount;
+        uint32_t rightChild; // 0 for leaves, the root is never a right child
+    };
+
+    struct Item {
+        BoundingVolume volume;
+        uint32_t id;
+    };
+
+    uint32_t buildNode(uint32_t itemStart, uint32_t itemCount);
+
+    std::vector<Node> nodes;
+    std::vector<Item> items;
+};
+
+#endif // SPATIAL_INDEX_HPP
@@ -0,0 +1,103 @@
+#include "ThreadPool.hpp"
+#include "profiling/Profiler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+
+ThreadPool::ThreadPool(size_t threadCount) {
+    if (threadCount == 0) {
+        unsigned int hardwareThreads = std::thread::hardware_concurrency();
+        threadCount = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+    }
+    workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; i++) {
+        workers.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        stopping = true;
+    }
+    jobsAvailable.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::enqueue(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(jobsMutex);
+        jobs.push(std::move(job));
+    }
+    jobsAvailable.notify_one();
+}
+
+void ThreadPool::workerLoop(size_t index) {
+    Profiler::setThreadName("Worker " + std::to_string(index));
+    while (true) {
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(jobsMutex);
+            jobsAvailable.wait(lock, [this]() { return stopping || !jobs.empty(); });
+            if (stopping && jobs.empty()) {
+                return;
+            }
+            job = std::move(jobs.front());
+            jobs.pop();
+        }
+        job();
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t)>& fn) {
+    if (count == 0) {
+        return;
+    }
+    if (count == 1) {
+        fn(0);
+        return;
+    }
+
+    // Items are handed out through a shared counter. Helpers that only get to run
+    // after everything is claimed just return, so nobody waits on a queued job.
+    struct Batch {
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        size_t count;
+        const std::function<void(size_t)>* fn;
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    auto batch = std::make_shared<Batch>();
+    batch->count = count;
+    batch->fn = &fn;
+
+    auto work = [batch]() {
+        size_t completed = 0;
+        for (size_t i = batch->next++; i < batch->count; i = batch->next++) {
+            (*batch->fn)(i);
+            completed++;
+        }
+        if (completed > 0 && batch->done.fetch_add(completed) + completed == batch->count) {
+            std::lock_guard<std::mutex> lock(batch->mutex);
+            batch->finished.notify_all();
+        }
+    };
+
+    size_t helpers = std::min(workers.size(), count - 1);
+    for (size_t i = 0; i < helpers; i++) {
+        enqueue(work);
+    }
+    work();
+
+    std::unique_lock<std::mutex> lock(batch->mutex);
+    batch->finished.wait(lock, [&batch]() { return batch->done.load() == batch->count; });
+}
+
+ThreadPool& getThreadPool() {
+    static ThreadPool pool;
+    return pool;
+}
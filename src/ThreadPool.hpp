@@ -0,0 +1,59 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed set of worker threads for load-time jobs (TMAP decoding, collision cooking, ...)
+class ThreadPool {
+public:
+    // threadCount 0 means one worker per hardware thread, minus the main thread
+    explicit ThreadPool(size_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Queue a job, the future becomes ready when it has run
+    template <typename F>
+    std::future<std::invoke_result_t<F>> submit(F&& job);
+
+    // Run fn(i) for every i in [0, count) and wait for all of them.
+    // The calling thread works through items too, so this is safe to call from inside a job.
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+    size_t threadCount() const { return workers.size(); }
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> jobs;
+    std::mutex jobsMutex;
+    std::condition_variable jobsAvailable;
+    bool stopping = false;
+
+    void enqueue(std::function<void()> job);
+    void workerLoop(size_t index);
+};
+
+// Pool shared by the whole engine, created on first use
+ThreadPool& getThreadPool();
+
+template <typename F>
+std::future<std::invoke_result_t<F>> ThreadPool::submit(F&& job) {
+    using Result = std::invoke_result_t<F>;
+    // std::function needs a copyable callable, so the packaged_task goes behind a shared_ptr
+    auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(job));
+    std::future<Result> future = task->get_future();
+    enqueue([task]() { (*task)(); });
+    return future;
+}
+
+#endif // THREAD_POOL_HPP
@@ -0,0 +1,238 @@
+#include "WorldStreamer.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+
+#include "graphics/render.hpp"
+#include "logging/Logger.hpp"
+#include "profiling/Profiler.hpp"
+
+// Render groups of streamed chunks start here, the main level uploads as group 0
+const uint32_t FIRST_CHUNK_RENDER_GROUP = 1000;
+
+WorldStreamer::WorldStreamer(const WorldStreamerSettings& settings) : settings(settings) {
+}
+
+WorldStreamer::~WorldStreamer() {
+    // Loads still in flight finish in their job destructors, resident chunks need
+    // unloadAll with the physics world they were added to
+}
+
+bool WorldStreamer::addChunk(const std::string& filePath) {
+    TMAPSummary summary;
+    if (!readTMAPSummary(filePath, summary)) {
+        LOG_WARNING(LogCategory::Streaming, "Skipping unreadable chunk " << filePath);
+        return false;
+    }
+    
+    Chunk chunk;
+    chunk.filePath = filePath;
+    glm::vec3 offset(summary.mapOffset.x, summary.mapOffset.y, summary.mapOffset.z);
+    if (summary.hasBounds) {
+        chunk.boundsMin = offset + glm::vec3(summary.boundsMin.x, summary.boundsMin.y, summary.boundsMin.z);
+        chunk.boundsMax = offset + glm::vec3(summary.boundsMax.x, summary.boundsMax.y, summary.boundsMax.z);
+    } else {
+        // v1 files don't store bounds, all we know is where the chunk is anchored
+        chunk.boundsMin = offset;
+        chunk.boundsMax = offset;
+    }
+    // The mapping, GPU copy and collision BVH together come out at roughly twice the file size
+    chunk.estimatedBytes = static_cast<size_t>(summary.fileSize) * 2;
+    chunks.push_back(std::move(chunk));
+    return true;
+}
+
+size_t WorldStreamer::addChunksInDirectory(const std::string& directory) {
+    std::error_code error;
+    std::vector<std::string> paths;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        if (entry.is_regular_file() && entry.path().extension() == ".tmap") {
+            paths.push_back(entry.path().string());
+        }
+    }
+    // Directory order isn't stable across platforms, keep group numbering reproducible
+    std::sort(paths.begin(), paths.end());
+    
+    size_t added = 0;
+    for (const auto& path : paths) {
+        added += addChunk(path) ? 1 : 0;
+    }
+    LOG_INFO(LogCategory::Streaming, "Registered " << added << " chunks from " << directory);
+    return added;
+}
+
+size_t WorldStreamer::getResidentChunkCount() const {
+    return std::count_if(chunks.begin(), chunks.end(), [](const Chunk& chunk) {
+        return chunk.state == ChunkState::Resident;
+    });
+}
+
+float WorldStreamer::distanceTo(const Chunk& chunk, const glm::vec3& point) const {
+    glm::vec3 closest = glm::min(glm::max(point, chunk.boundsMin), chunk.boundsMax);
+    return glm::length(point - closest);
+}
+
+size_t WorldStreamer::pendingBytes() const {
+    size_t bytes = 0;
+    for (const auto& chunk : chunks) {
+        if (chunk.state == ChunkState::Loading) {
+            bytes += chunk.estimatedBytes;
+        }
+    }
+    return bytes;
+}
+
+size_t WorldStreamer::measureChunkBytes(const TMAPData& mapData) {
+    size_t bytes = mapData.storage ? mapData.storage->file.size() : 0;
+    if (mapData.storage) {
+        for (const auto& copy : mapData.storage->copies) {
+            bytes += copy.size();
+        }
+    }
+    for (const auto& mesh : mapData.meshes) {
+        bytes += mesh.vertices.size() * 5 * sizeof(float);  // Interleaved position + UV on the GPU
+        bytes += mesh.indexCount() * (mesh.indices16.empty() ? 4 : 2);
+        for (const auto& lod : mesh.lods) {
+            bytes += lod.indexCount() * (lod.indices16.empty() ? 4 : 2);
+        }
+        bytes += mesh.triangleCount() * 32;                  // Quantized BVH nodes, about two per triangle
+    }
+    return bytes;
+}
+
+void WorldStreamer::update(PhysicsManager& physics, const glm::vec3& focus, double budgetSeconds) {
+    PROFILE_ZONE("WorldStreamer::update");
+    // Evict what drifted out of range first so the budget is free for new chunks
+    for (auto& chunk : chunks) {
+        if (chunk.state == ChunkState::Resident && distanceTo(chunk, focus) > settings.unloadRadius) {
+            evict(physics, chunk);
+        }
+    }
+    
+    finishLoads(physics, focus, budgetSeconds);
+    startLoads(physics, focus);
+}
+
+void WorldStreamer::startLoads(PhysicsManager& physics, const glm::vec3& focus) {
+    size_t loading = std::count_if(chunks.begin(), chunks.end(), [](const Chunk& chunk) {
+        return chunk.state == ChunkState::Loading;
+    });
+    if (loading >= settings.maxConcurrentLoads) {
+        return;
+    }
+    
+    // Nearest chunks first
+    std::vector<Chunk*> candidates;
+    for (auto& chunk : chunks) {
+        if (chunk.state == ChunkState::Unloaded && distanceTo(chunk, focus) <= settings.loadRadius) {
+            candidates.push_back(&chunk);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(), [&](const Chunk* a, const Chunk* b) {
+        return distanceTo(*a, focus) < distanceTo(*b, focus);
+    });
+    
+    for (Chunk* chunk : candidates) {
+        if (loading >= settings.maxConcurrentLoads) {
+            break;
+        }
+        float distance = distanceTo(*chunk, focus);
+        
+        // Over budget: make room by evicting resident chunks that are further away than this one
+        while (residentBytes + pendingBytes() + chunk->estimatedBytes > settings.memoryBudgetBytes) {
+            Chunk* furthest = nullptr;
+            for (auto& other : chunks) {
+                if (other.state == ChunkState::Resident && distanceTo(other, focus) > distance &&
+                    (!furthest || distanceTo(other, focus) > distanceTo(*furthest, focus))) {
+                    furthest = &other;
+                }
+            }
+            if (!furthest) {
+                break;
+            }
+            evict(physics, *furthest);
+        }
+        if (residentBytes + pendingBytes() + chunk->estimatedBytes > settings.memoryBudgetBytes) {
+            // Everything resident is closer than this chunk, so it's the one that doesn't fit
+            break;
+        }
+        
+        chunk->state = ChunkState::Loading;
+        chunk->job = std::make_unique<LevelLoadJob>(chunk->filePath, settings.collision, settings.optimizeMeshes);
+        loading++;
+    }
+}
+
+void WorldStreamer::finishLoads(PhysicsManager& physics, const glm::vec3& focus, double budgetSeconds) {
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(budgetSeconds));
+    
+    for (size_t i = 0; i < chunks.size(); i++) {
+        Chunk& chunk = chunks[i];
+        if (chunk.state != ChunkState::Loading) {
+            continue;
+        }
+        
+        LevelLoadStage stage = chunk.job->getStage();
+        if (stage == LevelLoadStage::Failed) {
+            LOG_ERROR(LogCategory::Streaming, "Failed to load chunk " << chunk.filePath);
+            chunk.job.reset();
+            chunk.state = ChunkState::Failed;
+            continue;
+        }
+        if (stage != LevelLoadStage::Cooked && stage != LevelLoadStage::Finalizing) {
+            continue;
+        }
+        
+        // Wandered off while it was loading, throw the result away before uploading anything
+        if (stage == LevelLoadStage::Cooked && distanceTo(chunk, focus) > settings.unloadRadius) {
+            chunk.job.reset();
+            chunk.state = ChunkState::Unloaded;
+            continue;
+        }
+        
+        // Out of budget for this frame, but finalizing chunks keep their partial upload
+        if (std::chrono::steady_clock::now() >= deadline && stage == LevelLoadStage::Cooked) {
+            continue;
+        }
+        
+        chunk.renderGroup = FIRST_CHUNK_RENDER_GROUP + static_cast<uint32_t>(i);
+        if (!chunk.job->uploadRenderMeshes(deadline, chunk.renderGroup)) {
+            continue;
+        }
+        
+        chunk.physicsGroup = physics.addStaticMeshCollision(chunk.job->takeCookedCollision());
+        chunk.residentBytes = measureChunkBytes(chunk.job->getMapData());
+        chunk.estimatedBytes = chunk.residentBytes; // Better guess next time it streams in
+        residentBytes += chunk.residentBytes;
+        chunk.state = ChunkState::Resident;
+        chunk.job.reset(); // The render and physics worlds keep what they need
+        
+        LOG_INFO(LogCategory::Streaming, "Chunk " << chunk.filePath << " resident ("
+                                         << chunk.residentBytes / 1024 << " KiB, " << residentBytes / 1024 << " KiB total)");
+    }
+}
+
+void WorldStreamer::evict(PhysicsManager& physics, Chunk& chunk) {
+    RemoveWorldMeshGroup(chunk.renderGroup);
+    physics.removeStaticMeshCollision(chunk.physicsGroup);
+    residentBytes -= chunk.residentBytes;
+    chunk.residentBytes = 0;
+    chunk.state = ChunkState::Unloaded;
+    
+    LOG_INFO(LogCategory::Streaming, "Evicted chunk " << chunk.filePath);
+}
+
+void WorldStreamer::unloadAll(PhysicsManager& physics) {
+    for (auto& chunk : chunks) {
+        if (chunk.state == ChunkState::Resident) {
+            evict(physics, chunk);
+        } else if (chunk.state == ChunkState::Loading) {
+            // A partially uploaded chunk already has meshes in its render group
+            RemoveWorldMeshGroup(FIRST_CHUNK_RENDER_GROUP + static_cast<uint32_t>(&chunk - chunks.data()));
+            chunk.job.reset();
+            chunk.state = ChunkState::Unloaded;
+        }
+    }
+}
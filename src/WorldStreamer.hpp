@@ -0,0 +1,78 @@
+#ifndef WORLD_STREAMER_HPP
+#define WORLD_STREAMER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "LevelLoader.hpp"
+#include "PhysicsManager.hpp"
+
+struct WorldStreamerSettings {
+    float loadRadius = 150.0f;     // Chunks closer than this get loaded
+    float unloadRadius = 200.0f;   // Resident chunks further than this get evicted
+    size_t memoryBudgetBytes = size_t(512) * 1024 * 1024;
+    size_t maxConcurrentLoads = 2;
+    StaticCollisionOptions collision;
+    bool optimizeMeshes = false;   // Run MeshOptimizer on chunks as they load
+};
+
+// Keeps the TMAP chunks around a focus point resident, each at its own mapOffset.
+// Chunks are added to and removed from the current render world and physics world
+// one at a time, nothing else in either gets rebuilt.
+class WorldStreamer {
+public:
+    explicit WorldStreamer(const WorldStreamerSettings& settings);
+    ~WorldStreamer();
+
+    WorldStreamer(const WorldStreamer&) = delete;
+    WorldStreamer& operator=(const WorldStreamer&) = delete;
+
+    // Register a chunk, only its header is read here
+    bool addChunk(const std::string& filePath);
+    // Register every .tmap in a directory, returns how many were added
+    size_t addChunksInDirectory(const std::string& directory);
+
+    // Main thread, once per frame. Starts and finishes loads and evicts chunks around
+    // 'focus', spending about budgetSeconds on GPU uploads.
+    void update(PhysicsManager& physics, const glm::vec3& focus, double budgetSeconds);
+
+    // Drop every resident chunk, needed before 'physics' goes away
+    void unloadAll(PhysicsManager& physics);
+
+    size_t getResidentBytes() const { return residentBytes; }
+    size_t getResidentChunkCount() const;
+    size_t getChunkCount() const { return chunks.size(); }
+
+private:
+    enum class ChunkState { Unloaded, Loading, Resident, Failed };
+
+    struct Chunk {
+        std::string filePath;
+        glm::vec3 boundsMin;    // World space, mapOffset applied
+        glm::vec3 boundsMax;
+        size_t estimatedBytes;  // Guess from the file size until it's actually loaded
+        ChunkState state = ChunkState::Unloaded;
+        std::unique_ptr<LevelLoadJob> job;
+        uint32_t renderGroup = 0;
+        uint32_t physicsGroup = 0;
+        size_t residentBytes = 0;
+    };
+
+    WorldStreamerSettings settings;
+    std::vector<Chunk> chunks;
+    size_t residentBytes = 0;
+
+    float distanceTo(const Chunk& chunk, const glm::vec3& point) const;
+    void startLoads(PhysicsManager& physics, const glm::vec3& focus);
+    void finishLoads(PhysicsManager& physics, const glm::vec3& focus, double budgetSeconds);
+    void evict(PhysicsManager& physics, Chunk& chunk);
+    size_t pendingBytes() const;
+
+    static size_t measureChunkBytes(const TMAPData& mapData);
+};
+
+#endif // WORLD_STREAMER_HPP
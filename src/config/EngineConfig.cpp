@@ -26,6 +26,36 @@ bool EngineConfig::loadFromFile(const std::string& filename) {
         this->api = display.value("api", "openGL");
         this->frameRateLimit = display["frameRateLimit"].is_null() ? 0 : display["frameRateLimit"].get<int>();
         this->vsync = display.value("vsync", true);
+        this->viewDistance = display.value("viewDistance", 100.0f);
+        if (j["graphics"].contains("textures")) {
+            this->textureUploadBudgetKB = j["graphics"]["textures"].value("uploadBudgetKB", 4096);
+            this->textureMemoryBudgetMB = j["graphics"]["textures"].value("memoryBudgetMB", 512);
+        }
+        if (j["graphics"].contains("shaders")) {
+            this->shaderHotReload = j["graphics"]["shaders"].value("hotReload", true);
+        }
+        if (j.contains("streaming")) {
+            auto& streaming = j["streaming"];
+            this->streamingLoadRadius = streaming.value("loadRadius", 150.0f);
+            this->streamingUnloadRadius = streaming.value("unloadRadius", 200.0f);
+            this->streamingMemoryBudgetMB = streaming.value("memoryBudgetMB", 512);
+        }
+        if (j.contains("simulation")) {
+            auto& simulation = j["simulation"];
+            this->tickRate = simulation.value("tickRate", 60.0);
+            this->maxTicksPerFrame = simulation.value("maxTicksPerFrame", 5);
+        }
+        if (j.contains("physics")) {
+            auto& physics = j["physics"];
+            this->mergeStaticCollision = physics.value("mergeStaticCollision", true);
+            this->staticPartitionTriangles = physics.value("staticPartitionTriangles", 65536);
+        }
+        if (j.contains("maps")) {
+            this->optimizeMeshesOnLoad = j["maps"].value("optimizeMeshesOnLoad", false);
+        }
+        if (j.contains("logging")) {
+            this->logLevel = j["logging"].value("level", "info");
+        }
     } catch (json::parse_error& e) {
         std::string errorMsg = "Unable to parse " + filename;
         MessageBoxA(nullptr, errorMsg.c_str(), "Fatal Error", MB_ICONERROR);
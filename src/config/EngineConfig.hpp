@@ -15,6 +15,19 @@ public:
     const std::string& getApi() const { return api; }
     int getFrameRateLimit() const { return frameRateLimit; }
     bool isVsyncEnabled() const { return vsync; }
+    float getViewDistance() const { return viewDistance; }
+    int getTextureUploadBudgetKB() const { return textureUploadBudgetKB; }
+    int getTextureMemoryBudgetMB() const { return textureMemoryBudgetMB; }
+    bool isShaderHotReloadEnabled() const { return shaderHotReload; }
+    float getStreamingLoadRadius() const { return streamingLoadRadius; }
+    float getStreamingUnloadRadius() const { return streamingUnloadRadius; }
+    int getStreamingMemoryBudgetMB() const { return streamingMemoryBudgetMB; }
+    double getTickRate() const { return tickRate; }
+    int getMaxTicksPerFrame() const { return maxTicksPerFrame; }
+    bool isStaticCollisionMerged() const { return mergeStaticCollision; }
+    int getStaticPartitionTriangles() const { return staticPartitionTriangles; }
+    bool isMeshOptimizationOnLoadEnabled() const { return optimizeMeshesOnLoad; }
+    const std::string& getLogLevel() const { return logLevel; }
 
 private:
     std::string displayMode;
@@ -24,4 +37,17 @@ private:
     std::string api;
     int frameRateLimit = 0;
     bool vsync = true;
+    float viewDistance = 100.0f;
+    int textureUploadBudgetKB = 4096;
+    int textureMemoryBudgetMB = 512;
+    bool shaderHotReload = true;
+    float streamingLoadRadius = 150.0f;
+    float streamingUnloadRadius = 200.0f;
+    int streamingMemoryBudgetMB = 512;
+    double tickRate = 60.0;
+    int maxTicksPerFrame = 5;
+    bool mergeStaticCollision = true;
+    int staticPartitionTriangles = 65536;
+    bool optimizeMeshesOnLoad = false;
+    std::string logLevel = "info";
 };
\ No newline at end of file
@@ -1,23 +1,25 @@
 #include "game_process.hpp"
 
-#include <windows.h>
-#include <iostream>
-#include <GLFW/glfw3.h>
 #include <cstdint>
 #include <algorithm>
+#include <chrono>
+#include <limits>
+#include <memory>
 
 #include "tmap_parser.hpp"
 #include "graphics/render.hpp"
 #include "PhysicsManager.hpp"
+#include "LevelLoader.hpp"
+#include "SpatialIndex.hpp"
+#include "WorldStreamer.hpp"
 #include "input/input_manager.hpp"
+#include "logging/Logger.hpp"
+#include "profiling/Profiler.hpp"
 
 TMAPData g_mapData;
 Player g_player;
 PhysicsManager* g_physics = nullptr;
 
-static POINT lastMousePos = { -1, -1 };
-POINT mousePos;
-
 float fovMultiplier = 1.0f;
 const float CAMERA_Y_OFFSET = 0.72f;
 
@@ -34,64 +36,192 @@ const std::uint8_t TICKS_BETWEEN_JUMPS_MIN = 6;
 std::uint8_t coyoteTimeTicks = 0;
 const std::uint8_t COYOTE_TIME_TICKS_MAX = 6;
 
-bool setTmap(const std::string& filePath) {
-    std::cout << "setTmap: Attempting to load " << filePath << std::endl;
+static std::unique_ptr<LevelLoadJob> g_levelLoad;
+static bool g_levelLoadReported = false;
+static std::unique_ptr<WorldStreamer> g_worldStreamer;
+static StaticCollisionOptions g_collisionOptions;
+static bool g_optimizeMeshesOnLoad = false;
+static SpatialIndex g_worldIndex; // Over g_mapData.meshes
+
+static void buildWorldIndex() {
+    std::vector<BoundingVolume> volumes;
+    volumes.reserve(g_mapData.meshes.size());
+    glm::vec3 offset(g_mapData.mapOffset.x, g_mapData.mapOffset.y, g_mapData.mapOffset.z);
+    for (const auto& mesh : g_mapData.meshes) {
+        glm::vec3 boundsMin(mesh.boundsMin.x, mesh.boundsMin.y, mesh.boundsMin.z);
+        glm::vec3 boundsMax(mesh.boundsMax.x, mesh.boundsMax.y, mesh.boundsMax.z);
+        BoundingVolume volume;
+        volume.center = offset + (boundsMin + boundsMax) * 0.5f;
+        volume.extents = (boundsMax - boundsMin) * 0.5f;
+        volume.radius = glm::length(volume.extents);
+        volumes.push_back(volume);
+    }
+    g_worldIndex.build(volumes);
+}
+
+static void spawnPlayer() {
+    // Set player at spawn position
+    g_player.size = PLAYER_SIZE;
+    g_player.position = glm::vec3(g_mapData.spawnPosition.x, 
+                                  g_mapData.spawnPosition.y,
+                                  g_mapData.spawnPosition.z);
+    g_player.rotation = glm::vec3(0.0f, 0.0f, 0.0f);
     
-    if (loadTMAP(filePath, g_mapData)) {
-        std::cout << "setTmap: Loaded successfully!" << std::endl;
-        std::cout << "setTmap: Uploading meshes to renderer..." << std::endl;
-        
-        UploadTMAPMeshes(g_mapData);
-        
-        // Initialize physics world
+    // Create player physics capsule
+    g_player.standingShape = g_physics->createCapsuleShape(
+        g_player.size.x,  // radius
+        g_player.size.y   // height
+    );
+    
+    g_player.crouchingShape = g_physics->createCapsuleShape(
+        g_player.size.x,  // radius (same)
+        g_player.size.x   // height (becomes a sphere)
+    );
+    
+    // Create player physics capsule with standing shape
+    g_player.rigidBody = g_physics->createPlayerCapsule(
+        g_player.position, 
+        g_player.size.x,
+        g_player.size.y
+    );
+    playerSliding = false;
+    
+    // Don't interpolate the camera in from wherever it was in the old level
+    SetCameraPosition(g_player.position + glm::vec3(0.0f, CAMERA_Y_OFFSET, 0.0f));
+    SetCameraRotation(g_player.rotation);
+    SnapCamera();
+    
+    LOG_INFO(LogCategory::Game, "Player spawned at ("
+                                << g_player.position.x << ", " 
+                                << g_player.position.y << ", " 
+                                << g_player.position.z << ")");
+}
+
+void setStaticCollisionOptions(const StaticCollisionOptions& options) {
+    g_collisionOptions = options;
+}
+
+void setMeshOptimizationOnLoad(bool enabled) {
+    g_optimizeMeshesOnLoad = enabled;
+}
+
+bool requestTmapLoad(const std::string& filePath) {
+    if (g_levelLoad) {
+        LevelLoadStage stage = g_levelLoad->getStage();
+        if (stage != LevelLoadStage::Done && stage != LevelLoadStage::Failed) {
+            LOG_ERROR(LogCategory::Game, "Already loading " << g_levelLoad->getFilePath());
+            return false;
+        }
+    }
+    
+    LOG_INFO(LogCategory::Game, "Attempting to load " << filePath);
+    g_levelLoad = std::make_unique<LevelLoadJob>(filePath, g_collisionOptions, g_optimizeMeshesOnLoad);
+    g_levelLoadReported = false;
+    return true;
+}
+
+TmapLoadStatus getTmapLoadStatus() {
+    TmapLoadStatus status;
+    if (g_levelLoad) {
+        status.active = true;
+        status.stage = g_levelLoad->getStage();
+        status.progress = g_levelLoad->getProgress();
+        status.filePath = g_levelLoad->getFilePath();
+    }
+    return status;
+}
+
+void updateTmapLoad(double budgetSeconds) {
+    if (!g_levelLoad) {
+        return;
+    }
+    
+    auto deadline = std::chrono::steady_clock::now() +
+                    std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(budgetSeconds));
+    
+    switch (g_levelLoad->getStage()) {
+    case LevelLoadStage::Parsing:
+    case LevelLoadStage::Cooking:
+    case LevelLoadStage::Done:
+        return;
+    
+    case LevelLoadStage::Failed:
+        if (!g_levelLoadReported) {
+            LOG_ERROR(LogCategory::Game, "Failed to load TMAP");
+            g_levelLoadReported = true;
+        }
+        return;
+    
+    case LevelLoadStage::Cooked:
+        // The old level stays playable until here, now swap it out for a fresh world
+        LOG_INFO(LogCategory::Game, "Loaded successfully!");
+        LOG_INFO(LogCategory::Game, "Uploading meshes to renderer...");
+        if (g_worldStreamer && g_physics) {
+            g_worldStreamer->unloadAll(*g_physics);
+        }
+        ClearWorldMeshes();
+        g_player.rigidBody = nullptr;
         if (g_physics) {
             delete g_physics;
         }
         g_physics = new PhysicsManager();
-        
-        // Create collision meshes for the level
-        g_physics->createStaticMeshCollision(g_mapData);
-        
-        // Set player at spawn position
-        g_player.size = PLAYER_SIZE;
-        g_player.position = glm::vec3(g_mapData.spawnPosition.x, 
-                                      g_mapData.spawnPosition.y,
-                                      g_mapData.spawnPosition.z);
-        g_player.rotation = glm::vec3(0.0f, 0.0f, 0.0f);
-        
-        // Create player physics capsule
-        g_player.standingShape = g_physics->createCapsuleShape(
-            g_player.size.x,  // radius
-            g_player.size.y   // height
-        );
-        
-        g_player.crouchingShape = g_physics->createCapsuleShape(
-            g_player.size.x,  // radius (same)
-            g_player.size.x   // height (becomes a sphere)
-        );
-        
-        // Create player physics capsule with standing shape
-        g_player.rigidBody = g_physics->createPlayerCapsule(
-            g_player.position, 
-            g_player.size.x,
-            g_player.size.y
-        );
-        
-        std::cout << "setTmap: Player spawned at (" 
-                  << g_player.position.x << ", " 
-                  << g_player.position.y << ", " 
-                  << g_player.position.z << ")" << std::endl;
-        
-        std::cout << "setTmap: Complete!" << std::endl;
-        return true;
-    } else {
-        std::cerr << "setTmap: Failed to load TMAP" << std::endl;
+        [[fallthrough]];
+    
+    case LevelLoadStage::Finalizing:
+        if (g_levelLoad->uploadRenderMeshes(deadline)) {
+            // Create collision meshes for the level
+            g_physics->addStaticMeshCollision(g_levelLoad->takeCookedCollision());
+            g_mapData = std::move(g_levelLoad->getMapData());
+            buildWorldIndex();
+            spawnPlayer();
+            LOG_INFO(LogCategory::Game, "Complete!");
+        }
+        return;
+    }
+}
+
+bool setTmap(const std::string& filePath) {
+    if (!requestTmapLoad(filePath)) {
         return false;
     }
+    g_levelLoad->waitForBackground();
+    updateTmapLoad(std::numeric_limits<double>::infinity());
+    return g_levelLoad->getStage() == LevelLoadStage::Done;
+}
+
+void findMeshesNear(const glm::vec3& point, float radius, std::vector<uint32_t>& outMeshes) {
+    g_worldIndex.querySphere(point, radius, outMeshes);
+}
+
+void findMeshesAlongRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+                        std::vector<SpatialRayHit>& outHits) {
+    g_worldIndex.queryRay(origin, direction, maxDistance, outHits);
+}
+
+bool startWorldStreaming(const std::string& directory, const WorldStreamerSettings& settings) {
+    if (g_worldStreamer && g_physics) {
+        g_worldStreamer->unloadAll(*g_physics);
+    }
+    g_worldStreamer = std::make_unique<WorldStreamer>(settings);
+    if (g_worldStreamer->addChunksInDirectory(directory) == 0) {
+        LOG_WARNING(LogCategory::Game, "No chunks found in " << directory);
+        g_worldStreamer.reset();
+        return false;
+    }
+    return true;
+}
+
+void updateWorldStreaming(double budgetSeconds) {
+    // Chunks go into the current level's physics world, so wait until there is one
+    if (!g_worldStreamer || !g_physics || !g_player.rigidBody) {
+        return;
+    }
+    g_worldStreamer->update(*g_physics, g_player.position, budgetSeconds);
 }
 
 // Check if player is on ground
 bool isPlayerOnGround() {
+    PROFILE_FUNCTION();
     if (!g_player.rigidBody) return false;
     
     int numManifolds = g_physics->getDynamicsWorld()->getDispatcher()->getNumManifolds();
@@ -129,7 +259,8 @@ bool isPlayerOnGround() {
     return false;
 }
 
-void handleInput(float deltaTime) {
+void handleInput(float deltaTime, const ControllerState& inputState) {
+    PROFILE_FUNCTION();
     if (!g_player.rigidBody) return;
     
     // Movement parameters, TODO: Make these increase with progression
@@ -162,7 +293,6 @@ void handleInput(float deltaTime) {
     bool isMoving = false;
     
     // Handle movement input
-    ControllerState inputState = ProcessInput();
     if (inputState.buttons.move_forward) {
         moveDir += forward;
         isMoving = true;
@@ -323,24 +453,15 @@ void handleInput(float deltaTime) {
     // wasJumpPressed = jumpPressed;
     
     // Handle mouse look
-    double mousePosX, mousePosY;
-    glfwGetCursorPos(glfwGetCurrentContext(), &mousePosX, &mousePosY);
-    mousePos.x = static_cast<LONG>(mousePosX);
-    mousePos.y = static_cast<LONG>(mousePosY);
-    if (lastMousePos.x != -1 && lastMousePos.y != -1) {
+    if (inputState.mouse.delta_x != 0.0f || inputState.mouse.delta_y != 0.0f) {
         float mouseSensitivity = 0.1f;
-        float deltaX = static_cast<float>(mousePos.x - lastMousePos.x);
-        float deltaY = static_cast<float>(mousePos.y - lastMousePos.y);
-
-        g_player.rotation.y += deltaX * mouseSensitivity;
-        g_player.rotation.x -= deltaY * mouseSensitivity;
+        g_player.rotation.y += inputState.mouse.delta_x * mouseSensitivity;
+        g_player.rotation.x -= inputState.mouse.delta_y * mouseSensitivity;
 
         // Clamp pitch
         if (g_player.rotation.x > 89.0f) g_player.rotation.x = 89.0f;
         if (g_player.rotation.x < -89.0f) g_player.rotation.x = -89.0f;
     }
-    lastMousePos.x = mousePos.x;
-    lastMousePos.y = mousePos.y;
     // Right analog stick for camera look
     float lookDeadZone = 0.15f;
     float lookSensitivity = 3.0f; // Adjust this to taste
@@ -361,10 +482,12 @@ void handleInput(float deltaTime) {
     SetCameraRotation(g_player.rotation);
 }
 
-void runGameProcess(float deltaTime) {
+void runGameProcess(float deltaTime, const ControllerState& input) {
+    PROFILE_ZONE("Tick");
+    BeginCameraTick();
     if (g_physics) {
         g_physics->step(deltaTime);
     }
-    handleInput(deltaTime);
+    handleInput(deltaTime, input);
     // Other game logic here
 }
\ No newline at end of file
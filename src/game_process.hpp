@@ -6,6 +6,11 @@
 #include <glm/glm.hpp>
 #include <btBulletDynamicsCommon.h>
 
+#include "LevelLoader.hpp"
+#include "SpatialIndex.hpp"
+#include "input/input_manager.hpp"
+#include "WorldStreamer.hpp"
+
 using vec3 = glm::vec3;
 
 extern float fovMultiplier; // Multiplier for FOV based on velocity, locked between 1.0 and 1.25 (90 to 112.5 degrees)
@@ -34,6 +39,9 @@ struct Player {
     btCollisionShape* crouchingShape;
 };
 
+extern Player g_player;
+extern TMAPData g_mapData; // The loaded level
+
 class World {
 public:
     // std::vector<Mesh> meshes;
@@ -43,7 +51,42 @@ public:
     // Vector3 mapOffset;
 };
 
+struct TmapLoadStatus {
+    bool active = false; // false until the first load is requested
+    LevelLoadStage stage = LevelLoadStage::Done;
+    float progress = 0.0f;
+    std::string filePath;
+};
+
 bool isPlayerOnGround();
+
+// Blocking load, parses, cooks and uploads everything before returning
 bool setTmap(const std::string& filePath);
-void runGameProcess(float deltaTime);
-void handleInput(float deltaTime);
\ No newline at end of file
+
+// How levels loaded after this build their static collision
+void setStaticCollisionOptions(const StaticCollisionOptions& options);
+
+// Whether levels loaded after this go through MeshOptimizer first
+void setMeshOptimizationOnLoad(bool enabled);
+
+// Non-blocking load. Parsing and collision cooking run on the thread pool while the
+// current level keeps running, call updateTmapLoad once per frame to finish it off.
+bool requestTmapLoad(const std::string& filePath);
+TmapLoadStatus getTmapLoadStatus();
+
+// Main thread: swap in a finished background load, spending at most about
+// budgetSeconds per call on GPU uploads
+void updateTmapLoad(double budgetSeconds);
+
+// Broad-phase queries over the loaded level's mesh bounds (not streamed chunks), without
+// going through Bullet. Results are indices into g_mapData.meshes.
+void findMeshesNear(const glm::vec3& point, float radius, std::vector<uint32_t>& outMeshes);
+void findMeshesAlongRay(const glm::vec3& origin, const glm::vec3& direction, float maxDistance,
+                        std::vector<SpatialRayHit>& outHits);
+
+// Stream the .tmap chunks in 'directory' around the player, on top of the loaded level
+bool startWorldStreaming(const std::string& directory, const WorldStreamerSettings& settings);
+void updateWorldStreaming(double budgetSeconds);
+// One simulation tick, driven only by 'input' so it runs the same with or without a window
+void runGameProcess(float deltaTime, const ControllerState& input);
+void handleInput(float deltaTime, const ControllerState& inputState);
\ No newline at end of file
@@ -0,0 +1,180 @@
+#include "Frustum.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// FRUSTUM_NO_SSE forces the scalar loop, frustum_check_scalar builds with it to cover that path
+#if !defined(FRUSTUM_NO_SSE) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define FRUSTUM_SSE 1
+#include <emmintrin.h>
+#endif
+
+BoundingVolume computeBoundingVolume(const float* positions, size_t count, size_t stride) {
+    BoundingVolume volume;
+    if (count == 0) {
+        return volume;
+    }
+    auto point = [&](size_t i) {
+        const float* p = positions + i * stride;
+        return glm::vec3(p[0], p[1], p[2]);
+    };
+
+    glm::vec3 boundsMin = point(0);
+    glm::vec3 boundsMax = boundsMin;
+    for (size_t i = 1; i < count; i++) {
+        boundsMin = glm::min(boundsMin, point(i));
+        boundsMax = glm::max(boundsMax, point(i));
+    }
+    volume.center = (boundsMin + boundsMax) * 0.5f;
+    volume.extents = (boundsMax - boundsMin) * 0.5f;
+
+    float radiusSquared = 0.0f;
+    for (size_t i = 0; i < count; i++) {
+        glm::vec3 offset = point(i) - volume.center;
+        radiusSquared = std::max(radiusSquared, glm::dot(offset, offset));
+    }
+    volume.radius = std::sqrt(radiusSquared);
+    return volume;
+}
+
+void CullingSet::clear() {
+    count = 0;
+    for (auto* values : {&centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ, &radius}) {
+        values->clear();
+    }
+}
+
+void CullingSet::reserve(size_t reserveCount) {
+    size_t padded = (reserveCount + 3) & ~size_t(3);
+    for (auto* values : {&centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ, &radius}) {
+        values->reserve(padded);
+    }
+}
+
+void CullingSet::add(const BoundingVolume& volume) {
+    if (count % 4 == 0) {
+        for (auto* values : {&centerX, &centerY, &centerZ, &extentX, &extentY, &extentZ, &radius}) {
+            values->resize(count + 4, 0.0f);
+        }
+    }
+    centerX[count] = volume.center.x;
+    centerY[count] = volume.center.y;
+    centerZ[count] = volume.center.z;
+    extentX[count] = volume.extents.x;
+    extentY[count] = volume.extents.y;
+    extentZ[count] = volume.extents.z;
+    radius[count] = volume.radius;
+    count++;
+}
+
+Frustum Frustum::fromMatrix(const glm::mat4& viewProjection) {
+    // Gribb/Hartmann: each plane is the last row of the matrix plus or minus another row.
+    // glm is column-major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i]).
+    auto row = [&](int i) {
+        return glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+    };
+    glm::vec4 w = row(3);
+
+    Frustum frustum;
+    frustum.planes[0] = w + row(0);
+    frustum.planes[1] = w - row(0);
+    frustum.planes[2] = w + row(1);
+    frustum.planes[3] = w - row(1);
+    frustum.planes[4] = w + row(2);
+    frustum.planes[5] = w - row(2);
+    for (auto& plane : frustum.planes) {
+        float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f) {
+            plane /= length;
+        }
+    }
+    return frustum;
+}
+
+bool Frustum::isVisible(const BoundingVolume& volume) const {
+    for (const auto& plane : planes) {
+        glm::vec3 normal(plane);
+        float distance = glm::dot(normal, volume.center) + plane.w;
+        // Both the box and the sphere bound the mesh, whichever reaches less far is tighter
+        float reach = std::min(glm::dot(glm::abs(normal), volume.extents), volume.radius);
+        if (distance + reach < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+FrustumOverlap Frustum::classify(const glm::vec3& center, const glm::vec3& extents, uint8_t& planeMask) const {
+    for (int p = 0; p < 6; p++) {
+        if (!(planeMask & (1 << p))) {
+            continue;
+        }
+        glm::vec3 normal(planes[p]);
+        float distance = glm::dot(normal, center) + planes[p].w;
+        float reach = glm::dot(glm::abs(normal), extents);
+        if (distance + reach < 0.0f) {
+            return FrustumOverlap::Outside;
+        }
+        if (distance - reach >= 0.0f) {
+            planeMask &= ~(1 << p);
+        }
+    }
+    return planeMask ? FrustumOverlap::Intersecting : FrustumOverlap::Inside;
+}
+
+size_t Frustum::cull(const CullingSet& set, std::vector<uint32_t>& visible) const {
+    size_t added = 0;
+#ifdef FRUSTUM_SSE
+    __m128 planeX[6], planeY[6], planeZ[6], planeW[6], absX[6], absY[6], absZ[6];
+    for (int p = 0; p < 6; p++) {
+        planeX[p] = _mm_set1_ps(planes[p].x);
+        planeY[p] = _mm_set1_ps(planes[p].y);
+        planeZ[p] = _mm_set1_ps(planes[p].z);
+        planeW[p] = _mm_set1_ps(planes[p].w);
+        absX[p] = _mm_set1_ps(std::fabs(planes[p].x));
+        absY[p] = _mm_set1_ps(std::fabs(planes[p].y));
+        absZ[p] = _mm_set1_ps(std::fabs(planes[p].z));
+    }
+    const __m128 zero = _mm_setzero_ps();
+
+    for (size_t base = 0; base < set.count; base += 4) {
+        __m128 cx = _mm_loadu_ps(&set.centerX[base]);
+        __m128 cy = _mm_loadu_ps(&set.centerY[base]);
+        __m128 cz = _mm_loadu_ps(&set.centerZ[base]);
+        __m128 ex = _mm_loadu_ps(&set.extentX[base]);
+        __m128 ey = _mm_loadu_ps(&set.extentY[base]);
+        __m128 ez = _mm_loadu_ps(&set.extentZ[base]);
+        __m128 r = _mm_loadu_ps(&set.radius[base]);
+
+        // Bit set while a volume is still inside every plane tested so far
+        int inside = 0xF;
+        for (int p = 0; p < 6 && inside; p++) {
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], cx), _mm_mul_ps(planeY[p], cy)),
+                                         _mm_add_ps(_mm_mul_ps(planeZ[p], cz), planeW[p]));
+            __m128 boxReach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[p], ex), _mm_mul_ps(absY[p], ey)),
+                                         _mm_mul_ps(absZ[p], ez));
+            __m128 reach = _mm_min_ps(boxReach, r);
+            inside &= _mm_movemask_ps(_mm_cmpge_ps(_mm_add_ps(distance, reach), zero));
+        }
+
+        for (size_t lane = 0; lane < 4 && base + lane < set.count; lane++) {
+            if (inside & (1 << lane)) {
+                visible.push_back(static_cast<uint32_t>(base + lane));
+                added++;
+            }
+        }
+    }
+#else
+    for (size_t i = 0; i < set.count; i++) {
+        BoundingVolume volume;
+        volume.center = glm::vec3(set.centerX[i], set.centerY[i], set.centerZ[i]);
+        volume.extents = glm::vec3(set.extentX[i], set.extentY[i], set.extentZ[i]);
+        volume.radius = set.radius[i];
+        if (isVisible(volume)) {
+            visible.push_back(static_cast<uint32_t>(i));
+            added++;
+        }
+    }
+#endif
+    return added;
+}
@@ -0,0 +1,70 @@
+#ifndef FRUSTUM_HPP
+#define FRUSTUM_HPP
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// View frustum culling, CPU only (no GL calls) so it can be exercised without a context.
+
+// AABB (center and half extents) plus a bounding sphere around the same center
+struct BoundingVolume {
+    glm::vec3 center = glm::vec3(0.0f);
+    glm::vec3 extents = glm::vec3(0.0f);
+    float radius = 0.0f;
+};
+
+// Bounds of count xyz positions, stride floats apart (so interleaved vertex data works).
+// The sphere shares the box center but is fitted to the points, it's never looser than
+// the box's half diagonal and much tighter for round-ish meshes.
+BoundingVolume computeBoundingVolume(const float* positions, size_t count, size_t stride = 3);
+
+// Bounding volumes in structure-of-arrays form, four at a time get tested against a plane.
+// The arrays are padded to a multiple of 4, cull skips the padding.
+class CullingSet {
+public:
+    void clear();
+    void reserve(size_t count);
+    void add(const BoundingVolume& volume);
+    size_t size() const { return count; }
+
+private:
+    friend class Frustum;
+
+    size_t count = 0;
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+    std::vector<float> radius;
+};
+
+enum class FrustumOverlap {
+    Outside,
+    Intersecting,
+    Inside
+};
+
+class Frustum {
+public:
+    static const uint8_t ALL_PLANES = 0x3F;
+
+    // Planes of an OpenGL style (-w..w clip space) projection * view matrix
+    static Frustum fromMatrix(const glm::mat4& viewProjection);
+
+    // Conservative, may say a volume just outside a frustum corner is visible
+    bool isVisible(const BoundingVolume& volume) const;
+
+    // Box against the planes set in planeMask, for hierarchy traversal. Planes the box is
+    // entirely inside of are cleared from the mask, children only need to test the rest.
+    FrustumOverlap classify(const glm::vec3& center, const glm::vec3& extents, uint8_t& planeMask) const;
+
+    // Appends the index of every visible volume to visible, returns how many were added
+    size_t cull(const CullingSet& set, std::vector<uint32_t>& visible) const;
+
+private:
+    // Normalized (nx, ny, nz, d), inside is nx*x + ny*y + nz*z + d >= 0.
+    // Order: left, right, bottom, top, near, far.
+    glm::vec4 planes[6];
+};
+
+#endif // FRUSTUM_HPP
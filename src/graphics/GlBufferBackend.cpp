@@ -0,0 +1,47 @@
+#include "GlBufferBackend.hpp"
+
+#include "../logging/Logger.hpp"
+
+// All work goes through the copy-write binding point so it never disturbs the
+// ARRAY_BUFFER or a bound vertex array's ELEMENT_ARRAY_BUFFER
+
+GlBufferBackend::~GlBufferBackend() {
+    if (buffer) {
+        glDeleteBuffers(1, &buffer);
+    }
+}
+
+bool GlBufferBackend::resize(size_t newBytes, size_t keepBytes) {
+    GLuint grown;
+    glGenBuffers(1, &grown);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, grown);
+    glBufferData(GL_COPY_WRITE_BUFFER, newBytes, nullptr, GL_STATIC_DRAW);
+    if (glGetError() == GL_OUT_OF_MEMORY) {
+        LOG_ERROR(LogCategory::Render, "Out of memory growing a mesh buffer to " << newBytes / (1024 * 1024) << " MiB");
+        glDeleteBuffers(1, &grown);
+        return false;
+    }
+    
+    if (buffer) {
+        if (keepBytes > 0) {
+            glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+            glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, keepBytes);
+        }
+        glDeleteBuffers(1, &buffer);
+    }
+    buffer = grown;
+    return true;
+}
+
+void* GlBufferBackend::map(size_t offset, size_t bytes) {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    // Invalidating lets the driver skip waiting on draws that used whatever was here before
+    return glMapBufferRange(GL_COPY_WRITE_BUFFER, offset, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+}
+
+void GlBufferBackend::unmap() {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    if (!glUnmapBuffer(GL_COPY_WRITE_BUFFER)) {
+        LOG_WARNING(LogCategory::Render, "Mesh buffer contents were lost while mapped");
+    }
+}
@@ -0,0 +1,28 @@
+#ifndef GL_BUFFER_BACKEND_HPP
+#define GL_BUFFER_BACKEND_HPP
+
+#include <GL/glew.h>
+
+#include "GpuBufferArena.hpp"
+
+// GpuBufferArena storage in a GL buffer object. Growing allocates a new buffer and copies
+// the old contents across on the GPU, so the handle changes (the arena's generation says when).
+class GlBufferBackend : public BufferArenaBackend {
+public:
+    GlBufferBackend() = default;
+    ~GlBufferBackend() override;
+
+    GlBufferBackend(const GlBufferBackend&) = delete;
+    GlBufferBackend& operator=(const GlBufferBackend&) = delete;
+
+    bool resize(size_t newBytes, size_t keepBytes) override;
+    void* map(size_t offset, size_t bytes) override;
+    void unmap() override;
+
+    GLuint getBuffer() const { return buffer; }
+
+private:
+    GLuint buffer = 0;
+};
+
+#endif // GL_BUFFER_BACKEND_HPP
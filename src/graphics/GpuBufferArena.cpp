@@ -0,0 +1,141 @@
+#include "GpuBufferArena.hpp"
+
+#include <algorithm>
+
+bool HostBufferBackend::resize(size_t newBytes, size_t keepBytes) {
+    (void)keepBytes; // vector::resize keeps everything anyway
+    data.resize(newBytes);
+    return true;
+}
+
+void* HostBufferBackend::map(size_t offset, size_t bytes) {
+    if (offset + bytes > data.size()) {
+        return nullptr;
+    }
+    return data.data() + offset;
+}
+
+RangeAllocator::RangeAllocator(size_t capacity) {
+    grow(capacity);
+}
+
+size_t RangeAllocator::allocate(size_t count) {
+    if (count == 0) {
+        return INVALID;
+    }
+    auto bySize = freeBySize.lower_bound(count);
+    if (bySize == freeBySize.end()) {
+        return INVALID;
+    }
+
+    // Take the front of the smallest block that fits, the rest stays free
+    size_t offset = bySize->second;
+    size_t blockCount = bySize->first;
+    eraseFree(freeByOffset.find(offset));
+    if (blockCount > count) {
+        insertFree(offset + count, blockCount - count);
+    }
+    used += count;
+    return offset;
+}
+
+void RangeAllocator::free(size_t offset, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    used -= count;
+
+    // Merge with the free blocks on either side
+    auto next = freeByOffset.lower_bound(offset);
+    if (next != freeByOffset.end() && next->first == offset + count) {
+        count += next->second;
+        eraseFree(next);
+    }
+    auto previous = freeByOffset.lower_bound(offset);
+    if (previous != freeByOffset.begin()) {
+        --previous;
+        if (previous->first + previous->second == offset) {
+            offset = previous->first;
+            count += previous->second;
+            eraseFree(previous);
+        }
+    }
+    insertFree(offset, count);
+}
+
+void RangeAllocator::grow(size_t newCapacity) {
+    if (newCapacity <= capacity) {
+        return;
+    }
+    size_t added = newCapacity - capacity;
+    size_t start = capacity;
+    capacity = newCapacity;
+    used += added; // free() takes it back off
+    free(start, added);
+}
+
+size_t RangeAllocator::getLargestFreeBlock() const {
+    return freeBySize.empty() ? 0 : freeBySize.rbegin()->first;
+}
+
+void RangeAllocator::insertFree(size_t offset, size_t count) {
+    freeByOffset.emplace(offset, count);
+    freeBySize.emplace(count, offset);
+}
+
+void RangeAllocator::eraseFree(std::map<size_t, size_t>::iterator block) {
+    auto sizes = freeBySize.equal_range(block->second);
+    for (auto it = sizes.first; it != sizes.second; ++it) {
+        if (it->second == block->first) {
+            freeBySize.erase(it);
+            break;
+        }
+    }
+    freeByOffset.erase(block);
+}
+
+GpuBufferArena::GpuBufferArena(std::unique_ptr<BufferArenaBackend> backend, size_t elementSize, size_t initialElements)
+    : backend(std::move(backend)), elementSize(elementSize) {
+    if (initialElements > 0 && this->backend->resize(initialElements * elementSize, 0)) {
+        allocator.grow(initialElements);
+    }
+}
+
+bool GpuBufferArena::allocate(size_t count, Range& outRange) {
+    size_t first = allocator.allocate(count);
+    if (first == RangeAllocator::INVALID) {
+        if (count == 0) {
+            return false;
+        }
+        // Double until it fits even if all the new space has to hold it
+        size_t oldCapacity = allocator.getCapacity();
+        size_t newCapacity = std::max<size_t>(oldCapacity, 1);
+        while (newCapacity < oldCapacity + count) {
+            newCapacity *= 2;
+        }
+        if (!backend->resize(newCapacity * elementSize, oldCapacity * elementSize)) {
+            return false;
+        }
+        allocator.grow(newCapacity);
+        generation++;
+        first = allocator.allocate(count);
+        if (first == RangeAllocator::INVALID) {
+            return false;
+        }
+    }
+    outRange.first = first;
+    outRange.count = count;
+    return true;
+}
+
+void GpuBufferArena::free(const Range& range) {
+    allocator.free(range.first, range.count);
+}
+
+void* GpuBufferArena::map(const Range& range) {
+    return backend->map(range.first * elementSize, range.count * elementSize);
+}
+
+void GpuBufferArena::unmap() {
+    backend->unmap();
+}
@@ -0,0 +1,98 @@
+#ifndef GPU_BUFFER_ARENA_HPP
+#define GPU_BUFFER_ARENA_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <vector>
+
+// Storage behind a GpuBufferArena. The GL version lives in GlBufferBackend, the host
+// memory one below stands in for it in tools and CPU-side checks.
+class BufferArenaBackend {
+public:
+    virtual ~BufferArenaBackend() = default;
+
+    // Make the buffer newBytes long, keeping the contents of the first keepBytes
+    virtual bool resize(size_t newBytes, size_t keepBytes) = 0;
+    // Write-only view of [offset, offset + bytes), valid until unmap. One mapping at a time.
+    virtual void* map(size_t offset, size_t bytes) = 0;
+    virtual void unmap() = 0;
+};
+
+class HostBufferBackend : public BufferArenaBackend {
+public:
+    bool resize(size_t newBytes, size_t keepBytes) override;
+    void* map(size_t offset, size_t bytes) override;
+    void unmap() override {}
+
+    const std::vector<std::byte>& getData() const { return data; }
+
+private:
+    std::vector<std::byte> data;
+};
+
+// Best-fit sub-allocator over [0, capacity) in abstract units, freed neighbours are merged
+class RangeAllocator {
+public:
+    static const size_t INVALID = static_cast<size_t>(-1);
+
+    explicit RangeAllocator(size_t capacity = 0);
+
+    // Offset of count free units, or INVALID if no free block is big enough
+    size_t allocate(size_t count);
+    void free(size_t offset, size_t count);
+    // Adds [capacity, newCapacity) to the free space
+    void grow(size_t newCapacity);
+
+    size_t getCapacity() const { return capacity; }
+    size_t getUsed() const { return used; }
+    size_t getFreeBlockCount() const { return freeByOffset.size(); }
+    size_t getLargestFreeBlock() const;
+
+private:
+    void insertFree(size_t offset, size_t count);
+    void eraseFree(std::map<size_t, size_t>::iterator block);
+
+    size_t capacity = 0;
+    size_t used = 0;
+    std::map<size_t, size_t> freeByOffset;     // offset -> count
+    std::multimap<size_t, size_t> freeBySize;  // count -> offset
+};
+
+// One big buffer of fixed-size elements (vertices, indices) that meshes get ranges of,
+// instead of a buffer object each. Grows by doubling when an allocation doesn't fit;
+// the backend may hand out a new buffer object then, see getGeneration.
+class GpuBufferArena {
+public:
+    struct Range {
+        size_t first = 0; // In elements
+        size_t count = 0;
+    };
+
+    GpuBufferArena(std::unique_ptr<BufferArenaBackend> backend, size_t elementSize, size_t initialElements);
+
+    bool allocate(size_t count, Range& outRange);
+    void free(const Range& range);
+
+    // Write-only pointer to the range's elements, unmap before drawing or mapping another range
+    void* map(const Range& range);
+    void unmap();
+
+    // Bumped whenever the storage is reallocated, anything pointing at the old buffer
+    // (vertex array bindings) has to be set up again
+    uint32_t getGeneration() const { return generation; }
+    size_t getElementSize() const { return elementSize; }
+    size_t getCapacity() const { return allocator.getCapacity(); }
+    size_t getUsed() const { return allocator.getUsed(); }
+    const RangeAllocator& getAllocator() const { return allocator; }
+    BufferArenaBackend& getBackend() { return *backend; }
+
+private:
+    std::unique_ptr<BufferArenaBackend> backend;
+    size_t elementSize;
+    RangeAllocator allocator;
+    uint32_t generation = 0;
+};
+
+#endif // GPU_BUFFER_ARENA_HPP
@@ -0,0 +1,389 @@
+#include "ShaderManager.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "../io/AtomicFile.hpp"
+#include "../io/ContentHash.hpp"
+#include "../io/MappedFile.hpp"
+#include "../logging/Logger.hpp"
+#include "../profiling/Profiler.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const char CACHE_MAGIC[4] = {'T', 'S', 'H', 'B'};
+const uint32_t CACHE_VERSION = 1;
+const auto RELOAD_POLL_INTERVAL = std::chrono::milliseconds(500);
+
+// File layout: header, then the program binary exactly as glGetProgramBinary returned it
+struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key; // Expanded sources and the driver that linked them
+    uint32_t binaryFormat;
+    uint32_t binarySize;
+    uint64_t reserved;
+};
+static_assert(sizeof(CacheHeader) == 32, "Shader cache header must stay 32 bytes");
+
+bool readFile(const fs::path& path, std::string& out) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    std::ostringstream contents;
+    contents << in.rdbuf();
+    out = contents.str();
+    return true;
+}
+
+// Deleted files read as the oldest time, so they count as changed once and then settle
+fs::file_time_type modifiedTime(const fs::path& path) {
+    std::error_code error;
+    fs::file_time_type modified = fs::last_write_time(path, error);
+    return error ? fs::file_time_type::min() : modified;
+}
+
+// The path inside #include "path" or #include <path>, false if the line isn't an include
+bool parseInclude(const std::string& line, std::string& target) {
+    size_t start = line.find_first_not_of(" \t");
+    if (start == std::string::npos || line.compare(start, 1, "#") != 0) {
+        return false;
+    }
+    start = line.find_first_not_of(" \t", start + 1);
+    if (start == std::string::npos || line.compare(start, 7, "include") != 0) {
+        return false;
+    }
+    size_t open = line.find_first_of("\"<", start + 7);
+    if (open == std::string::npos) {
+        return false;
+    }
+    size_t close = line.find(line[open] == '"' ? '"' : '>', open + 1);
+    if (close == std::string::npos) {
+        return false;
+    }
+    target = line.substr(open + 1, close - open - 1);
+    return true;
+}
+
+bool isVersionLine(const std::string& line) {
+    size_t start = line.find_first_not_of(" \t");
+    return start != std::string::npos && line.compare(start, 8, "#version") == 0;
+}
+
+bool writeCache(const std::string& cachePath, uint64_t key, GLenum format, const std::vector<std::byte>& binary) {
+    CacheHeader header = {};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.key = key;
+    header.binaryFormat = format;
+    header.binarySize = static_cast<uint32_t>(binary.size());
+
+    std::error_code error;
+    fs::create_directories(fs::path(cachePath).parent_path(), error);
+    // The binary follows the header directly, alignment 1 adds no padding
+    if (!writeFileAtomically(cachePath, &header, sizeof(header), nullptr, 0, {{binary.data(), binary.size()}}, 1)) {
+        LOG_WARNING(LogCategory::Render, "Failed to write shader cache " << cachePath);
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+ShaderManager::~ShaderManager() {
+    cleanup();
+}
+
+void ShaderManager::setDirectory(const std::string& directory) {
+    this->directory = directory;
+    LOG_INFO(LogCategory::Render, "Shader directory set to " << directory);
+    for (auto& entry : programs) {
+        build(*entry);
+    }
+}
+
+void ShaderManager::registerBuiltin(const std::string& name, const char* vertexSource, const char* fragmentSource) {
+    builtins.push_back({name, vertexSource, fragmentSource});
+}
+
+void ShaderManager::setUniformBlockBinding(const std::string& block, GLuint binding) {
+    blockBindings.emplace_back(block, binding);
+}
+
+void ShaderManager::setSamplerUnit(const std::string& sampler, GLint unit) {
+    samplerUnits.emplace_back(sampler, unit);
+}
+
+ShaderProgram* ShaderManager::load(const std::string& name, const std::vector<std::string>& defines) {
+    for (auto& entry : programs) {
+        if (entry->name == name && entry->defines == defines) {
+            return entry->program.isValid() ? &entry->program : nullptr;
+        }
+    }
+    // Kept even when it fails, so fixing the file brings it in on the next reload
+    programs.push_back(std::make_unique<Program>());
+    Program& entry = *programs.back();
+    entry.name = name;
+    entry.defines = defines;
+    return build(entry) ? &entry.program : nullptr;
+}
+
+size_t ShaderManager::reloadChanged() {
+    if (!hotReload || programs.empty()) {
+        return 0;
+    }
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastPoll < RELOAD_POLL_INTERVAL) {
+        return 0;
+    }
+    lastPoll = now;
+
+    size_t rebuilt = 0;
+    for (auto& entry : programs) {
+        bool changed = std::any_of(entry->files.begin(), entry->files.end(), [](const SourceFile& file) {
+            return modifiedTime(file.path) != file.modified;
+        });
+        if (changed) {
+            LOG_INFO(LogCategory::Render, "Shader " << entry->name << " changed on disk, rebuilding");
+            if (build(*entry)) {
+                rebuilt++;
+            }
+        }
+    }
+    return rebuilt;
+}
+
+bool ShaderManager::preprocess(const std::string& source, const fs::path& sourcePath,
+                               const std::vector<std::string>& defines, std::string& out,
+                               std::vector<fs::path>& files) const {
+    files.assign(1, sourcePath.empty() ? fs::path() : fs::weakly_canonical(sourcePath));
+    std::string body;
+    if (!expand(source, sourcePath, 0, files, body)) {
+        return false;
+    }
+
+    std::string defineBlock;
+    for (const std::string& define : defines) {
+        defineBlock += "#define " + define + "\n";
+    }
+    // Defines go right after #version, which has to come first
+    size_t versionStart = 0;
+    size_t versionEnd = std::string::npos;
+    int versionLine = 0;
+    while (versionStart < body.size()) {
+        size_t lineEnd = body.find('\n', versionStart);
+        std::string line = body.substr(versionStart, lineEnd == std::string::npos ? std::string::npos : lineEnd - versionStart);
+        versionLine++;
+        if (isVersionLine(line)) {
+            versionEnd = lineEnd == std::string::npos ? body.size() : lineEnd + 1;
+            break;
+        }
+        if (lineEnd == std::string::npos) {
+            break;
+        }
+        versionStart = lineEnd + 1;
+    }
+    if (versionEnd == std::string::npos) {
+        out = defineBlock + "#line 1 0\n" + body;
+    } else {
+        out = body.substr(0, versionEnd) + (versionEnd == body.size() ? "\n" : "") + defineBlock +
+              "#line " + std::to_string(versionLine + 1) + " 0\n" + body.substr(versionEnd);
+    }
+    return true;
+}
+
+bool ShaderManager::expand(const std::string& source, const fs::path& sourcePath, size_t sourceIndex,
+                           std::vector<fs::path>& files, std::string& out) const {
+    std::istringstream lines(source);
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(lines, line)) {
+        lineNumber++;
+        std::string target;
+        if (!parseInclude(line, target)) {
+            out += line;
+            out += '\n';
+            continue;
+        }
+
+        // Next to the including file first, then the shader directory
+        fs::path includePath;
+        if (!sourcePath.empty() && fs::exists(sourcePath.parent_path() / target)) {
+            includePath = sourcePath.parent_path() / target;
+        } else if (!directory.empty() && fs::exists(directory / target)) {
+            includePath = directory / target;
+        } else {
+            LOG_ERROR(LogCategory::Render, (sourcePath.empty() ? std::string("built-in shader") : sourcePath.string())
+                      << ":" << lineNumber << ": can't find include " << target);
+            return false;
+        }
+
+        // Every file goes in once, which also stops include cycles
+        fs::path canonical = fs::weakly_canonical(includePath);
+        if (std::find(files.begin(), files.end(), canonical) != files.end()) {
+            out += '\n';
+            continue;
+        }
+        std::string included;
+        if (!readFile(includePath, included)) {
+            LOG_ERROR(LogCategory::Render, "Failed to read shader include " << includePath.string());
+            return false;
+        }
+        files.push_back(canonical);
+        size_t includedIndex = files.size() - 1;
+        out += "#line 1 " + std::to_string(includedIndex) + "\n";
+        if (!expand(included, includePath, includedIndex, files, out)) {
+            return false;
+        }
+        out += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(sourceIndex) + "\n";
+    }
+    return true;
+}
+
+bool ShaderManager::build(Program& entry) {
+    PROFILE_FUNCTION();
+    auto start = std::chrono::steady_clock::now();
+    std::string label = entry.name;
+    for (const std::string& define : entry.defines) {
+        label += (&define == &entry.defines.front() ? " [" : ", ") + define;
+    }
+    if (!entry.defines.empty()) {
+        label += "]";
+    }
+
+    fs::path vertexPath;
+    fs::path fragmentPath;
+    std::string vertexSource;
+    std::string fragmentSource;
+    if (!directory.empty() && fs::exists(directory / (entry.name + ".vert")) &&
+        fs::exists(directory / (entry.name + ".frag"))) {
+        vertexPath = directory / (entry.name + ".vert");
+        fragmentPath = directory / (entry.name + ".frag");
+        if (!readFile(vertexPath, vertexSource) || !readFile(fragmentPath, fragmentSource)) {
+            LOG_ERROR(LogCategory::Render, "Failed to read shader " << label);
+            return false;
+        }
+    } else {
+        auto builtin = std::find_if(builtins.begin(), builtins.end(), [&](const Builtin& b) { return b.name == entry.name; });
+        if (builtin == builtins.end()) {
+            LOG_ERROR(LogCategory::Render, "No sources for shader " << label << " in " << directory.string());
+            return false;
+        }
+        vertexSource = builtin->vertexSource;
+        fragmentSource = builtin->fragmentSource;
+    }
+
+    // Modification times are taken before building, so a broken file isn't retried until it changes again
+    std::string vertexExpanded;
+    std::string fragmentExpanded;
+    std::vector<fs::path> vertexFiles;
+    std::vector<fs::path> fragmentFiles;
+    bool expanded = preprocess(vertexSource, vertexPath, entry.defines, vertexExpanded, vertexFiles) &&
+                    preprocess(fragmentSource, fragmentPath, entry.defines, fragmentExpanded, fragmentFiles);
+    entry.files.clear();
+    for (const auto* files : {&vertexFiles, &fragmentFiles}) {
+        for (const fs::path& path : *files) {
+            bool known = std::any_of(entry.files.begin(), entry.files.end(), [&](const SourceFile& file) { return file.path == path; });
+            if (!path.empty() && !known) {
+                entry.files.push_back({path, modifiedTime(path)});
+            }
+        }
+    }
+    if (!expanded) {
+        return false;
+    }
+
+    uint64_t key = computeKey(vertexExpanded, fragmentExpanded);
+    std::string cachePath = cachePathFor(entry);
+    bool fromCache = false;
+    MappedFile cache;
+    if (!cachePath.empty() && GLEW_ARB_get_program_binary && cache.open(cachePath)) {
+        CacheHeader header = {};
+        if (cache.size() >= sizeof(header)) {
+            std::memcpy(&header, cache.data(), sizeof(header));
+        }
+        bool matches = std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) == 0 && header.version == CACHE_VERSION &&
+                       header.key == key && header.binarySize <= cache.size() - sizeof(header);
+        fromCache = matches && entry.program.loadBinary(label, header.binaryFormat, cache.data() + sizeof(header), header.binarySize);
+        if (matches && !fromCache) {
+            LOG_INFO(LogCategory::Render, "Ignoring shader cache " << cachePath << " (rejected by the driver)");
+        }
+        cache.close();
+    }
+
+    if (!fromCache) {
+        if (!entry.program.build(label, vertexExpanded.c_str(), fragmentExpanded.c_str())) {
+            // Errors read "N(line)", N being one of these
+            for (const auto* files : {&vertexFiles, &fragmentFiles}) {
+                for (size_t i = 1; i < files->size(); i++) {
+                    LOG_ERROR(LogCategory::Render, "  source " << i << " is " << (*files)[i].string());
+                }
+            }
+            return false;
+        }
+        GLenum format = 0;
+        std::vector<std::byte> binary;
+        if (!cachePath.empty() && entry.program.getBinary(format, binary)) {
+            writeCache(cachePath, key, format, binary);
+        }
+    }
+
+    applyBindings(entry.program);
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    LOG_INFO(LogCategory::Render, "Shader " << label << (fromCache ? " loaded from binary cache" : " compiled")
+             << " in " << elapsed.count() << " ms");
+    return true;
+}
+
+void ShaderManager::applyBindings(const ShaderProgram& program) const {
+    for (const auto& [block, binding] : blockBindings) {
+        program.bindUniformBlock(block, binding);
+    }
+    for (const auto& [sampler, unit] : samplerUnits) {
+        if (program.uniformLocation(sampler) >= 0) {
+            program.setSampler(sampler, unit);
+        }
+    }
+    glUseProgram(0);
+}
+
+std::string ShaderManager::cachePathFor(const Program& entry) const {
+    if (directory.empty()) {
+        return "";
+    }
+    std::string fileName = entry.name;
+    if (!entry.defines.empty()) {
+        // Each set of defines is its own program, and gets its own file
+        uint64_t variant = 0;
+        for (const std::string& define : entry.defines) {
+            variant = hashContent(define.data(), define.size(), variant + 1);
+        }
+        std::ostringstream suffix;
+        suffix << std::hex << variant;
+        fileName += "." + suffix.str();
+    }
+    return (directory / "cache" / (fileName + ".progbin")).string();
+}
+
+uint64_t ShaderManager::computeKey(const std::string& vertexSource, const std::string& fragmentSource) {
+    if (driver.empty()) {
+        for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+            const GLubyte* value = glGetString(name);
+            driver += value ? reinterpret_cast<const char*>(value) : "";
+            driver += '\n';
+        }
+    }
+    uint64_t key = hashContent(vertexSource.data(), vertexSource.size());
+    key = hashContent(fragmentSource.data(), fragmentSource.size(), key);
+    key = hashContent(driver.data(), driver.size(), key);
+    return key ? key : 1;
+}
+
+void ShaderManager::cleanup() {
+    programs.clear();
+}
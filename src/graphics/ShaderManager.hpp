@@ -0,0 +1,93 @@
+#ifndef SHADER_MANAGER_HPP
+#define SHADER_MANAGER_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "ShaderProgram.hpp"
+
+// Every GL program the renderer uses, by name. A program's sources are <name>.vert and
+// <name>.frag in the shader directory (usually the game's shaders folder), or the ones
+// compiled into the engine when those files don't exist.
+// Sources can #include "file" (relative to the including file, then the shader directory,
+// each file once per program) and be built with extra #defines.
+// Linked programs are kept on disk in the driver's binary format (cache/<name>.progbin),
+// keyed by the expanded sources and the driver, so a warm start skips compiling.
+// Programs built from files are rebuilt when any of them changes.
+class ShaderManager {
+public:
+    ShaderManager() = default;
+    ~ShaderManager();
+
+    ShaderManager(const ShaderManager&) = delete;
+    ShaderManager& operator=(const ShaderManager&) = delete;
+
+    // Programs already loaded are rebuilt from the new directory
+    void setDirectory(const std::string& directory);
+    // Sources to use when the shader directory has none for this program
+    void registerBuiltin(const std::string& name, const char* vertexSource, const char* fragmentSource);
+
+    // Applied to every program each time it's linked, GLSL 3.30 can't set these itself
+    void setUniformBlockBinding(const std::string& block, GLuint binding);
+    void setSamplerUnit(const std::string& sampler, GLint unit);
+
+    // The program built with these defines ("NAME" or "NAME VALUE"), building it the first
+    // time. The pointer stays valid across reloads until cleanup(). nullptr when it fails.
+    ShaderProgram* load(const std::string& name, const std::vector<std::string>& defines = {});
+
+    // Rebuild programs whose files changed, looking at the disk at most twice a second.
+    // A program that fails to build keeps its old version. Returns how many were rebuilt.
+    size_t reloadChanged();
+    void setHotReload(bool enabled) { hotReload = enabled; }
+
+    // Expand #includes and add defines after #version. #line directives keep compiler
+    // errors pointing at the right line, source string N is files[N] (files[0] is
+    // sourcePath, or empty for a built-in source). Any file it reads is added to files.
+    bool preprocess(const std::string& source, const std::filesystem::path& sourcePath,
+                    const std::vector<std::string>& defines, std::string& out,
+                    std::vector<std::filesystem::path>& files) const;
+
+    void cleanup();
+
+private:
+    struct Builtin {
+        std::string name;
+        std::string vertexSource;
+        std::string fragmentSource;
+    };
+
+    struct SourceFile {
+        std::filesystem::path path;
+        std::filesystem::file_time_type modified;
+    };
+
+    struct Program {
+        std::string name;
+        std::vector<std::string> defines;
+        ShaderProgram program;
+        std::vector<SourceFile> files; // Everything the sources were read from, includes too
+    };
+
+    bool build(Program& entry);
+    bool expand(const std::string& source, const std::filesystem::path& sourcePath, size_t sourceIndex,
+                std::vector<std::filesystem::path>& files, std::string& out) const;
+    void applyBindings(const ShaderProgram& program) const;
+    std::string cachePathFor(const Program& entry) const;
+    uint64_t computeKey(const std::string& vertexSource, const std::string& fragmentSource);
+
+    std::filesystem::path directory;
+    std::vector<Builtin> builtins;
+    std::vector<std::unique_ptr<Program>> programs;
+    std::vector<std::pair<std::string, GLuint>> blockBindings;
+    std::vector<std::pair<std::string, GLint>> samplerUnits;
+    std::string driver; // Vendor, renderer and version, binaries only load on the driver that made them
+    bool hotReload = true;
+    std::chrono::steady_clock::time_point lastPoll;
+};
+
+#endif // SHADER_MANAGER_HPP
@@ -0,0 +1,198 @@
+#include "ShaderProgram.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include "../logging/Logger.hpp"
+
+namespace {
+
+GLuint compileShader(const std::string& programName, GLenum stage, const char* source) {
+    GLuint shader = glCreateShader(stage);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+
+    GLint success = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+    if (!success) {
+        GLint length = 0;
+        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+        std::string log(length > 0 ? length : 1, '\0');
+        glGetShaderInfoLog(shader, static_cast<GLsizei>(log.size()), NULL, log.data());
+        LOG_ERROR(LogCategory::Render, programName << ": " << (stage == GL_VERTEX_SHADER ? "vertex" : "fragment")
+                  << " shader failed: " << log.c_str());
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+// "lights[0]" is how arrays come back from glGetActiveUniform
+std::string stripArraySuffix(const char* name) {
+    std::string plain(name);
+    size_t bracket = plain.find('[');
+    if (bracket != std::string::npos) {
+        plain.resize(bracket);
+    }
+    return plain;
+}
+
+} // namespace
+
+ShaderProgram::~ShaderProgram() {
+    destroy();
+}
+
+bool ShaderProgram::build(const std::string& name, const char* vertexSource, const char* fragmentSource) {
+    this->name = name;
+    GLuint vertexShader = compileShader(name, GL_VERTEX_SHADER, vertexSource);
+    if (!vertexShader) {
+        return false;
+    }
+    GLuint fragmentShader = compileShader(name, GL_FRAGMENT_SHADER, fragmentSource);
+    if (!fragmentShader) {
+        glDeleteShader(vertexShader);
+        return false;
+    }
+
+    GLuint linked = glCreateProgram();
+    if (GLEW_ARB_get_program_binary) {
+        glProgramParameteri(linked, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+    glAttachShader(linked, vertexShader);
+    glAttachShader(linked, fragmentShader);
+    glLinkProgram(linked);
+    glDetachShader(linked, vertexShader);
+    glDetachShader(linked, fragmentShader);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    if (!checkLinked(linked)) {
+        return false;
+    }
+    adopt(linked);
+    return true;
+}
+
+bool ShaderProgram::loadBinary(const std::string& name, GLenum format, const void* data, size_t size) {
+    if (!GLEW_ARB_get_program_binary) {
+        return false;
+    }
+    this->name = name;
+    GLuint linked = glCreateProgram();
+    glProgramBinary(linked, format, data, static_cast<GLsizei>(size));
+    // A rejected binary isn't an error worth logging, it just means building from source
+    GLint success = GL_FALSE;
+    glGetProgramiv(linked, GL_LINK_STATUS, &success);
+    if (!success) {
+        glDeleteProgram(linked);
+        return false;
+    }
+    adopt(linked);
+    return true;
+}
+
+bool ShaderProgram::getBinary(GLenum& format, std::vector<std::byte>& out) const {
+    if (!program || !GLEW_ARB_get_program_binary) {
+        return false;
+    }
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return false;
+    }
+    out.resize(length);
+    GLsizei written = 0;
+    glGetProgramBinary(program, length, &written, &format, out.data());
+    out.resize(written);
+    return written > 0;
+}
+
+bool ShaderProgram::checkLinked(GLuint linked) const {
+    GLint success = GL_FALSE;
+    glGetProgramiv(linked, GL_LINK_STATUS, &success);
+    if (!success) {
+        GLint length = 0;
+        glGetProgramiv(linked, GL_INFO_LOG_LENGTH, &length);
+        std::string log(length > 0 ? length : 1, '\0');
+        glGetProgramInfoLog(linked, static_cast<GLsizei>(log.size()), NULL, log.data());
+        LOG_ERROR(LogCategory::Render, name << ": shader linking failed: " << log.c_str());
+        glDeleteProgram(linked);
+        return false;
+    }
+    return true;
+}
+
+void ShaderProgram::adopt(GLuint linked) {
+    destroy();
+    program = linked;
+
+    GLint maxLength = 0;
+    GLint count = 0;
+    std::vector<GLchar> nameBuffer;
+
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+    nameBuffer.resize(std::max(maxLength, 1));
+    for (GLint i = 0; i < count; i++) {
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(program, i, maxLength, NULL, &size, &type, nameBuffer.data());
+        // Block members have no location and are set through the block's buffer
+        GLint location = glGetUniformLocation(program, nameBuffer.data());
+        if (location >= 0) {
+            uniforms[stripArraySuffix(nameBuffer.data())] = location;
+        }
+    }
+
+    glGetProgramiv(program, GL_ACTIVE_ATTRIBUTE_MAX_LENGTH, &maxLength);
+    glGetProgramiv(program, GL_ACTIVE_ATTRIBUTES, &count);
+    nameBuffer.resize(std::max(maxLength, 1));
+    for (GLint i = 0; i < count; i++) {
+        GLint size;
+        GLenum type;
+        glGetActiveAttrib(program, i, maxLength, NULL, &size, &type, nameBuffer.data());
+        attributes[nameBuffer.data()] = glGetAttribLocation(program, nameBuffer.data());
+    }
+
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxLength);
+    glGetProgramiv(program, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+    nameBuffer.resize(std::max(maxLength, 1));
+    for (GLint i = 0; i < count; i++) {
+        glGetActiveUniformBlockName(program, i, maxLength, NULL, nameBuffer.data());
+        uniformBlocks[nameBuffer.data()] = static_cast<GLuint>(i);
+    }
+}
+
+void ShaderProgram::destroy() {
+    if (program) {
+        glDeleteProgram(program);
+        program = 0;
+    }
+    uniforms.clear();
+    attributes.clear();
+    uniformBlocks.clear();
+}
+
+GLint ShaderProgram::uniformLocation(const std::string& name) const {
+    auto it = uniforms.find(name);
+    return it != uniforms.end() ? it->second : -1;
+}
+
+GLint ShaderProgram::attributeLocation(const std::string& name) const {
+    auto it = attributes.find(name);
+    return it != attributes.end() ? it->second : -1;
+}
+
+bool ShaderProgram::bindUniformBlock(const std::string& name, GLuint binding) const {
+    auto it = uniformBlocks.find(name);
+    if (it == uniformBlocks.end()) {
+        return false;
+    }
+    glUniformBlockBinding(program, it->second, binding);
+    return true;
+}
+
+void ShaderProgram::setSampler(const std::string& name, GLint unit) const {
+    glUseProgram(program);
+    glUniform1i(uniformLocation(name), unit);
+}
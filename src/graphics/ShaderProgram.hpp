@@ -0,0 +1,56 @@
+#ifndef SHADER_PROGRAM_HPP
+#define SHADER_PROGRAM_HPP
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <GL/glew.h>
+
+// A linked GL program. Every active uniform, attribute and uniform block is looked up once
+// at link time, so drawing code never calls glGetUniformLocation.
+class ShaderProgram {
+public:
+    ShaderProgram() = default;
+    ~ShaderProgram();
+
+    ShaderProgram(const ShaderProgram&) = delete;
+    ShaderProgram& operator=(const ShaderProgram&) = delete;
+
+    // Compile and link, replacing the current program only on success. Errors are logged
+    // with name in front of them.
+    bool build(const std::string& name, const char* vertexSource, const char* fragmentSource);
+    // Same, from a binary getBinary returned earlier. Fails when the driver no longer
+    // accepts it (it was updated, or it's a different GPU), the caller then builds from source.
+    bool loadBinary(const std::string& name, GLenum format, const void* data, size_t size);
+    // The linked program in the driver's own format. False without ARB_get_program_binary.
+    bool getBinary(GLenum& format, std::vector<std::byte>& out) const;
+    void destroy();
+
+    bool isValid() const { return program != 0; }
+    GLuint getID() const { return program; }
+    void use() const { glUseProgram(program); }
+
+    // -1 when the program has no active uniform or attribute by that name (the compiler
+    // drops ones that aren't used). Array uniforms are found by their plain name.
+    GLint uniformLocation(const std::string& name) const;
+    GLint attributeLocation(const std::string& name) const;
+
+    // Point a uniform block at a glBindBufferBase/glBindBufferRange binding. False when the
+    // program has no such block.
+    bool bindUniformBlock(const std::string& name, GLuint binding) const;
+    // Point a sampler uniform at a texture unit, binds the program
+    void setSampler(const std::string& name, GLint unit) const;
+
+private:
+    bool checkLinked(GLuint linked) const;
+    void adopt(GLuint linked);
+
+    std::string name;
+    GLuint program = 0;
+    std::unordered_map<std::string, GLint> uniforms;
+    std::unordered_map<std::string, GLint> attributes;
+    std::unordered_map<std::string, GLuint> uniformBlocks;
+};
+
+#endif // SHADER_PROGRAM_HPP
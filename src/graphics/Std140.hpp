@@ -0,0 +1,142 @@
+#ifndef STD140_HPP
+#define STD140_HPP
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// CPU side of GLSL std140 uniform blocks. Members are written in declaration order and
+// land at the offsets the GL computes, so no C++ mirror struct with hand-placed padding
+// is needed. Header only and constexpr, the rules are checked by the static_asserts below
+// and the bytes Std140Writer places by tools/std140_check.
+//
+// std140 in short: scalars align to 4, vec2 to 8, vec3 and vec4 to 16. Array elements and
+// matrix columns are padded out to 16 each. The block's size rounds up to 16.
+
+enum class Std140Type {
+    Float,
+    Int,
+    Vec2,
+    Vec3,
+    Vec4,
+    Mat3,
+    Mat4,
+};
+
+constexpr size_t std140Align(Std140Type type, bool inArray = false) {
+    if (inArray) {
+        return 16;
+    }
+    switch (type) {
+        case Std140Type::Float:
+        case Std140Type::Int:
+            return 4;
+        case Std140Type::Vec2:
+            return 8;
+        default:
+            return 16;
+    }
+}
+
+// Bytes one element takes up, not counting padding before the next member
+constexpr size_t std140Size(Std140Type type) {
+    switch (type) {
+        case Std140Type::Float:
+        case Std140Type::Int:
+            return 4;
+        case Std140Type::Vec2:
+            return 8;
+        case Std140Type::Vec3:
+            return 12;
+        case Std140Type::Vec4:
+            return 16;
+        case Std140Type::Mat3:
+            return 3 * 16;
+        case Std140Type::Mat4:
+            return 4 * 16;
+    }
+    return 0;
+}
+
+constexpr size_t std140RoundUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+// Offsets of a block's members, added in declaration order
+class Std140Layout {
+public:
+    // Offset of the new member. arrayCount 0 is a plain member, otherwise an array.
+    constexpr size_t add(Std140Type type, size_t arrayCount = 0) {
+        bool isArray = arrayCount > 0;
+        size_t offset = std140RoundUp(end, std140Align(type, isArray));
+        size_t stride = isArray ? std140RoundUp(std140Size(type), 16) : std140Size(type);
+        end = offset + stride * (isArray ? arrayCount : 1);
+        return offset;
+    }
+
+    // Size of the whole block, what glBufferData and glBindBufferRange need
+    constexpr size_t size() const { return std140RoundUp(end, 16); }
+
+private:
+    size_t end = 0;
+};
+
+// Writes members into a byte buffer at their std140 offsets
+class Std140Writer {
+public:
+    explicit Std140Writer(std::byte* out) : out(out) {}
+
+    void write(float value) { put(Std140Type::Float, &value, sizeof(value)); }
+    void write(int32_t value) { put(Std140Type::Int, &value, sizeof(value)); }
+    void write(const glm::vec2& value) { put(Std140Type::Vec2, &value, sizeof(value)); }
+    void write(const glm::vec3& value) { put(Std140Type::Vec3, &value, sizeof(value)); }
+    void write(const glm::vec4& value) { put(Std140Type::Vec4, &value, sizeof(value)); }
+    void write(const glm::mat3& value) {
+        size_t offset = layout.add(Std140Type::Mat3);
+        for (int column = 0; column < 3; column++) {
+            std::memcpy(out + offset + column * 16, &value[column], sizeof(glm::vec3));
+        }
+    }
+    void write(const glm::mat4& value) { put(Std140Type::Mat4, &value, sizeof(value)); }
+
+    size_t size() const { return layout.size(); }
+
+private:
+    void put(Std140Type type, const void* data, size_t bytes) {
+        std::memcpy(out + layout.add(type), data, bytes);
+    }
+
+    std::byte* out;
+    Std140Layout layout;
+};
+
+namespace std140_checks {
+
+// Offsets worked out by hand from the rules in the GL 4.5 spec, section 7.6.2.2
+constexpr bool mixedScalarsAndVectors() {
+    Std140Layout layout;
+    return layout.add(Std140Type::Float) == 0 &&       // float a
+           layout.add(Std140Type::Vec2) == 8 &&        // vec2 b
+           layout.add(Std140Type::Vec3) == 16 &&       // vec3 c
+           layout.add(Std140Type::Float) == 28 &&      // float d, packs after the vec3
+           layout.add(Std140Type::Float, 2) == 32 &&   // float e[2], 16-byte stride
+           layout.add(Std140Type::Mat3) == 64 &&       // mat3 f
+           layout.add(Std140Type::Vec2) == 112 &&      // vec2 g
+           layout.size() == 128;
+}
+static_assert(mixedScalarsAndVectors(), "std140 scalar or vector layout is off");
+
+constexpr bool matricesAndArrays() {
+    Std140Layout layout;
+    return layout.add(Std140Type::Vec3) == 0 &&
+           layout.add(Std140Type::Mat4) == 16 &&       // Matrices start on 16
+           layout.add(Std140Type::Vec2, 3) == 80 &&    // vec2[3] still pads each element to 16
+           layout.add(Std140Type::Int) == 128 &&
+           layout.size() == 144;
+}
+static_assert(matricesAndArrays(), "std140 matrix or array layout is off");
+
+} // namespace std140_checks
+
+#endif // STD140_HPP
@@ -0,0 +1,341 @@
+#include "TextureCache.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "../io/AtomicFile.hpp"
+#include "../io/ContentHash.hpp"
+#include "../logging/Logger.hpp"
+#include "../profiling/Profiler.hpp"
+
+namespace {
+
+const char CACHE_MAGIC[4] = {'T', 'T', 'E', 'X'};
+const uint32_t CACHE_VERSION = 1;
+const size_t CACHE_ALIGNMENT = 16;
+const size_t MAX_LEVELS = 16; // 32768x32768
+
+// File layout: header, one entry per mip level, then the levels largest first
+struct CacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;
+    uint32_t format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t levelCount;
+};
+static_assert(sizeof(CacheHeader) == 32, "Texture cache header must stay 32 bytes");
+
+struct LevelEntry {
+    uint64_t offset;
+    uint32_t size;
+    uint32_t reserved;
+};
+static_assert(sizeof(LevelEntry) == 16, "Texture cache level entry must stay 16 bytes");
+
+
+size_t levelSize(TextureFormat format, uint32_t width, uint32_t height) {
+    if (format == TextureFormat::BC1) {
+        return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * 8;
+    }
+    return static_cast<size_t>(width) * height * 4;
+}
+
+uint16_t packRGB565(const float color[3]) {
+    auto channel = [](float value, int maxValue) {
+        return static_cast<uint16_t>(std::clamp(static_cast<int>(value / 255.0f * maxValue + 0.5f), 0, maxValue));
+    };
+    return static_cast<uint16_t>((channel(color[0], 31) << 11) | (channel(color[1], 63) << 5) | channel(color[2], 31));
+}
+
+void unpackRGB565(uint16_t packed, int out[3]) {
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    out[0] = (r << 3) | (r >> 2);
+    out[1] = (g << 2) | (g >> 4);
+    out[2] = (b << 3) | (b >> 2);
+}
+
+// Half the size in each dimension, 2x2 box filter. An odd last row or column is
+// folded into its neighbour's box by clamping.
+std::vector<std::byte> downsample(const std::vector<std::byte>& source, uint32_t width, uint32_t height) {
+    uint32_t newWidth = std::max(width / 2, 1u);
+    uint32_t newHeight = std::max(height / 2, 1u);
+    std::vector<std::byte> result(static_cast<size_t>(newWidth) * newHeight * 4);
+    const unsigned char* src = reinterpret_cast<const unsigned char*>(source.data());
+    unsigned char* dst = reinterpret_cast<unsigned char*>(result.data());
+    for (uint32_t y = 0; y < newHeight; y++) {
+        uint32_t y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+        for (uint32_t x = 0; x < newWidth; x++) {
+            uint32_t x0 = std::min(x * 2, width - 1), x1 = std::min(x * 2 + 1, width - 1);
+            for (int c = 0; c < 4; c++) {
+                unsigned sum = src[(y0 * width + x0) * 4 + c] + src[(y0 * width + x1) * 4 + c] +
+                               src[(y1 * width + x0) * 4 + c] + src[(y1 * width + x1) * 4 + c];
+                dst[(static_cast<size_t>(y) * newWidth + x) * 4 + c] = static_cast<unsigned char>((sum + 2) / 4);
+            }
+        }
+    }
+    return result;
+}
+
+std::vector<std::byte> compressBC1(const std::vector<std::byte>& pixels, uint32_t width, uint32_t height) {
+    uint32_t blocksWide = (width + 3) / 4;
+    uint32_t blocksHigh = (height + 3) / 4;
+    std::vector<std::byte> result(static_cast<size_t>(blocksWide) * blocksHigh * 8);
+    const unsigned char* src = reinterpret_cast<const unsigned char*>(pixels.data());
+    unsigned char block[16 * 4];
+    for (uint32_t by = 0; by < blocksHigh; by++) {
+        for (uint32_t bx = 0; bx < blocksWide; bx++) {
+            // Blocks hanging over the edge repeat the last row and column
+            for (uint32_t py = 0; py < 4; py++) {
+                uint32_t y = std::min(by * 4 + py, height - 1);
+                for (uint32_t px = 0; px < 4; px++) {
+                    uint32_t x = std::min(bx * 4 + px, width - 1);
+                    std::memcpy(&block[(py * 4 + px) * 4], &src[(static_cast<size_t>(y) * width + x) * 4], 4);
+                }
+            }
+            encodeBC1Block(block, 4, &result[(static_cast<size_t>(by) * blocksWide + bx) * 8]);
+        }
+    }
+    return result;
+}
+
+bool isOpaque(const unsigned char* rgba, size_t pixelCount) {
+    for (size_t i = 0; i < pixelCount; i++) {
+        if (rgba[i * 4 + 3] != 255) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+size_t CookedTexture::totalSize() const {
+    size_t size = 0;
+    for (const auto& level : levels) {
+        size += level.size();
+    }
+    return size;
+}
+
+std::vector<TextureLevel> CookedTexture::levelViews() const {
+    std::vector<TextureLevel> views;
+    uint32_t levelWidth = width, levelHeight = height;
+    for (const auto& level : levels) {
+        views.push_back({levelWidth, levelHeight, level.data(), level.size()});
+        levelWidth = std::max(levelWidth / 2, 1u);
+        levelHeight = std::max(levelHeight / 2, 1u);
+    }
+    return views;
+}
+
+void encodeBC1Block(const unsigned char* rgba, size_t stride, std::byte out[8]) {
+    float pixels[16][3];
+    float mean[3] = {0.0f, 0.0f, 0.0f};
+    for (int i = 0; i < 16; i++) {
+        const unsigned char* pixel = rgba + ((i / 4) * stride + i % 4) * 4;
+        for (int c = 0; c < 3; c++) {
+            pixels[i][c] = pixel[c];
+            mean[c] += pixel[c] / 16.0f;
+        }
+    }
+
+    // Endpoints are the pixels furthest apart along the block's principal axis,
+    // found with a few rounds of power iteration on the colour covariance
+    float covariance[6] = {};
+    for (const auto& pixel : pixels) {
+        float d[3] = {pixel[0] - mean[0], pixel[1] - mean[1], pixel[2] - mean[2]};
+        covariance[0] += d[0] * d[0]; covariance[1] += d[0] * d[1]; covariance[2] += d[0] * d[2];
+        covariance[3] += d[1] * d[1]; covariance[4] += d[1] * d[2]; covariance[5] += d[2] * d[2];
+    }
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+    for (int iteration = 0; iteration < 4; iteration++) {
+        float next[3] = {
+            covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2],
+            covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2],
+            covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2],
+        };
+        float length = std::max({std::abs(next[0]), std::abs(next[1]), std::abs(next[2])});
+        if (length <= 0.0f) {
+            break;
+        }
+        for (int c = 0; c < 3; c++) {
+            axis[c] = next[c] / length;
+        }
+    }
+    int minPixel = 0, maxPixel = 0;
+    float minProjection = INFINITY, maxProjection = -INFINITY;
+    for (int i = 0; i < 16; i++) {
+        float projection = pixels[i][0] * axis[0] + pixels[i][1] * axis[1] + pixels[i][2] * axis[2];
+        if (projection < minProjection) {
+            minProjection = projection;
+            minPixel = i;
+        }
+        if (projection > maxProjection) {
+            maxProjection = projection;
+            maxPixel = i;
+        }
+    }
+
+    uint16_t color0 = packRGB565(pixels[maxPixel]);
+    uint16_t color1 = packRGB565(pixels[minPixel]);
+    if (color0 < color1) {
+        std::swap(color0, color1); // color0 > color1 selects the four colour mode
+    }
+    uint32_t selectors = 0;
+    if (color0 != color1) {
+        int palette[4][3];
+        unpackRGB565(color0, palette[0]);
+        unpackRGB565(color1, palette[1]);
+        for (int c = 0; c < 3; c++) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        for (int i = 0; i < 16; i++) {
+            uint32_t best = 0;
+            float bestDistance = INFINITY;
+            for (uint32_t entry = 0; entry < 4; entry++) {
+                float distance = 0.0f;
+                for (int c = 0; c < 3; c++) {
+                    float d = pixels[i][c] - palette[entry][c];
+                    distance += d * d;
+                }
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    best = entry;
+                }
+            }
+            selectors |= best << (i * 2);
+        }
+    }
+
+    // Little-endian: both endpoints, then two selector bits per pixel in row order
+    uint8_t bytes[8] = {
+        static_cast<uint8_t>(color0), static_cast<uint8_t>(color0 >> 8),
+        static_cast<uint8_t>(color1), static_cast<uint8_t>(color1 >> 8),
+        static_cast<uint8_t>(selectors), static_cast<uint8_t>(selectors >> 8),
+        static_cast<uint8_t>(selectors >> 16), static_cast<uint8_t>(selectors >> 24),
+    };
+    std::memcpy(out, bytes, sizeof(bytes));
+}
+
+CookedTexture cookTexture(const unsigned char* rgba, uint32_t width, uint32_t height, bool compress) {
+    PROFILE_FUNCTION();
+    CookedTexture texture;
+    texture.width = width;
+    texture.height = height;
+    if (width == 0 || height == 0) {
+        return texture;
+    }
+    bool useBC1 = compress && isOpaque(rgba, static_cast<size_t>(width) * height);
+    texture.format = useBC1 ? TextureFormat::BC1 : TextureFormat::RGBA8;
+
+    // Each level is filtered from the one above it, compression happens last so errors don't add up
+    std::vector<std::byte> pixels(reinterpret_cast<const std::byte*>(rgba),
+                                  reinterpret_cast<const std::byte*>(rgba) + static_cast<size_t>(width) * height * 4);
+    uint32_t levelWidth = width, levelHeight = height;
+    while (true) {
+        texture.levels.push_back(useBC1 ? compressBC1(pixels, levelWidth, levelHeight) : pixels);
+        if (levelWidth == 1 && levelHeight == 1) {
+            break;
+        }
+        pixels = downsample(pixels, levelWidth, levelHeight);
+        levelWidth = std::max(levelWidth / 2, 1u);
+        levelHeight = std::max(levelHeight / 2, 1u);
+    }
+    return texture;
+}
+
+uint64_t TextureCache::computeKey(const void* sourceData, size_t sourceSize, bool compress) {
+    uint32_t settings[2] = {TEXTURE_COOKER_VERSION, compress ? 1u : 0u};
+    uint64_t key = hashContent(sourceData, sourceSize);
+    key = hashContent(settings, sizeof(settings), key);
+    return key ? key : 1;
+}
+
+bool TextureCache::open(const std::string& cachePath, uint64_t key) {
+    close();
+    if (key == 0 || !file.open(cachePath)) {
+        return false;
+    }
+
+    auto reject = [&](const char* reason) {
+        LOG_DEBUG(LogCategory::Texture, "Ignoring texture cache " << cachePath << " (" << reason << ")");
+        close();
+        return false;
+    };
+
+    if (file.size() < sizeof(CacheHeader)) {
+        return reject("truncated");
+    }
+    CacheHeader header;
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (std::memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION) {
+        return reject("unknown format");
+    }
+    if (header.key != key) {
+        return reject("stale");
+    }
+    if (header.format > static_cast<uint32_t>(TextureFormat::BC1) || header.width == 0 || header.height == 0 ||
+        header.levelCount == 0 || header.levelCount > MAX_LEVELS) {
+        return reject("damaged");
+    }
+
+    size_t tableEnd = sizeof(CacheHeader) + header.levelCount * sizeof(LevelEntry);
+    if (file.size() < tableEnd) {
+        return reject("truncated");
+    }
+    textureFormat = static_cast<TextureFormat>(header.format);
+    uint32_t width = header.width, height = header.height;
+    for (uint32_t i = 0; i < header.levelCount; i++) {
+        LevelEntry entry;
+        std::memcpy(&entry, file.data() + sizeof(CacheHeader) + i * sizeof(LevelEntry), sizeof(entry));
+        if (entry.size != levelSize(textureFormat, width, height) || entry.offset < tableEnd ||
+            entry.offset > file.size() || entry.size > file.size() - entry.offset) {
+            return reject("damaged");
+        }
+        levelTable.push_back({width, height, file.data() + entry.offset, entry.size});
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+    }
+    return true;
+}
+
+void TextureCache::close() {
+    levelTable.clear();
+    file.close();
+}
+
+bool TextureCache::write(const std::string& cachePath, uint64_t key, const CookedTexture& texture) {
+    if (key == 0 || texture.levels.empty() || texture.levels.size() > MAX_LEVELS) {
+        return false;
+    }
+
+    CacheHeader header = {};
+    std::memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    header.version = CACHE_VERSION;
+    header.key = key;
+    header.format = static_cast<uint32_t>(texture.format);
+    header.width = texture.width;
+    header.height = texture.height;
+    header.levelCount = static_cast<uint32_t>(texture.levels.size());
+
+    std::vector<LevelEntry> table(texture.levels.size());
+    std::vector<FileBlob> blobs;
+    size_t offset = alignFileOffset(sizeof(CacheHeader) + table.size() * sizeof(LevelEntry), CACHE_ALIGNMENT);
+    for (size_t i = 0; i < texture.levels.size(); i++) {
+        table[i] = {offset, static_cast<uint32_t>(texture.levels[i].size()), 0};
+        blobs.push_back({texture.levels[i].data(), texture.levels[i].size()});
+        offset = alignFileOffset(offset + texture.levels[i].size(), CACHE_ALIGNMENT);
+    }
+
+    if (!writeFileAtomically(cachePath, &header, sizeof(header), table.data(), table.size() * sizeof(LevelEntry),
+                             blobs, CACHE_ALIGNMENT)) {
+        LOG_WARNING(LogCategory::Texture, "Failed to write texture cache " << cachePath);
+        return false;
+    }
+    LOG_DEBUG(LogCategory::Texture, "Wrote texture cache " << cachePath << " (" << offset / 1024 << " KiB)");
+    return true;
+}
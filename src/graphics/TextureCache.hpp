@@ -0,0 +1,73 @@
+#ifndef TEXTURE_CACHE_HPP
+#define TEXTURE_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "../io/MappedFile.hpp"
+
+// Cooked textures stored next to their source image (<image>.ttex), with every mip
+// level already built and optionally BC1 compressed. The cache is keyed by a hash of
+// the source file's bytes, so loading it skips PNG decode and mip generation entirely.
+// Anything that doesn't match is ignored and cooked again.
+
+// Bumped whenever cooking the same image gives different output
+const uint32_t TEXTURE_COOKER_VERSION = 1;
+
+enum class TextureFormat : uint32_t {
+    RGBA8 = 0,
+    BC1 = 1, // 4x4 blocks of 8 bytes, opaque RGB only
+};
+
+struct TextureLevel {
+    uint32_t width;
+    uint32_t height;
+    const std::byte* data;
+    size_t size;
+};
+
+// Output of cookTexture, ready for TextureCache::write
+struct CookedTexture {
+    TextureFormat format = TextureFormat::RGBA8;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<std::vector<std::byte>> levels; // [0] is full size, down to 1x1
+
+    size_t totalSize() const;
+    std::vector<TextureLevel> levelViews() const;
+};
+
+// Build the full mip chain of RGBA8 pixels with a box filter, then compress each level
+// to BC1 if asked and every pixel is opaque (BC1 can't keep alpha, RGBA8 is used instead).
+CookedTexture cookTexture(const unsigned char* rgba, uint32_t width, uint32_t height, bool compress);
+
+// One 4x4 block of RGBA8 pixels (row stride in pixels) to 8 bytes of BC1
+void encodeBC1Block(const unsigned char* rgba, size_t stride, std::byte out[8]);
+
+class TextureCache {
+public:
+    static std::string pathFor(const std::string& sourcePath) { return sourcePath + ".ttex"; }
+
+    // Hash of the source file's bytes and the cooker settings
+    static uint64_t computeKey(const void* sourceData, size_t sourceSize, bool compress);
+
+    // Map 'cachePath' and check it was cooked from a source with 'key'. Returns false if
+    // the file is missing, damaged or stale.
+    bool open(const std::string& cachePath, uint64_t key);
+    bool isOpen() const { return file.isOpen(); }
+    void close();
+
+    TextureFormat format() const { return textureFormat; }
+    // Largest first, pointing into the mapping and valid until close()
+    const std::vector<TextureLevel>& levels() const { return levelTable; }
+
+    static bool write(const std::string& cachePath, uint64_t key, const CookedTexture& texture);
+
+private:
+    MappedFile file;
+    TextureFormat textureFormat = TextureFormat::RGBA8;
+    std::vector<TextureLevel> levelTable;
+};
+
+#endif // TEXTURE_CACHE_HPP
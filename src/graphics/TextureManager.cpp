@@ -1,10 +1,33 @@
 #include "TextureManager.hpp"
-#include <iostream>
+#include "../ThreadPool.hpp"
+#include "../io/MappedFile.hpp"
+#include "../logging/Logger.hpp"
+#include "../profiling/Profiler.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
-TextureManager::TextureManager() : defaultTexture(0) {
+namespace {
+
+const size_t STAGING_ALIGNMENT = 16;
+
+size_t alignStagingOffset(size_t offset) {
+    return (offset + STAGING_ALIGNMENT - 1) & ~(STAGING_ALIGNMENT - 1);
+}
+
+} // namespace
+
+TextureManager::TextureManager() : decoded(std::make_shared<DecodedQueue>()), defaultTexture(0) {
+    compressTextures = GLEW_EXT_texture_compression_s3tc;
+    if (!compressTextures) {
+        LOG_INFO(LogCategory::Texture, "S3TC not supported, textures stay uncompressed");
+    }
+    // stb_image keeps this in a global, set it once here rather than racing on it from the workers
+    stbi_set_flip_vertically_on_load(true); // OpenGL expects texture origin at bottom-left
     createDefaultTexture();
 }
 
@@ -17,91 +40,369 @@ void TextureManager::createDefaultTexture() {
     unsigned char whitePixel[4] = {255, 255, 255, 255};
     
     glGenTextures(1, &defaultTexture);
-    glBindTexture(GL_TEXTURE_2D, defaultTexture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, whitePixel);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, defaultTexture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA, 1, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, whitePixel);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    textures.push_back({defaultTexture, true});
 
-    std::cout << "TextureManager: Created default texture (ID: " << defaultTexture << ")" << std::endl;
+    LOG_INFO(LogCategory::Texture, "Created default texture (ID: " << defaultTexture << ")");
 }
 
-GLuint TextureManager::loadTextureFromFile(const std::string& filepath) {
-    std::cout << "TextureManager: Loading " << filepath << std::endl;
+std::unique_ptr<TextureManager::DecodedTexture> TextureManager::decodeTexture(TextureHandle handle, const std::string& filepath,
+                                                                              bool compress) {
+    PROFILE_ZONE("TextureManager::decodeTexture");
+    auto result = std::make_unique<DecodedTexture>();
+    result->handle = handle;
+    result->path = filepath;
+
+    // The cache is keyed by the source bytes, hashing them is far cheaper than decoding
+    MappedFile source;
+    if (!source.open(filepath)) {
+        LOG_ERROR(LogCategory::Texture, "Failed to load texture: " << filepath << " (can't open file)");
+        result->failed = true;
+        return result;
+    }
+    uint64_t key = TextureCache::computeKey(source.data(), source.size(), compress);
+    std::string cachePath = TextureCache::pathFor(filepath);
+
+    if (result->cache.open(cachePath, key)) {
+        result->format = result->cache.format();
+        result->levels = result->cache.levels();
+        return result;
+    }
 
     int width, height, channels;
-    stbi_set_flip_vertically_on_load(true); // OpenGL expects texture origin at bottom-left
-    unsigned char* data = stbi_load(filepath.c_str(), &width, &height, &channels, 0);
-    
+    unsigned char* data = stbi_load_from_memory(reinterpret_cast<const stbi_uc*>(source.data()),
+                                                static_cast<int>(source.size()), &width, &height, &channels, 4);
+
     if (!data) {
-        std::cerr << "TextureManager: Failed to load texture: " << filepath << std::endl;
-        std::cerr << "STB Error: " << stbi_failure_reason() << std::endl;
-        return 0;
-    }
-    
-    GLenum format;
-    if (channels == 1)
-        format = GL_RED;
-    else if (channels == 3)
-        format = GL_RGB;
-    else if (channels == 4)
-        format = GL_RGBA;
-    else {
-        std::cerr << "TextureManager: Unsupported channel count: " << channels << std::endl;
-        stbi_image_free(data);
-        return 0;
+        LOG_ERROR(LogCategory::Texture, "Failed to load texture: " << filepath << " (" << stbi_failure_reason() << ")");
+        result->failed = true;
+        return result;
     }
-    
-    GLuint textureID;
-    glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    
-    glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-    glGenerateMipmap(GL_TEXTURE_2D);
-    
-    // Set texture parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    
-    glBindTexture(GL_TEXTURE_2D, 0);
-    stbi_image_free(data);
 
-    std::cout << "TextureManager:   Loaded successfully (ID: " << textureID
-              << ", " << width << "x" << height << ", " << channels << " channels)" << std::endl;
+    // Cooked from RGBA whatever the source had, grey and RGB images expand on decode
+    result->cooked = cookTexture(data, static_cast<uint32_t>(width), static_cast<uint32_t>(height), compress);
+    stbi_image_free(data);
+    result->format = result->cooked.format;
+    result->levels = result->cooked.levelViews();
+    // The texture stays around for streaming, so swap the pixels for the mapped cache when it was written
+    if (TextureCache::write(cachePath, key, result->cooked) && result->cache.open(cachePath, key)) {
+        result->levels = result->cache.levels();
+        result->cooked = CookedTexture();
+    }
 
-    return textureID;
+    LOG_DEBUG(LogCategory::Texture, "Cooked " << filepath << " (" << width << "x" << height << ", " << channels
+                                    << " channels, " << result->levels.size() << " levels)");
+    return result;
 }
 
-GLuint TextureManager::loadMaterialTexture(const std::string& materialName, const std::string& materialsBasePath) {
-    // Check if already loaded
-    auto it = textureCache.find(materialName);
-    if (it != textureCache.end()) {
-        std::cout << "TextureManager: Using cached texture for " << materialName << std::endl;
+TextureHandle TextureManager::requestMaterialTexture(const std::string& materialName, const std::string& materialsBasePath) {
+    // Check if already requested
+    auto it = handlesByMaterial.find(materialName);
+    if (it != handlesByMaterial.end()) {
+        LOG_TRACE(LogCategory::Texture, "Using cached texture for " << materialName);
         return it->second;
     }
-    
+
     // Build path: materialsBasePath/material_name/albedo.png
     std::string texturePath = materialsBasePath + "/" + materialName + "/albedo.png";
+
+    TextureHandle handle{static_cast<uint32_t>(textures.size())};
+    textures.push_back({defaultTexture, false});
+    handlesByMaterial[materialName] = handle;
+    decodesInFlight++;
+    pendingCount++;
+
+    std::shared_ptr<DecodedQueue> queue = decoded;
+    bool compress = compressTextures;
+    getThreadPool().submit([queue, handle, texturePath, compress]() {
+        std::unique_ptr<DecodedTexture> texture = decodeTexture(handle, texturePath, compress);
+        std::lock_guard<std::mutex> lock(queue->mutex);
+        queue->textures.push_back(std::move(texture));
+    });
+    return handle;
+}
+
+void TextureManager::requestDetail(TextureHandle handle, float uvPerPixel) {
+    const TextureEntry& entry = textures[handle.index];
+    if (entry.residencyID == TextureResidency::INVALID) {
+        return;
+    }
+    // Level n has 1/2^n of the full size's texels, the coarsest one with at least a texel per pixel is enough
+    const TextureLevel& full = entry.source->levels[0];
+    float texelsPerPixel = uvPerPixel * static_cast<float>(std::max(full.width, full.height));
+    uint32_t level = texelsPerPixel > 1.0f ? static_cast<uint32_t>(std::log2(texelsPerPixel)) : 0;
+    residency.requestLevel(entry.residencyID, level);
+}
+
+void TextureManager::dropLevels(TextureEntry& entry, uint32_t residentLevel, uint32_t targetLevel) {
+    if (targetLevel >= entry.source->levels.size()) {
+        glDeleteTextures(1, &entry.textureID);
+        entry.textureID = defaultTexture;
+        entry.ready = false;
+    } else {
+        // Sampling stops at the new base level, then the finer levels are respecified empty so
+        // the driver can release them without the coarser ones being uploaded again
+        glBindTexture(GL_TEXTURE_2D_ARRAY, entry.textureID);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(targetLevel));
+        for (uint32_t level = residentLevel; level < targetLevel; level++) {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, static_cast<GLint>(level), GL_RGBA8, 0, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    }
+    residency.setResidentLevel(entry.residencyID, targetLevel);
+}
+
+size_t TextureManager::processUploads(size_t byteBudget) {
+    PROFILE_FUNCTION();
+
+    // Newly decoded textures join the residency set, nothing of them is on the GPU yet
+    {
+        std::lock_guard<std::mutex> lock(decoded->mutex);
+        while (!decoded->textures.empty()) {
+            std::unique_ptr<DecodedTexture> texture = std::move(decoded->textures.front());
+            decoded->textures.pop_front();
+            decodesInFlight--;
+            TextureEntry& entry = textures[texture->handle.index];
+            if (texture->failed || texture->levels.empty()) {
+                LOG_WARNING(LogCategory::Texture, "Failed to load " << texture->path << ", using default texture");
+                entry.ready = true; // Keeps the default so we don't keep trying
+                continue;
+            }
+            std::vector<size_t> levelBytes;
+            size_t totalBytes = 0;
+            for (const TextureLevel& level : texture->levels) {
+                levelBytes.push_back(level.size);
+                totalBytes += level.size;
+            }
+            
+            // Small textures share array pages and stay resident, they're uploaded whole
+            const TextureLevel& full = texture->levels[0];
+            TexturePacker::Placement placement = packer.add(full.width, full.height, texture->format, totalBytes);
+            if (placement.page != TexturePacker::INVALID) {
+                if (placement.page == pageTextures.size()) {
+                    pageTextures.push_back(createPage(packer.getPages()[placement.page], texture->levels));
+                }
+                entry.layer = placement.layer;
+                entry.pageTexture = pageTextures[placement.page];
+                entry.source = std::move(texture);
+                packQueue.push_back(&entry - textures.data());
+                packReportDue = true;
+                continue;
+            }
+            entry.residencyID = residency.addTexture(levelBytes);
+            if (residencyOwners.size() <= entry.residencyID) {
+                residencyOwners.resize(entry.residencyID + 1);
+            }
+            residencyOwners[entry.residencyID] = texture->handle;
+            entry.source = std::move(texture);
+        }
+    }
+
+    // Drops free their memory right away, loads are collected and streamed in below
+    struct Stream {
+        TextureEntry* entry;
+        GLuint textureID;   // A new texture when nothing was resident
+        uint32_t nextLevel; // Finest level staged so far
+        uint32_t targetLevel;
+    };
+    std::vector<Stream> streams;
+    for (const TextureResidency::Change& change : residency.update()) {
+        TextureEntry& entry = textures[residencyOwners[change.id].index];
+        if (change.targetLevel > change.residentLevel) {
+            dropLevels(entry, change.residentLevel, change.targetLevel);
+        } else {
+            streams.push_back({&entry, entry.ready ? entry.textureID : 0, change.residentLevel, change.targetLevel});
+        }
+    }
+
+    // Pick the levels that fit the budget, and where each goes in the staging buffer. Every
+    // texture gets its next coarsest missing level before any gets a second one, so
+    // textures with nothing to show get something quickly.
+    struct StagedLevel {
+        GLuint textureID;
+        uint32_t level;
+        int32_t layer; // Into an array page, -1 for the texture's own single layer
+        TextureFormat format;
+        const TextureLevel* data;
+        size_t offset;
+    };
+    std::vector<StagedLevel> staged;
+    size_t stagedBytes = 0;
+    bool overBudget = false;
     
-    GLuint textureID = loadTextureFromFile(texturePath);
+    // Packed textures first, all their levels at once since they go live together
+    size_t packedDone = 0;
+    for (; packedDone < packQueue.size(); packedDone++) {
+        const TextureEntry& entry = textures[packQueue[packedDone]];
+        const DecodedTexture& source = *entry.source;
+        size_t textureBytes = 0;
+        for (const TextureLevel& level : source.levels) {
+            textureBytes = alignStagingOffset(textureBytes) + level.size;
+        }
+        if (!staged.empty() && alignStagingOffset(stagedBytes) + textureBytes > byteBudget) {
+            overBudget = true;
+            break;
+        }
+        for (size_t level = 0; level < source.levels.size(); level++) {
+            size_t offset = alignStagingOffset(stagedBytes);
+            staged.push_back({entry.pageTexture, static_cast<uint32_t>(level), static_cast<int32_t>(entry.layer),
+                              source.format, &source.levels[level], offset});
+            stagedBytes = offset + source.levels[level].size;
+        }
+    }
     
-    if (textureID != 0) {
-        textureCache[materialName] = textureID;
-        return textureID;
-    } else {
-        std::cerr << "TextureManager: Failed to load material " << materialName
-                  << ", using default texture" << std::endl;
-        textureCache[materialName] = defaultTexture; // Cache the default so we don't keep trying
-        return defaultTexture;
+    while (!overBudget) {
+        bool progress = false;
+        for (Stream& stream : streams) {
+            if (stream.nextLevel <= stream.targetLevel) {
+                continue;
+            }
+            const DecodedTexture& source = *stream.entry->source;
+            const TextureLevel& level = source.levels[stream.nextLevel - 1];
+            size_t offset = alignStagingOffset(stagedBytes);
+            if (!staged.empty() && offset + level.size > byteBudget) {
+                overBudget = true;
+                break;
+            }
+            if (stream.textureID == 0) {
+                glGenTextures(1, &stream.textureID);
+                glBindTexture(GL_TEXTURE_2D_ARRAY, stream.textureID);
+                glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(source.levels.size()) - 1);
+                glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(source.levels.size()) - 1);
+                glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+                glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+                glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+                glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            }
+            stream.nextLevel--;
+            staged.push_back({stream.textureID, stream.nextLevel, -1, source.format, &level, offset});
+            stagedBytes = offset + level.size;
+            progress = true;
+        }
+        if (!progress) {
+            break;
+        }
+    }
+
+    if (!staged.empty()) {
+        // Orphan the staging buffer so the driver never waits on last frame's copies, then
+        // let GL pull every level out of it
+        if (stagingBuffer == 0) {
+            glGenBuffers(1, &stagingBuffer);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, stagingBuffer);
+        stagingCapacity = std::max(stagingCapacity, stagedBytes);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, static_cast<GLsizeiptr>(stagingCapacity), nullptr, GL_STREAM_DRAW);
+        std::byte* mapped = static_cast<std::byte*>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, static_cast<GLsizeiptr>(stagedBytes),
+                                                                     GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+        if (mapped) {
+            for (const StagedLevel& level : staged) {
+                std::memcpy(mapped + level.offset, level.data->data, level.data->size);
+            }
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        } else {
+            // Still works without the staging buffer, GL just copies from our memory before returning
+            LOG_WARNING(LogCategory::Texture, "Failed to map the texture staging buffer, uploading directly");
+            glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        }
+
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        for (const StagedLevel& level : staged) {
+            const TextureLevel& data = *level.data;
+            const void* pixels = mapped ? reinterpret_cast<const void*>(level.offset) : static_cast<const void*>(data.data);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, level.textureID);
+            GLint mip = static_cast<GLint>(level.level);
+            bool compressed = level.format == TextureFormat::BC1;
+            if (level.layer >= 0 && compressed) {
+                glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, mip, 0, 0, level.layer, data.width, data.height, 1,
+                                          GL_COMPRESSED_RGB_S3TC_DXT1_EXT, static_cast<GLsizei>(data.size), pixels);
+            } else if (level.layer >= 0) {
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, mip, 0, 0, level.layer, data.width, data.height, 1,
+                                GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+            } else if (compressed) {
+                glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, mip, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, data.width, data.height, 1,
+                                       0, static_cast<GLsizei>(data.size), pixels);
+            } else {
+                glTexImage3D(GL_TEXTURE_2D_ARRAY, mip, GL_RGBA8, data.width, data.height, 1, 0,
+                             GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+            }
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    for (size_t i = 0; i < packedDone; i++) {
+        TextureEntry& entry = textures[packQueue[i]];
+        entry.textureID = entry.pageTexture;
+        entry.ready = true;
+        LOG_DEBUG(LogCategory::Texture, "Packed " << entry.source->path << " into array " << entry.pageTexture
+                                        << ", layer " << entry.layer);
     }
+    packQueue.erase(packQueue.begin(), packQueue.begin() + static_cast<std::ptrdiff_t>(packedDone));
+    if (packReportDue && decodesInFlight == 0 && packQueue.empty()) {
+        LOG_INFO(LogCategory::Texture, "Texture packing: " << packer.getReport().toString());
+        packReportDue = false;
+    }
+    
+    // Sampling moves down to the new levels only now that they're all submitted
+    pendingCount = decodesInFlight + packQueue.size();
+    for (const Stream& stream : streams) {
+        TextureEntry& entry = *stream.entry;
+        uint32_t residentLevel = residency.getResidentLevel(entry.residencyID);
+        if (stream.nextLevel != residentLevel) {
+            glBindTexture(GL_TEXTURE_2D_ARRAY, stream.textureID);
+            glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, static_cast<GLint>(stream.nextLevel));
+            if (!entry.ready) {
+                LOG_DEBUG(LogCategory::Texture, "Streaming in " << entry.source->path << " (ID: " << stream.textureID << ")");
+            }
+            entry.textureID = stream.textureID;
+            entry.ready = true;
+            residency.setResidentLevel(entry.residencyID, stream.nextLevel);
+        }
+        if (stream.nextLevel > stream.targetLevel) {
+            pendingCount++;
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    return stagedBytes;
+}
+
+GLuint TextureManager::createPage(const TexturePacker::Page& page, const std::vector<TextureLevel>& levels) {
+    GLuint textureID;
+    glGenTextures(1, &textureID);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+    // Storage for every layer up front, layers are filled in as textures arrive
+    for (size_t level = 0; level < levels.size(); level++) {
+        GLint mip = static_cast<GLint>(level);
+        GLsizei layers = static_cast<GLsizei>(page.capacity);
+        if (page.format == TextureFormat::BC1) {
+            glCompressedTexImage3D(GL_TEXTURE_2D_ARRAY, mip, GL_COMPRESSED_RGB_S3TC_DXT1_EXT, levels[level].width,
+                                   levels[level].height, layers, 0, static_cast<GLsizei>(levels[level].size) * layers, nullptr);
+        } else {
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, mip, GL_RGBA8, levels[level].width, levels[level].height, layers, 0,
+                         GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+        }
+    }
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(levels.size()) - 1);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    
+    LOG_DEBUG(LogCategory::Texture, "Created array page " << textureID << " (" << page.width << "x" << page.height
+                                    << ", " << page.capacity << " layers)");
+    return textureID;
 }
 
 GLuint TextureManager::getTexture(const std::string& materialName) {
-    auto it = textureCache.find(materialName);
-    if (it != textureCache.end()) {
-        return it->second;
+    auto it = handlesByMaterial.find(materialName);
+    if (it != handlesByMaterial.end() && textures[it->second.index].ready) {
+        return textures[it->second.index].textureID;
     }
     return 0;
 }
@@ -111,17 +412,41 @@ GLuint TextureManager::getDefaultTexture() {
 }
 
 void TextureManager::cleanup() {
-    for (auto& pair : textureCache) {
-        if (pair.second != defaultTexture) { // Don't delete default texture multiple times
-            glDeleteTextures(1, &pair.second);
+    // Jobs still running drop their results into the old queue, which goes away with the last of them
+    decoded = std::make_shared<DecodedQueue>();
+    if (stagingBuffer != 0) {
+        glDeleteBuffers(1, &stagingBuffer);
+        stagingBuffer = 0;
+        stagingCapacity = 0;
+    }
+
+    if (packer.getReport().texturesPacked > 0) {
+        LOG_INFO(LogCategory::Texture, "Texture packing: " << packer.getReport().toString());
+    }
+    for (const TextureEntry& entry : textures) {
+        // Don't delete default texture multiple times, pages go below
+        if (entry.textureID != defaultTexture && entry.textureID != entry.pageTexture) {
+            glDeleteTextures(1, &entry.textureID);
         }
     }
-    textureCache.clear();
-    
+    textures.clear();
+    for (GLuint page : pageTextures) {
+        glDeleteTextures(1, &page);
+    }
+    pageTextures.clear();
+    packQueue.clear();
+    packer = TexturePacker();
+    packReportDue = false;
+    handlesByMaterial.clear();
+    residency = TextureResidency(residency.getBudget());
+    residencyOwners.clear();
+    decodesInFlight = 0;
+    pendingCount = 0;
+
     if (defaultTexture != 0) {
         glDeleteTextures(1, &defaultTexture);
         defaultTexture = 0;
     }
 
-    std::cout << "TextureManager: Cleaned up all textures" << std::endl;
-}
\ No newline at end of file
+    LOG_INFO(LogCategory::Texture, "Cleaned up all textures");
+}
@@ -1,35 +1,128 @@
 #ifndef TEXTURE_MANAGER_HPP
 #define TEXTURE_MANAGER_HPP
 
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <vector>
 #include <GL/glew.h>
+#include "TextureCache.hpp"
+#include "TexturePacker.hpp"
+#include "TextureResidency.hpp"
+
+// A material texture that may still be loading. Handles stay valid until cleanup(),
+// handle 0 is the default white texture.
+// Every texture is a GL_TEXTURE_2D_ARRAY: small ones share array pages (see TexturePacker),
+// everything else is the only layer of its own array.
+struct TextureHandle {
+    uint32_t index = 0;
+};
 
 class TextureManager {
 public:
     TextureManager();
     ~TextureManager();
-    
-    // Load a texture from a material folder
+
+    // Start loading a texture from a material folder and return straight away. The image is
+    // decoded (or read from its cache) on the thread pool, then its mip levels are streamed in
+    // by processUploads as requestDetail asks for them. Until the first one is in, the
+    // handle draws as the default texture.
     // materialName: e.g. 'default', 'stone', etc.
     // materialsBasePath: e.g. '../../MyGame/materials'
-    GLuint loadMaterialTexture(const std::string& materialName, const std::string& materialsBasePath);
-    
-    // Get a texture that was already loaded (returns 0 if not found)
+    TextureHandle requestMaterialTexture(const std::string& materialName, const std::string& materialsBasePath);
+
+    // The renderer will sample this texture at about uvPerPixel texture coordinate units per
+    // screen pixel this frame, which decides the finest mip level worth keeping resident
+    void requestDetail(TextureHandle handle, float uvPerPixel);
+
+    // Apply last frame's detail requests within the memory budget: drop levels and textures
+    // that don't fit, then upload missing levels (coarsest first, through a staging pixel
+    // buffer) until about byteBudget bytes went to the GPU this call. At least one mip level
+    // is uploaded if anything is waiting. Main thread only. Returns the bytes uploaded.
+    size_t processUploads(size_t byteBudget);
+
+    // Bytes of texture data the GPU may hold, least recently used textures are evicted past it
+    void setMemoryBudget(size_t bytes) { residency.setBudget(bytes); }
+    size_t getResidentBytes() const { return residency.getResidentBytes() + packer.getReport().bytesAllocated; }
+
+    // Has mip levels on the GPU, or failed and settled on the default texture
+    bool isReady(TextureHandle handle) const { return textures[handle.index].ready; }
+    // The GL array texture to draw with right now, the default texture until the handle is ready
+    GLuint getTextureID(TextureHandle handle) const { return textures[handle.index].textureID; }
+    // Layer of that array to sample
+    uint32_t getTextureLayer(TextureHandle handle) const {
+        const TextureEntry& entry = textures[handle.index];
+        return entry.textureID == entry.pageTexture ? entry.layer : 0;
+    }
+    TexturePacker::Report getPackingReport() const { return packer.getReport(); }
+    // Textures still decoding, or streaming in levels they need
+    size_t getPendingCount() const { return pendingCount; }
+
+    // Get a texture that was already loaded (returns 0 if not found or still loading)
     GLuint getTexture(const std::string& materialName);
-    
+
     // Get a default white texture for materials that don't have textures
     GLuint getDefaultTexture();
-    
+
     // Clean up all textures
     void cleanup();
-    
+
 private:
-    std::unordered_map<std::string, GLuint> textureCache;
+    // Produced by a worker: the mip levels, pointing into either the mapped cache or
+    // freshly cooked pixels this object owns
+    struct DecodedTexture {
+        TextureHandle handle;
+        std::string path;
+        bool failed = false;
+        TextureCache cache;
+        CookedTexture cooked;
+        TextureFormat format = TextureFormat::RGBA8;
+        std::vector<TextureLevel> levels;
+    };
+
+    struct TextureEntry {
+        GLuint textureID; // Default texture while loading, when evicted and when loading failed
+        bool ready;
+        uint32_t residencyID = TextureResidency::INVALID; // Set once decoded, unless packed
+        GLuint pageTexture = 0; // Array page holding this texture, when packed
+        uint32_t layer = 0;
+        std::unique_ptr<DecodedTexture> source = nullptr; // Kept to stream levels in again after eviction
+    };
+
+    // Finished decodes. Shared with the jobs so ones still running after cleanup() have
+    // somewhere to put their result.
+    struct DecodedQueue {
+        std::mutex mutex;
+        std::deque<std::unique_ptr<DecodedTexture>> textures;
+    };
+
+    std::vector<TextureEntry> textures; // Indexed by TextureHandle
+    std::unordered_map<std::string, TextureHandle> handlesByMaterial;
+    std::shared_ptr<DecodedQueue> decoded;
+    size_t decodesInFlight = 0;
+    size_t pendingCount = 0;
+    TextureResidency residency;
+    std::vector<TextureHandle> residencyOwners; // Indexed by residency ID
+    TexturePacker packer;
+    std::vector<GLuint> pageTextures; // Indexed by packer page
+    std::vector<size_t> packQueue;    // Packed textures waiting for upload
+    bool packReportDue = false;
     GLuint defaultTexture;
-    
-    GLuint loadTextureFromFile(const std::string& filepath);
+    bool compressTextures; // BC1 for opaque textures when the driver supports S3TC
+
+    GLuint stagingBuffer = 0; // GL_PIXEL_UNPACK_BUFFER, orphaned every processUploads
+    size_t stagingCapacity = 0;
+
+    // Decoding and cooking only happens when the file's cache (<file>.ttex) is missing or stale.
+    // Runs on a worker thread.
+    static std::unique_ptr<DecodedTexture> decodeTexture(TextureHandle handle, const std::string& filepath, bool compress);
+    void dropLevels(TextureEntry& entry, uint32_t residentLevel, uint32_t targetLevel);
+    GLuint createPage(const TexturePacker::Page& page, const std::vector<TextureLevel>& levels);
     void createDefaultTexture();
 };
 
-#endif // TEXTURE_MANAGER_HPP
\ No newline at end of file
+#endif // TEXTURE_MANAGER_HPP
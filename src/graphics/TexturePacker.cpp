@@ -0,0 +1,63 @@
+#include "TexturePacker.hpp"
+
+#include <algorithm>
+#include <sstream>
+
+namespace {
+
+const uint32_t FIRST_PAGE_LAYERS = 4; // Pages of a kind double from here up to layersPerPage
+
+} // namespace
+
+TexturePacker::TexturePacker(uint32_t maxSize, uint32_t layersPerPage) : maxSize(maxSize), layersPerPage(layersPerPage) {
+}
+
+TexturePacker::Placement TexturePacker::add(uint32_t width, uint32_t height, TextureFormat format, size_t layerBytes) {
+    Placement placement;
+    if (!canPack(width, height) || layersPerPage == 0) {
+        texturesSkipped++;
+        return placement;
+    }
+
+    // Pages fill up in order, so only the newest page of a kind can have room
+    uint32_t capacity = std::min(FIRST_PAGE_LAYERS, layersPerPage);
+    for (size_t i = pages.size(); i-- > 0;) {
+        Page& page = pages[i];
+        if (page.width == width && page.height == height && page.format == format) {
+            if (page.used < page.capacity) {
+                placement.page = static_cast<uint32_t>(i);
+                placement.layer = page.used++;
+                return placement;
+            }
+            capacity = std::min(page.capacity * 2, layersPerPage);
+            break;
+        }
+    }
+
+    // Sizes only a few materials use don't get a full page of empty layers
+    pages.push_back({width, height, format, capacity, 1, layerBytes});
+    placement.page = static_cast<uint32_t>(pages.size() - 1);
+    placement.layer = 0;
+    return placement;
+}
+
+TexturePacker::Report TexturePacker::getReport() const {
+    Report report;
+    report.texturesSkipped = texturesSkipped;
+    report.pages = pages.size();
+    for (const Page& page : pages) {
+        report.texturesPacked += page.used;
+        report.layersAllocated += page.capacity;
+        report.bytesAllocated += page.capacity * page.layerBytes;
+        report.bytesUsed += page.used * page.layerBytes;
+    }
+    return report;
+}
+
+std::string TexturePacker::Report::toString() const {
+    std::ostringstream out;
+    out << texturesPacked << " textures in " << pages << " array pages (" << layersAllocated << " layers, "
+        << bytesAllocated / 1024 << " KiB, " << static_cast<int>(efficiency() * 100.0f + 0.5f) << "% used), "
+        << bindsSaved() << " binds saved, " << texturesSkipped << " too big to pack";
+    return out.str();
+}
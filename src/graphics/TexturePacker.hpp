@@ -0,0 +1,68 @@
+#ifndef TEXTURE_PACKER_HPP
+#define TEXTURE_PACKER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "TextureCache.hpp"
+
+// Puts small textures of the same size and format into shared array texture pages, one
+// layer each, so meshes using any of them draw with a single bind. Layers keep their own
+// wrapping, which an atlas can't do for the tiling UVs world meshes use.
+// Pure bookkeeping: TextureManager creates the GL arrays, so placement and the efficiency
+// numbers can be checked without a GL context.
+class TexturePacker {
+public:
+    static const uint32_t INVALID = UINT32_MAX;
+
+    struct Placement {
+        uint32_t page = INVALID; // INVALID when the texture is too big to pack
+        uint32_t layer = 0;
+    };
+
+    // Every layer of a page has the same size, format and full mip chain
+    struct Page {
+        uint32_t width;
+        uint32_t height;
+        TextureFormat format;
+        uint32_t capacity; // Layers allocated on the GPU
+        uint32_t used;
+        size_t layerBytes; // All mip levels of one layer
+    };
+
+    struct Report {
+        size_t texturesPacked = 0;
+        size_t texturesSkipped = 0; // Too big, left as their own textures
+        size_t pages = 0;
+        size_t layersAllocated = 0;
+        size_t bytesAllocated = 0;
+        size_t bytesUsed = 0;
+
+        // Share of the allocated layer memory holding textures
+        float efficiency() const { return bytesAllocated ? static_cast<float>(bytesUsed) / bytesAllocated : 1.0f; }
+        // Binds a frame drawing every packed texture saves
+        size_t bindsSaved() const { return texturesPacked - pages; }
+        std::string toString() const;
+    };
+
+    // Textures up to maxSize on both sides are packed, pages hold up to layersPerPage layers
+    explicit TexturePacker(uint32_t maxSize = 256, uint32_t layersPerPage = 16);
+
+    bool canPack(uint32_t width, uint32_t height) const { return width <= maxSize && height <= maxSize; }
+
+    // Next free layer of a page matching the texture, starting a new page when they're all
+    // full. layerBytes is the size of all its mip levels.
+    Placement add(uint32_t width, uint32_t height, TextureFormat format, size_t layerBytes);
+
+    const std::vector<Page>& getPages() const { return pages; }
+    Report getReport() const;
+
+private:
+    uint32_t maxSize;
+    uint32_t layersPerPage;
+    std::vector<Page> pages;
+    size_t texturesSkipped = 0;
+};
+
+#endif // TEXTURE_PACKER_HPP
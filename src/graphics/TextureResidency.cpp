@@ -0,0 +1,150 @@
+#include "TextureResidency.hpp"
+
+#include <algorithm>
+#include <queue>
+
+TextureResidency::TextureResidency(size_t budgetBytes) : budget(budgetBytes) {
+}
+
+uint32_t TextureResidency::addTexture(const std::vector<size_t>& levelBytes) {
+    uint32_t id;
+    if (!freeIds.empty()) {
+        id = freeIds.back();
+        freeIds.pop_back();
+    } else {
+        id = static_cast<uint32_t>(textures.size());
+        textures.emplace_back();
+    }
+
+    Texture& texture = textures[id];
+    uint32_t levelCount = static_cast<uint32_t>(levelBytes.size());
+    texture.levelBytes = levelBytes;
+    texture.tailBytes.assign(levelCount + 1, 0);
+    for (uint32_t level = levelCount; level-- > 0;) {
+        texture.tailBytes[level] = texture.tailBytes[level + 1] + levelBytes[level];
+    }
+    texture.residentLevel = levelCount;
+    texture.requestedLevel = levelCount;
+    texture.targetLevel = levelCount;
+    texture.lastUsedFrame = 0;
+    texture.alive = true;
+    return id;
+}
+
+void TextureResidency::removeTexture(uint32_t id) {
+    Texture& texture = textures[id];
+    residentBytes -= texture.tailBytes[texture.residentLevel];
+    texture = Texture();
+    freeIds.push_back(id);
+}
+
+void TextureResidency::requestLevel(uint32_t id, uint32_t level) {
+    Texture& texture = textures[id];
+    uint32_t coarsest = getLevelCount(id) - 1;
+    texture.requestedLevel = std::min(texture.requestedLevel, std::min(level, coarsest));
+    texture.lastUsedFrame = frame;
+}
+
+void TextureResidency::setResidentLevel(uint32_t id, uint32_t level) {
+    Texture& texture = textures[id];
+    level = std::min(level, getLevelCount(id));
+    residentBytes = residentBytes - texture.tailBytes[texture.residentLevel] + texture.tailBytes[level];
+    texture.residentLevel = level;
+}
+
+size_t TextureResidency::bytesFrom(uint32_t id, uint32_t level) const {
+    const Texture& texture = textures[id];
+    return texture.tailBytes[std::min(level, getLevelCount(id))];
+}
+
+std::vector<TextureResidency::Change> TextureResidency::update() {
+    size_t total = 0;
+    for (Texture& texture : textures) {
+        if (!texture.alive) {
+            continue;
+        }
+        bool used = texture.requestedLevel < texture.levelBytes.size();
+        texture.targetLevel = used ? std::min(texture.requestedLevel, texture.residentLevel) : texture.residentLevel;
+        total += texture.tailBytes[texture.targetLevel];
+    }
+
+    // Detail nobody needs right now goes first
+    if (total > budget) {
+        for (Texture& texture : textures) {
+            if (texture.alive && texture.targetLevel < texture.requestedLevel && texture.requestedLevel < texture.levelBytes.size()) {
+                total -= texture.tailBytes[texture.targetLevel] - texture.tailBytes[texture.requestedLevel];
+                texture.targetLevel = texture.requestedLevel;
+            }
+        }
+    }
+
+    // Then whole textures nothing drew last frame, least recently used first
+    if (total > budget) {
+        std::vector<uint32_t> unused;
+        for (uint32_t id = 0; id < textures.size(); id++) {
+            const Texture& texture = textures[id];
+            if (texture.alive && texture.requestedLevel == texture.levelBytes.size() && texture.targetLevel < texture.levelBytes.size()) {
+                unused.push_back(id);
+            }
+        }
+        std::sort(unused.begin(), unused.end(), [&](uint32_t a, uint32_t b) {
+            return textures[a].lastUsedFrame < textures[b].lastUsedFrame;
+        });
+        for (size_t i = 0; i < unused.size() && total > budget; i++) {
+            Texture& texture = textures[unused[i]];
+            total -= texture.tailBytes[texture.targetLevel];
+            texture.targetLevel = static_cast<uint32_t>(texture.levelBytes.size());
+        }
+    }
+
+    // Last resort, visible textures give up their largest level, biggest first. The
+    // 1x1 level always stays so they don't fall back to the default texture.
+    if (total > budget) {
+        auto smallerTop = [&](uint32_t a, uint32_t b) {
+            return textures[a].levelBytes[textures[a].targetLevel] < textures[b].levelBytes[textures[b].targetLevel];
+        };
+        std::priority_queue<uint32_t, std::vector<uint32_t>, decltype(smallerTop)> largest(smallerTop);
+        for (uint32_t id = 0; id < textures.size(); id++) {
+            const Texture& texture = textures[id];
+            if (texture.alive && texture.targetLevel + 1 < texture.levelBytes.size()) {
+                largest.push(id);
+            }
+        }
+        while (total > budget && !largest.empty()) {
+            uint32_t id = largest.top();
+            largest.pop();
+            Texture& texture = textures[id];
+            total -= texture.levelBytes[texture.targetLevel];
+            texture.targetLevel++;
+            if (texture.targetLevel + 1 < texture.levelBytes.size()) {
+                largest.push(id);
+            }
+        }
+    }
+
+    // Drops first so their memory is free before anything new comes in, then loads for
+    // textures with nothing to show, then the cheapest next level first
+    std::vector<Change> changes;
+    for (uint32_t id = 0; id < textures.size(); id++) {
+        Texture& texture = textures[id];
+        if (texture.alive && texture.targetLevel != texture.residentLevel) {
+            changes.push_back({id, texture.residentLevel, texture.targetLevel});
+        }
+        texture.requestedLevel = static_cast<uint32_t>(texture.levelBytes.size());
+    }
+    auto priority = [&](const Change& change) {
+        const Texture& texture = textures[change.id];
+        if (change.targetLevel > change.residentLevel) {
+            return std::make_pair(0, size_t(0));
+        }
+        if (change.residentLevel == texture.levelBytes.size()) {
+            return std::make_pair(1, texture.levelBytes.back());
+        }
+        return std::make_pair(2, texture.levelBytes[change.residentLevel - 1]);
+    };
+    std::stable_sort(changes.begin(), changes.end(), [&](const Change& a, const Change& b) {
+        return priority(a) < priority(b);
+    });
+    frame++;
+    return changes;
+}
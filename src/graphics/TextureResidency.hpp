@@ -0,0 +1,75 @@
+#ifndef TEXTURE_RESIDENCY_HPP
+#define TEXTURE_RESIDENCY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Decides which mip levels of which textures should be on the GPU, within a memory
+// budget. Pure bookkeeping: TextureManager applies the decisions, so the policy can be
+// driven and checked without a GL context.
+//
+// Every texture keeps a contiguous chain from some level down to its 1x1 level (or
+// nothing at all). Each frame the renderer asks for the finest level it needs per
+// texture; update() then picks targets:
+//  - Textures used last frame aim for the level asked for, and keep finer levels they
+//    already have while there's room (moving away and back shouldn't re-upload).
+//  - Textures not used keep what they have.
+// When that doesn't fit, in order: finer-than-needed levels are dropped, unused textures
+// are evicted least recently used first, then used textures lose their largest levels.
+class TextureResidency {
+public:
+    static const uint32_t INVALID = UINT32_MAX;
+
+    // A texture whose target differs from what's resident
+    struct Change {
+        uint32_t id;
+        uint32_t residentLevel; // levelCount when nothing is resident
+        uint32_t targetLevel;   // Finer (lower) means upload, coarser means drop
+    };
+
+    explicit TextureResidency(size_t budgetBytes = SIZE_MAX);
+
+    void setBudget(size_t bytes) { budget = bytes; }
+    size_t getBudget() const { return budget; }
+
+    // levelBytes[0] is the full size level. Nothing is resident to begin with.
+    uint32_t addTexture(const std::vector<size_t>& levelBytes);
+    void removeTexture(uint32_t id);
+
+    // The renderer needs at least 'level' of this texture this frame
+    void requestLevel(uint32_t id, uint32_t level);
+    // What the GPU copy actually holds now, levelCount for nothing
+    void setResidentLevel(uint32_t id, uint32_t level);
+
+    // Targets from the requests since the last update, then start a new frame.
+    // Returns every texture that should change, uploads in order of priority.
+    std::vector<Change> update();
+
+    uint32_t getLevelCount(uint32_t id) const { return static_cast<uint32_t>(textures[id].levelBytes.size()); }
+    uint32_t getResidentLevel(uint32_t id) const { return textures[id].residentLevel; }
+    uint32_t getTargetLevel(uint32_t id) const { return textures[id].targetLevel; }
+    size_t getResidentBytes() const { return residentBytes; }
+    // Bytes of levels [level, levelCount)
+    size_t bytesFrom(uint32_t id, uint32_t level) const;
+    uint64_t getFrame() const { return frame; }
+
+private:
+    struct Texture {
+        std::vector<size_t> levelBytes;
+        std::vector<size_t> tailBytes; // tailBytes[i] = bytes of levels [i, levelCount), one extra 0 at the end
+        uint32_t residentLevel = 0;
+        uint32_t requestedLevel = 0; // levelCount when not requested this frame
+        uint32_t targetLevel = 0;
+        uint64_t lastUsedFrame = 0;
+        bool alive = false;
+    };
+
+    std::vector<Texture> textures;
+    std::vector<uint32_t> freeIds;
+    size_t budget;
+    size_t residentBytes = 0;
+    uint64_t frame = 1;
+};
+
+#endif // TEXTURE_RESIDENCY_HPP
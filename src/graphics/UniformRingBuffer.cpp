@@ -0,0 +1,123 @@
+#include "UniformRingBuffer.hpp"
+
+#include "../logging/Logger.hpp"
+#include "../profiling/Profiler.hpp"
+
+// All work goes through the GL_UNIFORM_BUFFER binding point. glBindBufferRange binds the
+// indexed points draws read from, and sets that generic point too.
+
+UniformRingBuffer::~UniformRingBuffer() {
+    destroy();
+}
+
+bool UniformRingBuffer::create(size_t bytesPerFrame) {
+    destroy();
+
+    GLint offsetAlignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+    alignment = offsetAlignment > 0 ? static_cast<size_t>(offsetAlignment) : 256;
+    regionBytes = (bytesPerFrame + alignment - 1) / alignment * alignment;
+    GLsizeiptr totalBytes = static_cast<GLsizeiptr>(regionBytes * FRAMES_IN_FLIGHT);
+
+    glGenBuffers(1, &buffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    persistent = GLEW_ARB_buffer_storage;
+    if (persistent) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(GL_UNIFORM_BUFFER, totalBytes, nullptr, flags);
+        mapped = static_cast<std::byte*>(glMapBufferRange(GL_UNIFORM_BUFFER, 0, totalBytes, flags));
+        if (!mapped) {
+            // Immutable storage can't be respecified, start over with a plain buffer
+            LOG_WARNING(LogCategory::Render, "Persistent uniform buffer mapping failed, uploading per frame instead");
+            glDeleteBuffers(1, &buffer);
+            glGenBuffers(1, &buffer);
+            glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+            persistent = false;
+        }
+    }
+    if (!persistent) {
+        glBufferData(GL_UNIFORM_BUFFER, totalBytes, nullptr, GL_STREAM_DRAW);
+        shadow.resize(regionBytes);
+    }
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    if (glGetError() == GL_OUT_OF_MEMORY) {
+        LOG_ERROR(LogCategory::Render, "Out of memory creating a " << totalBytes / 1024 << " KiB uniform ring buffer");
+        destroy();
+        return false;
+    }
+    frame = 0;
+    used = 0;
+    committed = 0;
+    return true;
+}
+
+void UniformRingBuffer::destroy() {
+    for (GLsync& fence : fences) {
+        if (fence) {
+            glDeleteSync(fence);
+            fence = nullptr;
+        }
+    }
+    if (buffer) {
+        if (mapped) {
+            glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+            glUnmapBuffer(GL_UNIFORM_BUFFER);
+            glBindBuffer(GL_UNIFORM_BUFFER, 0);
+            mapped = nullptr;
+        }
+        glDeleteBuffers(1, &buffer);
+        buffer = 0;
+    }
+    shadow.clear();
+    shadow.shrink_to_fit();
+}
+
+void UniformRingBuffer::beginFrame() {
+    frame = (frame + 1) % FRAMES_IN_FLIGHT;
+    used = 0;
+    committed = 0;
+
+    GLsync& fence = fences[frame];
+    if (fence) {
+        PROFILE_ZONE("UniformRingWait");
+        // Normally long signalled, FRAMES_IN_FLIGHT frames have gone by since
+        GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        while (result == GL_TIMEOUT_EXPIRED) {
+            result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+    }
+}
+
+bool UniformRingBuffer::allocate(size_t bytes, Allocation& out) {
+    if (!buffer || used + bytes > regionBytes) {
+        return false;
+    }
+    out.data = persistent ? mapped + frame * regionBytes + used : shadow.data() + used;
+    out.offset = static_cast<GLintptr>(frame * regionBytes + used);
+    out.size = static_cast<GLsizeiptr>(bytes);
+    used = (used + bytes + alignment - 1) / alignment * alignment;
+    return true;
+}
+
+void UniformRingBuffer::commit() {
+    // Coherent mappings are seen by the GPU without any call
+    if (persistent || committed >= used) {
+        return;
+    }
+    size_t bytes = used - committed;
+    glBindBuffer(GL_UNIFORM_BUFFER, buffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, static_cast<GLintptr>(frame * regionBytes + committed),
+                    static_cast<GLsizeiptr>(bytes), shadow.data() + committed);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    committed = used;
+}
+
+void UniformRingBuffer::endFrame() {
+    if (!buffer || used == 0) {
+        return;
+    }
+    fences[frame] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
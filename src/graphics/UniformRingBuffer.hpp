@@ -0,0 +1,61 @@
+#ifndef UNIFORM_RING_BUFFER_HPP
+#define UNIFORM_RING_BUFFER_HPP
+
+#include <cstddef>
+#include <vector>
+#include <GL/glew.h>
+
+// Uniform data written every frame, such as per-object transforms. The buffer is split into
+// one region per frame in flight, and a fence per region keeps the CPU from overwriting data
+// a draw still in the queue reads, so writes never stall on the driver.
+// With ARB_buffer_storage the buffer stays persistently mapped and writes go straight to it.
+// Without it they collect in a copy that commit() uploads before the frame's draws.
+class UniformRingBuffer {
+public:
+    static const size_t FRAMES_IN_FLIGHT = 3;
+
+    // Space for one block's data, valid until the next beginFrame()
+    struct Allocation {
+        void* data = nullptr;
+        GLintptr offset = 0;
+        GLsizeiptr size = 0;
+    };
+
+    UniformRingBuffer() = default;
+    ~UniformRingBuffer();
+
+    UniformRingBuffer(const UniformRingBuffer&) = delete;
+    UniformRingBuffer& operator=(const UniformRingBuffer&) = delete;
+
+    bool create(size_t bytesPerFrame);
+    void destroy();
+
+    // Move to the next region, waiting for the GPU if it's still reading it
+    void beginFrame();
+    // bytes of this frame's region, aligned for glBindBufferRange. False when the region is full.
+    bool allocate(size_t bytes, Allocation& out);
+    // Make this frame's writes visible to the GPU, before drawing with them
+    void commit();
+    // Fence the region once the frame's draws are issued
+    void endFrame();
+
+    void bind(GLuint binding, const Allocation& allocation) const {
+        glBindBufferRange(GL_UNIFORM_BUFFER, binding, buffer, allocation.offset, allocation.size);
+    }
+
+    bool isPersistent() const { return persistent; }
+
+private:
+    GLuint buffer = 0;
+    bool persistent = false;
+    std::byte* mapped = nullptr;        // Whole buffer when persistent
+    std::vector<std::byte> shadow;      // One region, when not
+    size_t regionBytes = 0;
+    size_t alignment = 256;
+    size_t frame = 0;
+    size_t used = 0;
+    size_t committed = 0;
+    GLsync fences[FRAMES_IN_FLIGHT] = {};
+};
+
+#endif // UNIFORM_RING_BUFFER_HPP
@@ -0,0 +1,141 @@
+#include "VertexFormat.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    uint32_t floatExponent = (bits >> 23) & 0xFF;
+    uint32_t mantissa = bits & 0x7FFFFF;
+    if (floatExponent == 0xFF) {
+        return static_cast<uint16_t>(sign | 0x7C00 | (mantissa ? 0x200 : 0)); // Inf or NaN
+    }
+
+    int32_t exponent = static_cast<int32_t>(floatExponent) - 127 + 15;
+    if (exponent >= 31) {
+        return static_cast<uint16_t>(sign | 0x7BFF); // Clamp to the largest finite half
+    }
+    if (exponent <= 0) {
+        // Subnormal half, or zero when it's too small for even that
+        if (exponent < -10) {
+            return static_cast<uint16_t>(sign);
+        }
+        mantissa |= 0x800000;
+        uint32_t shift = static_cast<uint32_t>(14 - exponent);
+        uint32_t half = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1))) {
+            half++;
+        }
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    // Round to nearest even, a carry out of the mantissa correctly bumps the exponent
+    uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+    uint32_t remainder = mantissa & 0x1FFF;
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+        half++;
+    }
+    return static_cast<uint16_t>(sign | std::min<uint32_t>(half, 0x7BFF));
+}
+
+float halfToFloat(uint16_t half) {
+    uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+    uint32_t bits;
+    if (exponent == 0) {
+        float value = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -value : value;
+    } else if (exponent == 31) {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+void octEncode(const glm::vec3& normal, int16_t out[2]) {
+    float length = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+    glm::vec3 n = length > 0.0f ? normal / length : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::vec2 encoded(n.x, n.y);
+    if (n.z < 0.0f) {
+        // Fold the lower hemisphere over the diagonals
+        encoded.x = (1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f);
+        encoded.y = (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f);
+    }
+    out[0] = static_cast<int16_t>(std::round(std::clamp(encoded.x, -1.0f, 1.0f) * 32767.0f));
+    out[1] = static_cast<int16_t>(std::round(std::clamp(encoded.y, -1.0f, 1.0f) * 32767.0f));
+}
+
+glm::vec3 octDecode(const int16_t encoded[2]) {
+    // snorm16 the way GL converts it
+    glm::vec3 n(std::max(encoded[0] / 32767.0f, -1.0f), std::max(encoded[1] / 32767.0f, -1.0f), 0.0f);
+    n.z = 1.0f - std::abs(n.x) - std::abs(n.y);
+    float fold = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -fold : fold;
+    n.y += n.y >= 0.0f ? -fold : fold;
+    return glm::normalize(n);
+}
+
+VertexPackError packMeshVertices(const Mesh& mesh, const glm::vec3& offset, uint16_t slot,
+                                 PackedVertex* out, MeshQuantization& outQuantization) {
+    VertexPackError error;
+    if (mesh.vertices.empty()) {
+        return error;
+    }
+
+    glm::vec3 boxMin(mesh.vertices[0].x, mesh.vertices[0].y, mesh.vertices[0].z);
+    glm::vec3 boxMax = boxMin;
+    for (const Vec3& vertex : mesh.vertices) {
+        boxMin = glm::min(boxMin, glm::vec3(vertex.x, vertex.y, vertex.z));
+        boxMax = glm::max(boxMax, glm::vec3(vertex.x, vertex.y, vertex.z));
+    }
+    // Flat axes get a zero scale and decode to boxMin
+    glm::vec3 extent = boxMax - boxMin;
+    glm::vec3 scale = extent / 65535.0f;
+    glm::vec3 inverseScale;
+    for (int axis = 0; axis < 3; axis++) {
+        inverseScale[axis] = extent[axis] > 0.0f ? 65535.0f / extent[axis] : 0.0f;
+    }
+
+    float minNormalDot = 1.0f;
+    for (size_t i = 0; i < mesh.vertices.size(); i++) {
+        PackedVertex& packed = out[i];
+        glm::vec3 position(mesh.vertices[i].x, mesh.vertices[i].y, mesh.vertices[i].z);
+        glm::vec3 quantized = glm::clamp(glm::round((position - boxMin) * inverseScale), 0.0f, 65535.0f);
+        for (int axis = 0; axis < 3; axis++) {
+            packed.position[axis] = static_cast<uint16_t>(quantized[axis]);
+        }
+        packed.slot = slot;
+        error.position = std::max(error.position, glm::length(boxMin + quantized * scale - position));
+
+        glm::vec3 normal(0.0f, 1.0f, 0.0f);
+        if (i < mesh.normals.size()) {
+            normal = glm::vec3(mesh.normals[i].x, mesh.normals[i].y, mesh.normals[i].z);
+        }
+        octEncode(normal, packed.normal);
+        if (glm::dot(normal, normal) > 0.0f) {
+            minNormalDot = std::min(minNormalDot, glm::dot(glm::normalize(normal), octDecode(packed.normal)));
+        }
+
+        bool hasUV = i < mesh.uvs.size();
+        float u = hasUV ? mesh.uvs[i].u : 0.0f;
+        float v = hasUV ? mesh.uvs[i].v : 0.0f;
+        packed.uv[0] = floatToHalf(u);
+        packed.uv[1] = floatToHalf(v);
+        error.uv = std::max(error.uv, std::max(std::abs(halfToFloat(packed.uv[0]) - u),
+                                               std::abs(halfToFloat(packed.uv[1]) - v)));
+    }
+    error.normalDegrees = glm::degrees(std::acos(std::clamp(minNormalDot, -1.0f, 1.0f)));
+
+    outQuantization.boxMin = boxMin + offset;
+    outQuantization.scale = scale;
+    return error;
+}
@@ -0,0 +1,50 @@
+#ifndef VERTEX_FORMAT_HPP
+#define VERTEX_FORMAT_HPP
+
+#include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
+
+#include "../tmap_parser.hpp"
+
+// Compressed static mesh vertex, CPU only (no GL calls) so it can be checked without a context.
+// 16 bytes against 32 for the float position, normal and UV it replaces.
+struct PackedVertex {
+    uint16_t position[3]; // Quantized within the mesh's MeshQuantization box
+    uint16_t slot;        // Which box, the vertex shader looks it up in a buffer texture
+    int16_t normal[2];    // Octahedral, snorm
+    uint16_t uv[2];       // Half floats
+};
+static_assert(sizeof(PackedVertex) == 16, "PackedVertex must stay tightly packed");
+
+// position = boxMin + quantized * scale
+struct MeshQuantization {
+    glm::vec3 boxMin = glm::vec3(0.0f);
+    glm::vec3 scale = glm::vec3(0.0f);
+};
+
+// Worst difference between the source data and what the shader will decode
+struct VertexPackError {
+    float position = 0.0f;      // World units
+    float normalDegrees = 0.0f;
+    float uv = 0.0f;
+};
+
+// Above these a mesh is worth a warning. Half floats keep about 1/1024 of precision up
+// to UVs of 4, heavily tiled UVs lose more.
+const float MAX_UV_PACK_ERROR = 1.0f / 1024.0f;
+const float MAX_NORMAL_PACK_ERROR_DEGREES = 0.5f;
+
+uint16_t floatToHalf(float value);
+float halfToFloat(uint16_t half);
+
+// Unit vector to two snorm16 values and back, matches octDecode in the vertex shader
+void octEncode(const glm::vec3& normal, int16_t out[2]);
+glm::vec3 octDecode(const int16_t encoded[2]);
+
+// Pack all of mesh's vertices into out (mesh.vertices.size() of them), offset moves the mesh
+// into world space. Missing normals become +Y and missing UVs 0,0.
+VertexPackError packMeshVertices(const Mesh& mesh, const glm::vec3& offset, uint16_t slot,
+                                 PackedVertex* out, MeshQuantization& outQuantization);
+
+#endif // VERTEX_FORMAT_HPP
@@ -3,50 +3,177 @@
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
-#include <iostream>
+#include <algorithm>
+#include <memory>
 #include <vector>
 
+#include "Frustum.hpp"
+#include "GlBufferBackend.hpp"
+#include "GpuBufferArena.hpp"
+#include "ShaderManager.hpp"
+#include "Std140.hpp"
 #include "TextureManager.hpp"
+#include "UniformRingBuffer.hpp"
+#include "VertexFormat.hpp"
 #include "../game_process.hpp"
+#include "../SpatialIndex.hpp"
+#include "../logging/Logger.hpp"
+#include "../profiling/Profiler.hpp"
 
-GLuint shaderProgram = 0;
+ShaderManager* g_shaderManager = nullptr;
+ShaderProgram* g_worldShader = nullptr; // Built on the first frame, once the shader directory is known
 TextureManager* g_textureManager = nullptr;
 std::string g_materialsBasePath = "";
 
+// One level of detail, a range of the mesh's indices
+struct RenderLod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error; // World units, 0 for the full mesh
+};
+
+const size_t MAX_RENDER_LODS = 4; // The full mesh and up to three simplified levels
+
+// All static geometry lives in two arenas, one for vertices and one for indices, each mesh
+// owns a range of both. One vertex array covers everything, so drawing only ever switches
+// textures.
 struct RenderMesh {
-    GLuint VAO;
-    GLuint VBO;
-    int vertexCount;
-    GLuint textureID; // The texture for this mesh
+    GpuBufferArena::Range vertices;
+    GpuBufferArena::Range indices; // Every level back to back, already offset to the mesh's vertices
+    RenderLod lods[MAX_RENDER_LODS]; // [0] is the full mesh
+    uint8_t lodCount;
+    uint8_t currentLod; // Kept between frames for the hysteresis in SelectLod
+    size_t slot; // Quantization box, see g_meshQuantization
+    TextureHandle texture; // The texture for this mesh, the default one while it loads
+    float uvDensity; // Texture coordinate units per world unit, picks the mip levels to stream in
+    uint32_t group; // Which upload this came from, see RemoveWorldMeshGroup
+    BoundingVolume bounds; // World space
 };
 
+// One visible mesh in the render queue. Sorted by state (texture) so each one is bound
+// once, then by index range so ranges that touch can be merged. Everything uses
+// g_worldShader today, a shader goes first in the order once there's more than one.
+struct DrawItem {
+    GLuint textureID;
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    
+    bool operator<(const DrawItem& other) const {
+        if (textureID != other.textureID) return textureID < other.textureID;
+        return firstIndex < other.firstIndex;
+    }
+};
+
+const size_t INITIAL_ARENA_VERTICES = 256 * 1024;
+const size_t INITIAL_ARENA_INDICES = 1024 * 1024;
+
+std::unique_ptr<GpuBufferArena> g_vertexArena;
+std::unique_ptr<GpuBufferArena> g_indexArena;
+GLuint g_staticVAO = 0;
+uint32_t g_staticVAOGeneration[2] = {~0u, ~0u}; // Arena generations the VAO was set up for
+
+// Vertices are quantized within their mesh's box (see VertexFormat). Merged draws cover
+// many meshes, so instead of a uniform each vertex carries a slot and the shader reads
+// the box from a buffer texture: texel 2 * slot is the minimum, 2 * slot + 1 the scale.
+const size_t MAX_MESH_SLOTS = 65536; // PackedVertex::slot is 16 bits
+RangeAllocator g_meshSlots(MAX_MESH_SLOTS);
+std::vector<glm::vec4> g_meshQuantization;
+GLuint g_quantizationBuffer = 0;
+GLuint g_quantizationTexture = 0;
+bool g_quantizationDirty = false;
+
+// Uniform blocks every program shares, by binding point. FrameConstants holds the camera
+// and is written once a frame, ObjectConstants is one object's transform, taken from a ring
+// of per-frame regions so any number of objects can be drawn without a glUniform call each.
+const GLuint FRAME_CONSTANTS_BINDING = 0;
+const GLuint OBJECT_CONSTANTS_BINDING = 1;
+const size_t MAX_OBJECTS_PER_FRAME = 1024;
+constexpr size_t FRAME_CONSTANTS_SIZE = [] {
+    Std140Layout layout;
+    layout.add(Std140Type::Mat4); // view
+    layout.add(Std140Type::Mat4); // projection
+    layout.add(Std140Type::Mat4); // viewProjection
+    layout.add(Std140Type::Vec4); // cameraPosition
+    return layout.size();
+}();
+constexpr size_t OBJECT_CONSTANTS_SIZE = [] {
+    Std140Layout layout;
+    layout.add(Std140Type::Mat4); // model
+    return layout.size();
+}();
+static_assert(FRAME_CONSTANTS_SIZE == 208 && OBJECT_CONSTANTS_SIZE == 64, "Uniform blocks changed, check the shaders");
+GLuint g_frameConstantsBuffer = 0;
+UniformRingBuffer g_objectConstants;
+std::vector<DrawItem> g_renderQueue;
+std::vector<GLsizei> g_drawCounts;
+std::vector<const void*> g_drawOffsets;
 std::vector<RenderMesh> g_worldMeshes;
+// Bounds of g_worldMeshes in the same order, rebuilt after meshes are added or removed.
+// Small worlds are culled with a flat SSE scan, past SPATIAL_INDEX_MIN_MESHES walking a
+// BVH is cheaper (see tools/spatial_bench).
+const size_t SPATIAL_INDEX_MIN_MESHES = 2048;
+CullingSet g_cullingSet;
+SpatialIndex g_meshIndex;
+bool g_cullingSetDirty = true;
+bool g_frustumCulling = true;
+float g_viewDistance = 100.0f;
+size_t g_textureUploadBudget = 4 * 1024 * 1024; // Bytes of texture data uploaded per frame
+size_t g_textureMemoryBudget = 512 * 1024 * 1024;
+std::vector<uint32_t> g_visibleMeshes;
+RenderStats g_renderStats;
 glm::vec3 g_cameraPos = glm::vec3(0.0f, 2.0f, 5.0f);
-glm::vec3 g_cameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
+glm::vec3 g_cameraRotation = glm::vec3(0.0f, -90.0f, 0.0f); // pitch, yaw, roll in degrees, yaw -90 looks down -Z
 glm::vec3 g_cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
 
+// Camera as of the previous simulation tick, frames are drawn in between the two
+glm::vec3 g_prevCameraPos = g_cameraPos;
+glm::vec3 g_prevCameraRotation = g_cameraRotation;
+
 bool InitRenderer() {
-    std::cout << "InitRenderer: Starting..." << std::endl;
+    LOG_INFO(LogCategory::Render, "Initializing renderer...");
     
     // Create texture manager
     g_textureManager = new TextureManager();
+    g_textureManager->setMemoryBudget(g_textureMemoryBudget);
     
-    // Updated vertex shader - now with UVs!
+    // Built-in world shader, a game can replace it with shaders/world.vert and world.frag
     const char* vertexShaderSource = R"(
         #version 330 core
-        layout (location = 0) in vec3 aPos;
+        layout (location = 0) in uvec4 aPos; // Quantized xyz, w is the mesh slot
         layout (location = 1) in vec2 aTexCoord;
+        layout (location = 2) in vec2 aNormal; // Octahedral
         
         out vec2 TexCoord;
+        out vec3 Normal;
+        flat out float Layer;
         
-        uniform mat4 model;
-        uniform mat4 view;
-        uniform mat4 projection;
+        layout (std140) uniform FrameConstants {
+            mat4 view;
+            mat4 projection;
+            mat4 viewProjection;
+            vec4 cameraPosition;
+        };
+        layout (std140) uniform ObjectConstants {
+            mat4 model;
+        };
+        uniform samplerBuffer meshBoxes;
+        
+        vec3 octDecode(vec2 e) {
+            vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+            float fold = max(-n.z, 0.0);
+            n.x += n.x >= 0.0 ? -fold : fold;
+            n.y += n.y >= 0.0 ? -fold : fold;
+            return normalize(n);
+        }
         
         void main() {
-            gl_Position = projection * view * model * vec4(aPos, 1.0);
+            int box = int(aPos.w) * 2;
+            vec4 boxMin = texelFetch(meshBoxes, box); // w is the texture's array layer
+            vec3 position = boxMin.xyz + vec3(aPos.xyz) * texelFetch(meshBoxes, box + 1).xyz;
+            gl_Position = viewProjection * model * vec4(position, 1.0);
             TexCoord = aTexCoord;
+            Normal = mat3(model) * octDecode(aNormal);
+            Layer = boxMin.w;
         }
     )";
     
@@ -56,142 +183,277 @@ bool InitRenderer() {
         out vec4 FragColor;
         
         in vec2 TexCoord;
+        flat in float Layer;
         
-        uniform sampler2D texture1;
+        uniform sampler2DArray texture1;
         
         void main() {
-            FragColor = texture(texture1, TexCoord);
+            FragColor = texture(texture1, vec3(TexCoord, Layer));
         }
     )";
     
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-    
-    GLint success;
-    GLchar infoLog[512];
-    glGetShaderiv(vertexShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(vertexShader, 512, NULL, infoLog);
-        std::cerr << "Vertex shader failed: " << infoLog << std::endl;
-        return false;
-    }
-    
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragmentShaderSource, NULL);
-    glCompileShader(fragmentShader);
+    g_shaderManager = new ShaderManager();
+    g_shaderManager->registerBuiltin("world", vertexShaderSource, fragmentShaderSource);
+    g_shaderManager->setUniformBlockBinding("FrameConstants", FRAME_CONSTANTS_BINDING);
+    g_shaderManager->setUniformBlockBinding("ObjectConstants", OBJECT_CONSTANTS_BINDING);
+    g_shaderManager->setSamplerUnit("texture1", 0);
+    g_shaderManager->setSamplerUnit("meshBoxes", 1);
     
-    glGetShaderiv(fragmentShader, GL_COMPILE_STATUS, &success);
-    if (!success) {
-        glGetShaderInfoLog(fragmentShader, 512, NULL, infoLog);
-        std::cerr << "Fragment shader failed: " << infoLog << std::endl;
+    glGenBuffers(1, &g_frameConstantsBuffer);
+    glBindBuffer(GL_UNIFORM_BUFFER, g_frameConstantsBuffer);
+    glBufferData(GL_UNIFORM_BUFFER, FRAME_CONSTANTS_SIZE, nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_CONSTANTS_BINDING, g_frameConstantsBuffer);
+    if (!g_objectConstants.create(MAX_OBJECTS_PER_FRAME * OBJECT_CONSTANTS_SIZE)) {
         return false;
     }
+    LOG_INFO(LogCategory::Render, "Object constants ring: " << (g_objectConstants.isPersistent() ? "persistently mapped" : "uploaded per frame"));
     
-    shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
+    glGenBuffers(1, &g_quantizationBuffer);
+    glGenTextures(1, &g_quantizationTexture);
+    glBindBuffer(GL_TEXTURE_BUFFER, g_quantizationBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, g_quantizationTexture);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, g_quantizationBuffer);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
     
-    glGetProgramiv(shaderProgram, GL_LINK_STATUS, &success);
-    if (!success) {
-        glGetProgramInfoLog(shaderProgram, 512, NULL, infoLog);
-        std::cerr << "Shader linking failed: " << infoLog << std::endl;
-        return false;
-    }
-    
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    g_vertexArena = std::make_unique<GpuBufferArena>(std::make_unique<GlBufferBackend>(),
+                                                     sizeof(PackedVertex), INITIAL_ARENA_VERTICES);
+    g_indexArena = std::make_unique<GpuBufferArena>(std::make_unique<GlBufferBackend>(),
+                                                    sizeof(uint32_t), INITIAL_ARENA_INDICES);
+    glGenVertexArrays(1, &g_staticVAO);
 
-    std::cout << "InitRenderer: SUCCESS" << std::endl;
+    LOG_INFO(LogCategory::Render, "Renderer initialized");
     return true;
 }
 
 void SetMaterialsPath(const std::string& basePath) {
     g_materialsBasePath = basePath;
-    std::cout << "Renderer: Materials base path set to " << g_materialsBasePath << std::endl;
+    LOG_INFO(LogCategory::Render, "Materials base path set to " << g_materialsBasePath);
 }
 
-void UploadTMAPMeshes(const TMAPData& mapData) {
-    std::cout << "UploadTMAPMeshes: Uploading " << mapData.meshes.size() << " meshes" << std::endl;
-    
-    for (auto& mesh : g_worldMeshes) {
-        glDeleteVertexArrays(1, &mesh.VAO);
-        glDeleteBuffers(1, &mesh.VBO);
+void SetShaderPath(const std::string& directory) {
+    g_shaderManager->setDirectory(directory);
+}
+
+void SetShaderHotReload(bool enabled) {
+    g_shaderManager->setHotReload(enabled);
+}
+
+// Square root of UV area over surface area, averaged over the whole mesh
+static float MeshUVDensity(const Mesh& mesh) {
+    if (mesh.uvs.size() != mesh.vertices.size()) {
+        return 0.0f;
+    }
+    size_t indexCount = mesh.isIndexed() ? mesh.indexCount() : mesh.vertices.size();
+    auto index = [&](size_t i) -> uint32_t {
+        if (!mesh.indices16.empty()) return mesh.indices16[i];
+        if (!mesh.indices32.empty()) return mesh.indices32[i];
+        return static_cast<uint32_t>(i);
+    };
+    double uvArea = 0.0, surfaceArea = 0.0;
+    for (size_t i = 0; i + 2 < indexCount; i += 3) {
+        uint32_t a = index(i), b = index(i + 1), c = index(i + 2);
+        glm::vec3 pa(mesh.vertices[a].x, mesh.vertices[a].y, mesh.vertices[a].z);
+        glm::vec3 pb(mesh.vertices[b].x, mesh.vertices[b].y, mesh.vertices[b].z);
+        glm::vec3 pc(mesh.vertices[c].x, mesh.vertices[c].y, mesh.vertices[c].z);
+        surfaceArea += glm::length(glm::cross(pb - pa, pc - pa));
+        float du1 = mesh.uvs[b].u - mesh.uvs[a].u, dv1 = mesh.uvs[b].v - mesh.uvs[a].v;
+        float du2 = mesh.uvs[c].u - mesh.uvs[a].u, dv2 = mesh.uvs[c].v - mesh.uvs[a].v;
+        uvArea += std::abs(du1 * dv2 - du2 * dv1);
+    }
+    return surfaceArea > 0.0 ? static_cast<float>(std::sqrt(uvArea / surfaceArea)) : 0.0f;
+}
+
+static void FreeMeshRanges(const RenderMesh& mesh) {
+    g_vertexArena->free(mesh.vertices);
+    g_indexArena->free(mesh.indices);
+    g_meshSlots.free(mesh.slot, 1);
+}
+
+void ClearWorldMeshes() {
+    for (const auto& mesh : g_worldMeshes) {
+        FreeMeshRanges(mesh);
     }
     g_worldMeshes.clear();
+    g_cullingSetDirty = true;
+}
+
+void RemoveWorldMeshGroup(uint32_t group) {
+    std::erase_if(g_worldMeshes, [group](const RenderMesh& mesh) {
+        if (mesh.group != group) {
+            return false;
+        }
+        FreeMeshRanges(mesh);
+        return true;
+    });
+    g_cullingSetDirty = true;
+}
+
+// Points the shared vertex array at the arenas' current buffers, growing an arena replaces them
+static void BindStaticGeometry() {
+    glBindVertexArray(g_staticVAO);
+    if (g_staticVAOGeneration[0] == g_vertexArena->getGeneration() &&
+        g_staticVAOGeneration[1] == g_indexArena->getGeneration()) {
+        return;
+    }
+    
+    auto& vertexBuffer = static_cast<GlBufferBackend&>(g_vertexArena->getBackend());
+    auto& indexBuffer = static_cast<GlBufferBackend&>(g_indexArena->getBackend());
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer.getBuffer());
+    
+    // Quantized position and slot (location = 0), integers so the slot stays exact
+    glVertexAttribIPointer(0, 4, GL_UNSIGNED_SHORT, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+    glEnableVertexAttribArray(0);
     
-    for (const auto& mesh : mapData.meshes) {
+    // UV attribute (location = 1)
+    glVertexAttribPointer(1, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, uv));
+    glEnableVertexAttribArray(1);
+    
+    // Normal attribute (location = 2)
+    glVertexAttribPointer(2, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+    glEnableVertexAttribArray(2);
+    
+    // The element buffer binding is part of the vertex array state
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer.getBuffer());
+    g_staticVAOGeneration[0] = g_vertexArena->getGeneration();
+    g_staticVAOGeneration[1] = g_indexArena->getGeneration();
+}
+
+void UploadTMAPMeshes(const TMAPData& mapData) {
+    PROFILE_FUNCTION();
+    LOG_INFO(LogCategory::Render, "Uploading " << mapData.meshes.size() << " meshes");
+    
+    ClearWorldMeshes();
+    UploadTMAPMeshRange(mapData, 0, mapData.meshes.size());
+    
+    g_cameraPos = glm::vec3(mapData.spawnPosition.x, 
+                            mapData.spawnPosition.y + 1.0f,
+                            mapData.spawnPosition.z + 3.0f);
+    SnapCamera();
+    
+    LOG_INFO(LogCategory::Render, "Mesh upload complete");
+}
+
+// Append meshes [first, first + count) to the world, lets loaders spread uploads over several frames
+void UploadTMAPMeshRange(const TMAPData& mapData, size_t first, size_t count, uint32_t group) {
+    size_t last = std::min(first + count, mapData.meshes.size());
+    for (size_t meshIndex = first; meshIndex < last; meshIndex++) {
+        const Mesh& mesh = mapData.meshes[meshIndex];
         if (mesh.vertices.empty()) {
-            std::cout << "UploadTMAPMeshes: Skipping empty mesh " << mesh.name << std::endl;
+            LOG_DEBUG(LogCategory::Render, "Skipping empty mesh " << mesh.name);
             continue;
         }
         
         // Check if we have UVs
         if (mesh.uvs.size() != mesh.vertices.size()) {
-            std::cerr << "UploadTMAPMeshes: Warning - mesh " << mesh.name
-                      << " has mismatched vertex/UV counts ("
-                      << mesh.vertices.size() << " verts, " << mesh.uvs.size() << " UVs)" << std::endl;
+            LOG_WARNING(LogCategory::Render, "Mesh " << mesh.name
+                                             << " has mismatched vertex/UV counts ("
+                                             << mesh.vertices.size() << " verts, " << mesh.uvs.size() << " UVs)");
         }
         
+        size_t indexCount = mesh.isIndexed() ? mesh.indexCount() : mesh.vertices.size();
+        size_t lodCount = std::min(mesh.lods.size(), MAX_RENDER_LODS - 1);
+        for (size_t lod = 0; lod < lodCount; lod++) {
+            indexCount += mesh.lods[lod].indexCount();
+        }
         RenderMesh rMesh;
-        rMesh.vertexCount = mesh.vertices.size();
+        rMesh.group = group;
+        rMesh.slot = g_meshSlots.allocate(1);
+        if (rMesh.slot == RangeAllocator::INVALID) {
+            LOG_ERROR(LogCategory::Render, "More than " << MAX_MESH_SLOTS << " meshes, skipping " << mesh.name);
+            continue;
+        }
+        if (!g_vertexArena->allocate(mesh.vertices.size(), rMesh.vertices)) {
+            LOG_ERROR(LogCategory::Render, "No room for the vertices of " << mesh.name);
+            g_meshSlots.free(rMesh.slot, 1);
+            continue;
+        }
+        if (!g_indexArena->allocate(indexCount, rMesh.indices)) {
+            LOG_ERROR(LogCategory::Render, "No room for the indices of " << mesh.name);
+            g_vertexArena->free(rMesh.vertices);
+            g_meshSlots.free(rMesh.slot, 1);
+            continue;
+        }
         
-        // Load the texture for this mesh's material
-        rMesh.textureID = g_textureManager->loadMaterialTexture(mesh.material, g_materialsBasePath);
+        // Start loading the texture for this mesh's material, it shows up once processUploads gets to it
+        rMesh.texture = g_textureManager->requestMaterialTexture(mesh.material, g_materialsBasePath);
+        rMesh.uvDensity = MeshUVDensity(mesh);
         
-        // Create interleaved vertex data: [x,y,z,u,v, x,y,z,u,v, ...]
-        std::vector<float> interleavedData;
-        interleavedData.reserve(mesh.vertices.size() * 5); // 3 for position, 2 for UV
+        // Pack straight into the mapped range, the map offset goes into the quantization box
+        // (physics puts it on the body transform instead)
+        glm::vec3 mapOffset(mapData.mapOffset.x, mapData.mapOffset.y, mapData.mapOffset.z);
+        PackedVertex* vertexOut = static_cast<PackedVertex*>(g_vertexArena->map(rMesh.vertices));
+        if (vertexOut) {
+            MeshQuantization quantization;
+            VertexPackError packError = packMeshVertices(mesh, mapOffset, static_cast<uint16_t>(rMesh.slot),
+                                                         vertexOut, quantization);
+            g_vertexArena->unmap();
+            
+            if (g_meshQuantization.size() < (rMesh.slot + 1) * 2) {
+                g_meshQuantization.resize((rMesh.slot + 1) * 2);
+            }
+            g_meshQuantization[rMesh.slot * 2] = glm::vec4(quantization.boxMin, 0.0f);
+            g_meshQuantization[rMesh.slot * 2 + 1] = glm::vec4(quantization.scale, 0.0f);
+            g_quantizationDirty = true;
+            
+            if (packError.uv > MAX_UV_PACK_ERROR || packError.normalDegrees > MAX_NORMAL_PACK_ERROR_DEGREES) {
+                LOG_WARNING(LogCategory::Render, "Mesh " << mesh.name << " loses precision in the packed vertex format (UV error "
+                                                 << packError.uv << ", normal error " << packError.normalDegrees << " degrees)");
+            }
+            LOG_TRACE(LogCategory::Render, "Packed " << mesh.name << ", position error " << packError.position
+                                           << ", normal error " << packError.normalDegrees << " degrees, UV error " << packError.uv);
+        }
         
-        for (size_t i = 0; i < mesh.vertices.size(); i++) {
-            // Position
-            interleavedData.push_back(mesh.vertices[i].x);
-            interleavedData.push_back(mesh.vertices[i].y);
-            interleavedData.push_back(mesh.vertices[i].z);
+        // 32-bit indices pointing at the mesh's place in the arena, so no draw needs a base
+        // vertex and neighbouring ranges can be merged. Triangle soups get 0..n-1.
+        // The levels of detail follow the full mesh.
+        uint32_t baseVertex = static_cast<uint32_t>(rMesh.vertices.first);
+        uint32_t* indexOut = static_cast<uint32_t*>(g_indexArena->map(rMesh.indices));
+        if (indexOut) {
+            uint32_t firstIndex = static_cast<uint32_t>(rMesh.indices.first);
+            auto writeLevel = [&](std::span<const uint16_t> indices16, std::span<const uint32_t> indices32, float error) {
+                uint32_t* levelStart = indexOut;
+                for (uint16_t index : indices16) {
+                    *indexOut++ = baseVertex + index;
+                }
+                for (uint32_t index : indices32) {
+                    *indexOut++ = baseVertex + index;
+                }
+                uint32_t levelCount = static_cast<uint32_t>(indexOut - levelStart);
+                rMesh.lods[rMesh.lodCount++] = {firstIndex, levelCount, error};
+                firstIndex += levelCount;
+            };
             
-            // UV (use 0,0 if we don't have enough UVs)
-            if (i < mesh.uvs.size()) {
-                interleavedData.push_back(mesh.uvs[i].u);
-                interleavedData.push_back(mesh.uvs[i].v);
+            rMesh.lodCount = 0;
+            rMesh.currentLod = 0;
+            if (mesh.isIndexed()) {
+                writeLevel(mesh.indices16, mesh.indices32, 0.0f);
             } else {
-                interleavedData.push_back(0.0f);
-                interleavedData.push_back(0.0f);
+                for (uint32_t i = 0; i < mesh.vertices.size(); i++) {
+                    *indexOut++ = baseVertex + i;
+                }
+                rMesh.lods[rMesh.lodCount++] = {firstIndex, static_cast<uint32_t>(mesh.vertices.size()), 0.0f};
+            }
+            for (size_t lod = 0; lod < lodCount; lod++) {
+                writeLevel(mesh.lods[lod].indices16, mesh.lods[lod].indices32, mesh.lods[lod].error);
             }
+            g_indexArena->unmap();
+        }
+        if (!vertexOut || !indexOut) {
+            LOG_ERROR(LogCategory::Render, "Unable to map mesh buffers for " << mesh.name);
+            FreeMeshRanges(rMesh);
+            continue;
         }
         
-        glGenVertexArrays(1, &rMesh.VAO);
-        glGenBuffers(1, &rMesh.VBO);
-        
-        glBindVertexArray(rMesh.VAO);
-        glBindBuffer(GL_ARRAY_BUFFER, rMesh.VBO);
-        
-        glBufferData(GL_ARRAY_BUFFER, 
-                     interleavedData.size() * sizeof(float), 
-                     interleavedData.data(), 
-                     GL_STATIC_DRAW);
-        
-        // Position attribute (location = 0)
-        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
-        glEnableVertexAttribArray(0);
-        
-        // UV attribute (location = 1)
-        glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
-        glEnableVertexAttribArray(1);
-        
-        glBindVertexArray(0);
-        
+        rMesh.bounds = computeBoundingVolume(&mesh.vertices[0].x, mesh.vertices.size(), sizeof(Vec3) / sizeof(float));
+        rMesh.bounds.center += mapOffset;
         g_worldMeshes.push_back(rMesh);
+        g_cullingSetDirty = true;
         
-        std::cout << "UploadTMAPMeshes:   " << mesh.name 
-                  << " (" << rMesh.vertexCount << " verts, material: " << mesh.material << ")" << std::endl;
+        LOG_DEBUG(LogCategory::Render, "Uploaded " << mesh.name << " (" << mesh.vertices.size()
+                                       << " verts, " << int(rMesh.lodCount) << " LODs, material: " << mesh.material << ")");
     }
-    
-    g_cameraPos = glm::vec3(mapData.spawnPosition.x, 
-                            mapData.spawnPosition.y + 1.0f,
-                            mapData.spawnPosition.z + 3.0f);
-    
-    std::cout << "UploadTMAPMeshes: Complete!" << std::endl;
 }
 
 void SetCameraPosition(const glm::vec3& position) {
@@ -199,63 +461,266 @@ void SetCameraPosition(const glm::vec3& position) {
 }
 
 void SetCameraRotation(const glm::vec3& rotation) {
+    // Yaw isn't wrapped here, so interpolating never goes the long way around
+    g_cameraRotation = glm::vec3(glm::clamp(rotation.x, -89.9f, 89.9f), rotation.y, rotation.z);
+}
+
+void BeginCameraTick() {
+    g_prevCameraPos = g_cameraPos;
+    g_prevCameraRotation = g_cameraRotation;
+}
+
+void SnapCamera() {
+    BeginCameraTick();
+}
+
+// Coarsest level whose error projects to at most LOD_PIXEL_ERROR pixels. pixelScale is
+// pixels per world unit at the mesh's distance. Going coarser needs a margin so a mesh
+// sitting right at a switch distance doesn't pop back and forth every frame.
+const float LOD_PIXEL_ERROR = 1.0f;
+const float LOD_HYSTERESIS = 0.25f;
+
+static uint8_t SelectLod(const RenderMesh& mesh, float pixelScale) {
+    uint8_t lod = mesh.currentLod;
+    if (mesh.lods[lod].error * pixelScale > LOD_PIXEL_ERROR) {
+        while (lod > 0 && mesh.lods[lod].error * pixelScale > LOD_PIXEL_ERROR) {
+            lod--;
+        }
+        return lod;
+    }
+    while (lod + 1 < mesh.lodCount && mesh.lods[lod + 1].error * pixelScale <= LOD_PIXEL_ERROR * (1.0f - LOD_HYSTERESIS)) {
+        lod++;
+    }
+    return lod;
+}
+
+static glm::vec3 CameraFront(const glm::vec3& rotation) {
     glm::vec3 front;
-    float pitch = glm::clamp(rotation.x, -89.9f, 89.9f);
+    float pitch = rotation.x;
     float yaw = glm::mod(rotation.y, 360.0f);
     front.x = cos(glm::radians(yaw)) * cos(glm::radians(pitch));
     front.y = sin(glm::radians(pitch));
     front.z = sin(glm::radians(yaw)) * cos(glm::radians(pitch));
-    g_cameraFront = glm::normalize(front);
+    return glm::normalize(front);
 }
 
-void RenderFrame(int width, int height) {
+void RenderFrame(int width, int height, float alpha) {
+    PROFILE_FUNCTION();
     glClearColor(0.0f, 0.0f, 0.0f, 1.0f); // Black background for space
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+    g_renderStats = RenderStats();
+    g_renderStats.textureUploadBytes = static_cast<uint32_t>(g_textureManager->processUploads(g_textureUploadBudget));
+    g_renderStats.texturesPending = static_cast<uint32_t>(g_textureManager->getPendingCount());
+    g_renderStats.textureBytesResident = g_textureManager->getResidentBytes();
+    g_shaderManager->reloadChanged();
     if (g_worldMeshes.empty()) {
         return;
     }
+    if (!g_worldShader) {
+        g_worldShader = g_shaderManager->load("world");
+        if (!g_worldShader) {
+            return;
+        }
+    }
     
-    glUseProgram(shaderProgram);
+    g_worldShader->use();
+    g_renderStats.programBinds = 1;
     
-    glm::mat4 model = glm::mat4(1.0f);
-    glm::mat4 view = glm::lookAt(g_cameraPos, g_cameraPos + g_cameraFront, g_cameraUp);
-    glm::mat4 projection = glm::perspective(glm::radians(90.0f * fovMultiplier), static_cast<float>(width) / height, 0.1f, 100.0f);
+    alpha = glm::clamp(alpha, 0.0f, 1.0f);
+    glm::vec3 cameraPos = glm::mix(g_prevCameraPos, g_cameraPos, alpha);
+    glm::vec3 cameraFront = CameraFront(glm::mix(g_prevCameraRotation, g_cameraRotation, alpha));
+    glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, g_cameraUp);
+    float fieldOfView = glm::radians(90.0f * fovMultiplier);
+    glm::mat4 projection = glm::perspective(fieldOfView, static_cast<float>(width) / height, 0.1f, g_viewDistance);
     
-    GLint modelLoc = glGetUniformLocation(shaderProgram, "model");
-    GLint viewLoc = glGetUniformLocation(shaderProgram, "view");
-    GLint projLoc = glGetUniformLocation(shaderProgram, "projection");
     
-    glUniformMatrix4fv(modelLoc, 1, GL_FALSE, glm::value_ptr(model));
-    glUniformMatrix4fv(viewLoc, 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(projLoc, 1, GL_FALSE, glm::value_ptr(projection));
+    std::byte frameConstants[FRAME_CONSTANTS_SIZE] = {};
+    Std140Writer frameWriter(frameConstants);
+    frameWriter.write(view);
+    frameWriter.write(projection);
+    frameWriter.write(projection * view);
+    frameWriter.write(glm::vec4(cameraPos, 1.0f));
+    glBindBuffer(GL_UNIFORM_BUFFER, g_frameConstantsBuffer);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, FRAME_CONSTANTS_SIZE, frameConstants);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
     
-    for (const auto& mesh : g_worldMeshes) {
-        // Bind the texture for this mesh
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, mesh.textureID);
+    // World geometry is already in world space. Dynamic objects each take their own
+    // allocation and bind it before their draws.
+    g_objectConstants.beginFrame();
+    UniformRingBuffer::Allocation worldObject;
+    if (g_objectConstants.allocate(OBJECT_CONSTANTS_SIZE, worldObject)) {
+        Std140Writer(static_cast<std::byte*>(worldObject.data)).write(glm::mat4(1.0f));
+        g_objectConstants.commit();
+        g_objectConstants.bind(OBJECT_CONSTANTS_BINDING, worldObject);
+    }
+    
+    bool useSpatialIndex = g_worldMeshes.size() >= SPATIAL_INDEX_MIN_MESHES;
+    if (g_cullingSetDirty) {
+        PROFILE_ZONE("BuildCullingData");
+        g_cullingSet.clear();
+        g_meshIndex.clear();
+        if (useSpatialIndex) {
+            std::vector<BoundingVolume> volumes;
+            volumes.reserve(g_worldMeshes.size());
+            for (const auto& mesh : g_worldMeshes) {
+                volumes.push_back(mesh.bounds);
+            }
+            g_meshIndex.build(volumes);
+        } else {
+            g_cullingSet.reserve(g_worldMeshes.size());
+            for (const auto& mesh : g_worldMeshes) {
+                g_cullingSet.add(mesh.bounds);
+            }
+        }
+        g_cullingSetDirty = false;
+    }
+    
+    g_visibleMeshes.clear();
+    if (g_frustumCulling) {
+        PROFILE_ZONE("FrustumCull");
+        Frustum frustum = Frustum::fromMatrix(projection * view);
+        if (useSpatialIndex) {
+            g_meshIndex.queryFrustum(frustum, g_visibleMeshes);
+        } else {
+            frustum.cull(g_cullingSet, g_visibleMeshes);
+        }
+    } else {
+        for (uint32_t i = 0; i < g_worldMeshes.size(); i++) {
+            g_visibleMeshes.push_back(i);
+        }
+    }
+    g_renderStats.meshesTotal = static_cast<uint32_t>(g_worldMeshes.size());
+    g_renderStats.meshesVisible = static_cast<uint32_t>(g_visibleMeshes.size());
+    g_renderStats.meshesCulled = g_renderStats.meshesTotal - g_renderStats.meshesVisible;
+    
+    // Pick each visible mesh's level of detail and the texture detail it needs from its
+    // nearest point, then build the render queue and walk it in state order
+    float pixelsPerUnit = height / (2.0f * std::tan(fieldOfView * 0.5f)); // At a distance of 1
+    g_renderQueue.clear();
+    for (uint32_t meshIndex : g_visibleMeshes) {
+        RenderMesh& mesh = g_worldMeshes[meshIndex];
+        float distance = std::max(glm::length(mesh.bounds.center - cameraPos) - mesh.bounds.radius, 0.1f);
+        float pixelScale = pixelsPerUnit / distance;
+        if (mesh.lodCount > 1) {
+            mesh.currentLod = SelectLod(mesh, pixelScale);
+        }
+        g_textureManager->requestDetail(mesh.texture, mesh.uvDensity / pixelScale);
+        // The layer changes when a packed texture finishes loading
+        float layer = static_cast<float>(g_textureManager->getTextureLayer(mesh.texture));
+        if (g_meshQuantization[mesh.slot * 2].w != layer) {
+            g_meshQuantization[mesh.slot * 2].w = layer;
+            g_quantizationDirty = true;
+        }
+        const RenderLod& lod = mesh.lods[mesh.currentLod];
+        g_renderQueue.push_back({g_textureManager->getTextureID(mesh.texture), lod.firstIndex, lod.indexCount});
+        g_renderStats.triangles += lod.indexCount / 3;
+        g_renderStats.meshesReduced += mesh.currentLod > 0 ? 1 : 0;
+    }
+    std::sort(g_renderQueue.begin(), g_renderQueue.end());
+    
+    if (g_quantizationDirty) {
+        glBindBuffer(GL_TEXTURE_BUFFER, g_quantizationBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, g_meshQuantization.size() * sizeof(glm::vec4), g_meshQuantization.data(), GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        g_quantizationDirty = false;
+    }
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_BUFFER, g_quantizationTexture);
+    
+    BindStaticGeometry();
+    g_renderStats.vertexArrayBinds = 1;
+    glActiveTexture(GL_TEXTURE0);
+    size_t item = 0;
+    while (item < g_renderQueue.size()) {
+        GLuint textureID = g_renderQueue[item].textureID;
+        glBindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+        g_renderStats.textureBinds++;
+        
+        // Every visible range with this texture, merging ranges that are next to each other
+        g_drawCounts.clear();
+        g_drawOffsets.clear();
+        uint32_t rangeStart = g_renderQueue[item].firstIndex;
+        uint32_t rangeEnd = rangeStart;
+        for (; item < g_renderQueue.size() && g_renderQueue[item].textureID == textureID; item++) {
+            const DrawItem& next = g_renderQueue[item];
+            if (next.firstIndex != rangeEnd) {
+                g_drawCounts.push_back(static_cast<GLsizei>(rangeEnd - rangeStart));
+                g_drawOffsets.push_back(reinterpret_cast<const void*>(rangeStart * sizeof(uint32_t)));
+                rangeStart = next.firstIndex;
+            }
+            rangeEnd = next.firstIndex + next.indexCount;
+        }
+        g_drawCounts.push_back(static_cast<GLsizei>(rangeEnd - rangeStart));
+        g_drawOffsets.push_back(reinterpret_cast<const void*>(rangeStart * sizeof(uint32_t)));
         
-        glBindVertexArray(mesh.VAO);
-        glDrawArrays(GL_TRIANGLES, 0, mesh.vertexCount);
+        if (g_drawCounts.size() == 1) {
+            glDrawElements(GL_TRIANGLES, g_drawCounts[0], GL_UNSIGNED_INT, g_drawOffsets[0]);
+        } else {
+            glMultiDrawElements(GL_TRIANGLES, g_drawCounts.data(), GL_UNSIGNED_INT, g_drawOffsets.data(),
+                                static_cast<GLsizei>(g_drawCounts.size()));
+        }
+        g_renderStats.drawCalls++;
+        g_renderStats.drawRanges += static_cast<uint32_t>(g_drawCounts.size());
     }
     
     glBindVertexArray(0);
+    g_objectConstants.endFrame();
+}
+
+const RenderStats& GetRenderStats() {
+    return g_renderStats;
+}
+
+void SetViewDistance(float distance) {
+    g_viewDistance = std::max(distance, 1.0f);
+}
+
+void SetFrustumCulling(bool enabled) {
+    g_frustumCulling = enabled;
+}
+
+void SetTextureUploadBudget(size_t bytes) {
+    g_textureUploadBudget = bytes;
+}
+
+void SetTextureMemoryBudget(size_t bytes) {
+    g_textureMemoryBudget = bytes;
+    if (g_textureManager) {
+        g_textureManager->setMemoryBudget(bytes);
+    }
 }
 
 void CleanupRenderer() {
-    for (auto& mesh : g_worldMeshes) {
-        glDeleteVertexArrays(1, &mesh.VAO);
-        glDeleteBuffers(1, &mesh.VBO);
+    ClearWorldMeshes();
+    if (g_staticVAO) {
+        glDeleteVertexArrays(1, &g_staticVAO);
+        g_staticVAO = 0;
+        g_staticVAOGeneration[0] = g_staticVAOGeneration[1] = ~0u;
     }
-    g_worldMeshes.clear();
+    g_vertexArena.reset();
+    g_indexArena.reset();
+    if (g_quantizationTexture) {
+        glDeleteTextures(1, &g_quantizationTexture);
+        glDeleteBuffers(1, &g_quantizationBuffer);
+        g_quantizationTexture = 0;
+        g_quantizationBuffer = 0;
+    }
+    g_meshQuantization.clear();
     
     if (g_textureManager) {
         delete g_textureManager;
         g_textureManager = nullptr;
     }
     
-    if (shaderProgram) {
-        glDeleteProgram(shaderProgram);
-        shaderProgram = 0;
+    g_objectConstants.destroy();
+    if (g_frameConstantsBuffer) {
+        glDeleteBuffers(1, &g_frameConstantsBuffer);
+        g_frameConstantsBuffer = 0;
+    }
+    if (g_shaderManager) {
+        delete g_shaderManager;
+        g_shaderManager = nullptr;
+        g_worldShader = nullptr;
     }
 }
\ No newline at end of file
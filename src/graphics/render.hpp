@@ -2,16 +2,49 @@
 #define RENDER_HPP
 
 #include <glm/glm.hpp>
+#include <cstddef>
+#include <cstdint>
 #include <string>
 
 #include "../tmap_parser.hpp"
 
 bool InitRenderer();
-void RenderFrame(int width, int height);
+// alpha is how far between the previous and current simulation tick to draw the camera (0..1)
+void RenderFrame(int width, int height, float alpha = 1.0f);
 void SetCameraPosition(const glm::vec3& position);
 void SetCameraRotation(const glm::vec3& rotation);
+void BeginCameraTick(); // Start of a simulation tick, the current camera becomes the previous one
+void SnapCamera();      // Teleports, no interpolation from the previous camera
 void SetMaterialsPath(const std::string& basePath);
+void SetShaderPath(const std::string& directory); // Game shaders and their binary cache
+void SetShaderHotReload(bool enabled); // On by default, rebuilds shaders whose files change
 void UploadTMAPMeshes(const TMAPData& mapData);
+void UploadTMAPMeshRange(const TMAPData& mapData, size_t first, size_t count, uint32_t group = 0);
+void RemoveWorldMeshGroup(uint32_t group);
+void ClearWorldMeshes();
 void CleanupRenderer();
 
+// Counts from the last RenderFrame
+struct RenderStats {
+    uint32_t meshesTotal = 0;
+    uint32_t meshesVisible = 0; // Passed the frustum test and were drawn
+    uint32_t meshesCulled = 0;
+    // State changes and draws issued for the visible meshes
+    uint32_t programBinds = 0;
+    uint32_t textureBinds = 0;
+    uint32_t vertexArrayBinds = 0;
+    uint32_t drawCalls = 0;  // glDrawElements / glMultiDrawElements calls
+    uint32_t drawRanges = 0; // Index ranges submitted by those calls, after merging neighbours
+    uint32_t triangles = 0;
+    uint32_t meshesReduced = 0; // Drawn at a simplified level of detail
+    uint32_t texturesPending = 0; // Requested but still decoding or uploading
+    uint32_t textureUploadBytes = 0;
+    uint64_t textureBytesResident = 0;
+};
+const RenderStats& GetRenderStats();
+void SetFrustumCulling(bool enabled); // On by default, off draws everything
+void SetViewDistance(float distance); // Far plane, 100 by default
+void SetTextureUploadBudget(size_t bytes); // Per frame, at least one mip level still goes through when over
+void SetTextureMemoryBudget(size_t bytes); // Mip levels and textures are evicted past this, 512 MiB by default
+
 #endif // RENDER_HPP
\ No newline at end of file
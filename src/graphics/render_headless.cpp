@@ -0,0 +1,64 @@
+// Stand-in for render.cpp in builds without a GPU or window (see ManaStormHeadless).
+// Everything the game code calls is accepted and ignored.
+
+#include "render.hpp"
+
+bool InitRenderer() {
+    return true;
+}
+
+void RenderFrame(int, int, float) {
+}
+
+void SetCameraPosition(const glm::vec3&) {
+}
+
+void SetCameraRotation(const glm::vec3&) {
+}
+
+void BeginCameraTick() {
+}
+
+void SnapCamera() {
+}
+
+void SetMaterialsPath(const std::string&) {
+}
+
+void SetShaderPath(const std::string&) {
+}
+
+void SetShaderHotReload(bool) {
+}
+
+void UploadTMAPMeshes(const TMAPData&) {
+}
+
+void UploadTMAPMeshRange(const TMAPData&, size_t, size_t, uint32_t) {
+}
+
+void RemoveWorldMeshGroup(uint32_t) {
+}
+
+void ClearWorldMeshes() {
+}
+
+void CleanupRenderer() {
+}
+
+const RenderStats& GetRenderStats() {
+    static const RenderStats stats;
+    return stats;
+}
+
+void SetFrustumCulling(bool) {
+}
+
+void SetViewDistance(float) {
+}
+
+void SetTextureUploadBudget(size_t) {
+}
+
+void SetTextureMemoryBudget(size_t) {
+}
@@ -1,12 +1,12 @@
 #include "window.hpp"
 
 #include <windows.h>
-#include <iostream>
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
 #include "render.hpp"
+#include "../logging/Logger.hpp"
 
 // Static callback function for mouse button events
 static void mouseButtonCallback(GLFWwindow* window, int button, int action, int mods) {
@@ -25,7 +25,7 @@ static void keyCallback(GLFWwindow* window, int key, int scancode, int action, i
 }
 
 Window::Window(const char* title, bool fullscreen, int width, int height) {
-    std::cout << "Window: Creating window..." << std::endl;
+    LOG_INFO(LogCategory::Window, "Creating window...");
     
     // Configure GLFW for OpenGL 3.3
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
@@ -42,7 +42,7 @@ Window::Window(const char* title, bool fullscreen, int width, int height) {
         ExitProcess(1);
     }
     
-    std::cout << "Window: Window created" << std::endl;
+    LOG_INFO(LogCategory::Window, "Window created");
 
     glfwMakeContextCurrent(m_window);
     
@@ -51,28 +51,28 @@ Window::Window(const char* title, bool fullscreen, int width, int height) {
     glfwSetKeyCallback(m_window, keyCallback);
     
     // Initialize GLEW
-    std::cout << "Window: Initializing GLEW..." << std::endl;
+    LOG_INFO(LogCategory::Window, "Initializing GLEW...");
     GLenum err = glewInit();
     if (err != GLEW_OK) {
-        std::cerr << "GLEW init failed: " << glewGetErrorString(err) << std::endl;
+        LOG_ERROR(LogCategory::Window, "GLEW init failed: " << glewGetErrorString(err));
         MessageBoxA(nullptr, "GLEW initialization failed.", "Fatal Error", MB_ICONERROR);
         ExitProcess(1);
     }
     
-    std::cout << "Window: GLEW initialized" << std::endl;
-    std::cout << "Window: OpenGL Version: " << glGetString(GL_VERSION) << std::endl;
+    LOG_INFO(LogCategory::Window, "GLEW initialized");
+    LOG_INFO(LogCategory::Window, "OpenGL Version: " << glGetString(GL_VERSION));
     
     // Enable depth testing
     glEnable(GL_DEPTH_TEST);
     
     // Initialize renderer
-    std::cout << "Window: Initializing renderer..." << std::endl;
+    LOG_INFO(LogCategory::Window, "Initializing renderer...");
     if (!InitRenderer()) {
         MessageBoxA(nullptr, "Renderer initialization failed.", "Fatal Error", MB_ICONERROR);
         ExitProcess(1);
     }
     
-    std::cout << "Window: Everything initialized successfully!" << std::endl;
+    LOG_INFO(LogCategory::Window, "Everything initialized successfully!");
 }
 
 Window::~Window() {
@@ -80,8 +80,8 @@ Window::~Window() {
     glfwTerminate();
 }
 
-void Window::update(int width, int height) {
-    RenderFrame(width, height); // Render the 3D scene
+void Window::update(int width, int height, float alpha) {
+    RenderFrame(width, height, alpha); // Render the 3D scene
     glfwSwapBuffers(m_window);
     glfwPollEvents();
 }
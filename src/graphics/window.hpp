@@ -10,7 +10,8 @@ public:
     Window(const char* title, bool fullscreen, int width, int height);
     ~Window();
 
-    void update(int width, int height);
+    // Draw a frame with the camera alpha (0..1) of the way from the previous to the current tick
+    void update(int width, int height, float alpha);
     void enterFullscreenNative();
     void exitFullscreen(int width, int height);
     bool shouldClose() const;
@@ -2,8 +2,12 @@
 
 #include <windows.h>
 #include <SDL2/SDL.h>
+#include <GLFW/glfw3.h>
 
 static SDL_GameController* g_controller = nullptr;
+static bool g_haveLastMousePos = false;
+static int g_lastMouseX = 0;
+static int g_lastMouseY = 0;
 
 void InitializeInput() {
     // Initialize controller if available
@@ -73,6 +77,22 @@ ControllerState ProcessInput() {
         state.buttons.grapple |= (state.analog.right_trigger > 0.5f);
     }
     
+    // Mouse look, as whole pixels moved since last time
+    GLFWwindow* window = glfwGetCurrentContext();
+    if (window) {
+        double mousePosX, mousePosY;
+        glfwGetCursorPos(window, &mousePosX, &mousePosY);
+        int mouseX = static_cast<int>(mousePosX);
+        int mouseY = static_cast<int>(mousePosY);
+        if (g_haveLastMousePos) {
+            state.mouse.delta_x = static_cast<float>(mouseX - g_lastMouseX);
+            state.mouse.delta_y = static_cast<float>(mouseY - g_lastMouseY);
+        }
+        g_lastMouseX = mouseX;
+        g_lastMouseY = mouseY;
+        g_haveLastMousePos = true;
+    }
+    
     state.buttons.slide = false; // Temporary: disable sliding until fixed
     return state;
 }
\ No newline at end of file
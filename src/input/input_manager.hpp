@@ -21,9 +21,15 @@ struct ControllerAnalogState {
     float right_trigger = 0.0f;
 };
 
+struct ControllerMouseState {
+    float delta_x = 0.0f; // Cursor movement in pixels since the last ProcessInput call
+    float delta_y = 0.0f;
+};
+
 struct ControllerState {
     ControllerButtonsState buttons;
     ControllerAnalogState analog;
+    ControllerMouseState mouse;
 };
 
 void InitializeInput();
@@ -0,0 +1,229 @@
+#include "input_recording.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "../logging/Logger.hpp"
+
+// File layout:
+//   "TINP", uint32 version, float64 tick rate, uint64 tick count
+//   then runs of: varint repeat count, uint8 buttons, uint8 field mask,
+//   one int16 per set bit in the mask (fields that are zero are left out)
+static const char INPUT_MAGIC[4] = {'T', 'I', 'N', 'P'};
+static const uint32_t INPUT_VERSION = 1;
+static const size_t INPUT_FIELD_COUNT = 8;
+static const size_t TICK_COUNT_OFFSET = 16;
+
+// SDL axes are int16, ProcessInput divides them by this
+static const float AXIS_SCALE = 32767.0f;
+
+static uint8_t packButtons(const ControllerButtonsState& b) {
+    return static_cast<uint8_t>(b.move_forward << 0 | b.move_left << 1 | b.move_backward << 2 | b.move_right << 3 |
+                                b.use << 4 | b.jump << 5 | b.slide << 6 | b.grapple << 7);
+}
+
+static void unpackButtons(uint8_t bits, ControllerButtonsState& b) {
+    b.move_forward = bits & (1 << 0);
+    b.move_left = bits & (1 << 1);
+    b.move_backward = bits & (1 << 2);
+    b.move_right = bits & (1 << 3);
+    b.use = bits & (1 << 4);
+    b.jump = bits & (1 << 5);
+    b.slide = bits & (1 << 6);
+    b.grapple = bits & (1 << 7);
+}
+
+// Analog axes scaled back to SDL's int16 range, mouse deltas as they are
+static void packFields(const ControllerState& state, int16_t fields[INPUT_FIELD_COUNT]) {
+    const float values[INPUT_FIELD_COUNT] = {
+        state.analog.left_x * AXIS_SCALE, state.analog.left_y * AXIS_SCALE,
+        state.analog.right_x * AXIS_SCALE, state.analog.right_y * AXIS_SCALE,
+        state.analog.left_trigger * AXIS_SCALE, state.analog.right_trigger * AXIS_SCALE,
+        state.mouse.delta_x, state.mouse.delta_y
+    };
+    for (size_t i = 0; i < INPUT_FIELD_COUNT; i++) {
+        fields[i] = static_cast<int16_t>(std::clamp(std::lround(values[i]), -32768L, 32767L));
+    }
+}
+
+static void unpackFields(const int16_t fields[INPUT_FIELD_COUNT], ControllerState& state) {
+    // Same division ProcessInput does, so recorded device input comes back bit-identical
+    state.analog.left_x = fields[0] / AXIS_SCALE;
+    state.analog.left_y = fields[1] / AXIS_SCALE;
+    state.analog.right_x = fields[2] / AXIS_SCALE;
+    state.analog.right_y = fields[3] / AXIS_SCALE;
+    state.analog.left_trigger = fields[4] / AXIS_SCALE;
+    state.analog.right_trigger = fields[5] / AXIS_SCALE;
+    state.mouse.delta_x = fields[6];
+    state.mouse.delta_y = fields[7];
+}
+
+static bool sameTick(const ControllerState& a, const ControllerState& b) {
+    int16_t fieldsA[INPUT_FIELD_COUNT], fieldsB[INPUT_FIELD_COUNT];
+    packFields(a, fieldsA);
+    packFields(b, fieldsB);
+    return packButtons(a.buttons) == packButtons(b.buttons) && std::memcmp(fieldsA, fieldsB, sizeof(fieldsA)) == 0;
+}
+
+InputRecorder::~InputRecorder() {
+    close();
+}
+
+bool InputRecorder::open(const std::string& filename, double tickRate) {
+    close();
+    m_file.open(filename, std::ios::binary | std::ios::trunc);
+    if (!m_file) {
+        LOG_ERROR(LogCategory::Input, "Unable to create " << filename);
+        return false;
+    }
+    uint64_t tickCount = 0; // Patched in close()
+    m_file.write(INPUT_MAGIC, sizeof(INPUT_MAGIC));
+    m_file.write(reinterpret_cast<const char*>(&INPUT_VERSION), sizeof(INPUT_VERSION));
+    m_file.write(reinterpret_cast<const char*>(&tickRate), sizeof(tickRate));
+    m_file.write(reinterpret_cast<const char*>(&tickCount), sizeof(tickCount));
+    m_pendingRepeats = 0;
+    m_tickCount = 0;
+    LOG_INFO(LogCategory::Input, "Recording to " << filename);
+    return true;
+}
+
+void InputRecorder::record(const ControllerState& state) {
+    if (!m_file.is_open()) {
+        return;
+    }
+    if (m_pendingRepeats > 0 && sameTick(state, m_pending)) {
+        m_pendingRepeats++;
+    } else {
+        flushPending();
+        m_pending = state;
+        m_pendingRepeats = 1;
+    }
+    m_tickCount++;
+}
+
+void InputRecorder::flushPending() {
+    if (m_pendingRepeats == 0) {
+        return;
+    }
+    
+    uint64_t repeats = m_pendingRepeats;
+    do {
+        uint8_t byte = static_cast<uint8_t>(repeats & 0x7F);
+        repeats >>= 7;
+        if (repeats) {
+            byte |= 0x80;
+        }
+        m_file.put(static_cast<char>(byte));
+    } while (repeats);
+    
+    int16_t fields[INPUT_FIELD_COUNT];
+    packFields(m_pending, fields);
+    uint8_t mask = 0;
+    for (size_t i = 0; i < INPUT_FIELD_COUNT; i++) {
+        mask |= fields[i] != 0 ? (1 << i) : 0;
+    }
+    m_file.put(static_cast<char>(packButtons(m_pending.buttons)));
+    m_file.put(static_cast<char>(mask));
+    for (size_t i = 0; i < INPUT_FIELD_COUNT; i++) {
+        if (fields[i] != 0) {
+            m_file.write(reinterpret_cast<const char*>(&fields[i]), sizeof(int16_t));
+        }
+    }
+    m_pendingRepeats = 0;
+}
+
+void InputRecorder::close() {
+    if (!m_file.is_open()) {
+        return;
+    }
+    flushPending();
+    m_file.seekp(TICK_COUNT_OFFSET);
+    m_file.write(reinterpret_cast<const char*>(&m_tickCount), sizeof(m_tickCount));
+    m_file.close();
+    LOG_INFO(LogCategory::Input, "Recorded " << m_tickCount << " ticks");
+}
+
+bool InputReplay::open(const std::string& filename) {
+    std::ifstream file(filename, std::ios::binary);
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (!file.is_open() || data.size() < TICK_COUNT_OFFSET + sizeof(uint64_t) ||
+        std::memcmp(data.data(), INPUT_MAGIC, sizeof(INPUT_MAGIC)) != 0) {
+        LOG_ERROR(LogCategory::Input, filename << " is not an input recording");
+        return false;
+    }
+    uint32_t version;
+    std::memcpy(&version, data.data() + 4, sizeof(version));
+    if (version != INPUT_VERSION) {
+        LOG_ERROR(LogCategory::Input, "Unsupported recording version " << version);
+        return false;
+    }
+    std::memcpy(&m_tickRate, data.data() + 8, sizeof(m_tickRate));
+    std::memcpy(&m_tickCount, data.data() + TICK_COUNT_OFFSET, sizeof(m_tickCount));
+    
+    m_runs.clear();
+    size_t offset = TICK_COUNT_OFFSET + sizeof(uint64_t);
+    uint64_t ticks = 0;
+    while (offset < data.size()) {
+        Run run = {};
+        int shift = 0;
+        uint8_t byte;
+        do {
+            if (offset >= data.size() || shift > 63) {
+                LOG_ERROR(LogCategory::Input, filename << " is truncated");
+                return false;
+            }
+            byte = data[offset++];
+            run.repeats |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            shift += 7;
+        } while (byte & 0x80);
+        
+        if (offset + 2 > data.size()) {
+            LOG_ERROR(LogCategory::Input, filename << " is truncated");
+            return false;
+        }
+        unpackButtons(data[offset], run.state.buttons);
+        uint8_t mask = data[offset + 1];
+        offset += 2;
+        
+        int16_t fields[INPUT_FIELD_COUNT] = {};
+        for (size_t i = 0; i < INPUT_FIELD_COUNT; i++) {
+            if (mask & (1 << i)) {
+                if (offset + sizeof(int16_t) > data.size()) {
+                    LOG_ERROR(LogCategory::Input, filename << " is truncated");
+                    return false;
+                }
+                std::memcpy(&fields[i], data.data() + offset, sizeof(int16_t));
+                offset += sizeof(int16_t);
+            }
+        }
+        unpackFields(fields, run.state);
+        ticks += run.repeats;
+        m_runs.push_back(run);
+    }
+    
+    if (ticks != m_tickCount) {
+        // Recording was cut short (crash before close), play what's there
+        LOG_ERROR(LogCategory::Input, filename << " holds " << ticks << " of " << m_tickCount << " ticks");
+        m_tickCount = ticks;
+    }
+    m_run = 0;
+    m_runTicksPlayed = 0;
+    m_ticksPlayed = 0;
+    LOG_INFO(LogCategory::Input, "Loaded " << m_tickCount << " ticks from " << filename);
+    return true;
+}
+
+bool InputReplay::next(ControllerState& state) {
+    while (m_run < m_runs.size() && m_runTicksPlayed >= m_runs[m_run].repeats) {
+        m_run++;
+        m_runTicksPlayed = 0;
+    }
+    if (m_run >= m_runs.size()) {
+        return false;
+    }
+    state = m_runs[m_run].state;
+    m_runTicksPlayed++;
+    m_ticksPlayed++;
+    return true;
+}
@@ -0,0 +1,61 @@
+#ifndef INPUT_RECORDING_HPP
+#define INPUT_RECORDING_HPP
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "input_manager.hpp"
+
+// Per-tick ControllerState logs ("TINP" files) for replaying a session exactly.
+// Analog values are stored as the 16-bit values SDL reports them as and mouse deltas
+// as whole pixels, so states coming from real devices replay bit-for-bit. Runs of
+// identical ticks are stored once with a repeat count.
+
+class InputRecorder {
+public:
+    ~InputRecorder();
+
+    bool open(const std::string& filename, double tickRate);
+    void record(const ControllerState& state); // Once per tick
+    void close();
+
+    bool isOpen() const { return m_file.is_open(); }
+    uint64_t getTickCount() const { return m_tickCount; }
+
+private:
+    std::ofstream m_file;
+    ControllerState m_pending;
+    uint64_t m_pendingRepeats = 0;
+    uint64_t m_tickCount = 0;
+
+    void flushPending();
+};
+
+class InputReplay {
+public:
+    bool open(const std::string& filename);
+
+    // State for the next tick, false once the log runs out
+    bool next(ControllerState& state);
+
+    double getTickRate() const { return m_tickRate; }
+    uint64_t getTickCount() const { return m_tickCount; }
+    uint64_t getTicksPlayed() const { return m_ticksPlayed; }
+    bool isFinished() const { return m_ticksPlayed >= m_tickCount; }
+
+private:
+    struct Run {
+        ControllerState state;
+        uint64_t repeats;
+    };
+    std::vector<Run> m_runs;
+    size_t m_run = 0;
+    uint64_t m_runTicksPlayed = 0;
+    double m_tickRate = 60.0;
+    uint64_t m_tickCount = 0;
+    uint64_t m_ticksPlayed = 0;
+};
+
+#endif // INPUT_RECORDING_HPP
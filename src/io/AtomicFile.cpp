@@ -0,0 +1,41 @@
+#include "AtomicFile.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+bool writeFileAtomically(const std::string& path, const void* header, size_t headerSize,
+                         const void* table, size_t tableSize, const std::vector<FileBlob>& blobs,
+                         size_t alignment) {
+    std::string tempPath = path + ".tmp";
+    std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        return false;
+    }
+
+    out.write(static_cast<const char*>(header), static_cast<std::streamsize>(headerSize));
+    if (tableSize > 0) {
+        out.write(static_cast<const char*>(table), static_cast<std::streamsize>(tableSize));
+    }
+    size_t position = headerSize + tableSize;
+    const std::vector<char> zeros(alignment, 0);
+    for (size_t i = 0; i < blobs.size() && out; i++) {
+        if (blobs[i].size == 0) {
+            continue;
+        }
+        size_t offset = alignFileOffset(position, alignment);
+        out.write(zeros.data(), static_cast<std::streamsize>(offset - position));
+        out.write(static_cast<const char*>(blobs[i].data), static_cast<std::streamsize>(blobs[i].size));
+        position = offset + blobs[i].size;
+    }
+    out.close();
+
+    std::error_code error;
+    if (out) {
+        std::filesystem::rename(tempPath, path, error);
+    }
+    if (!out || error) {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+    return true;
+}
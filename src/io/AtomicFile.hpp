@@ -0,0 +1,28 @@
+#ifndef ATOMIC_FILE_HPP
+#define ATOMIC_FILE_HPP
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// One piece of data for writeFileAtomically
+struct FileBlob {
+    const void* data;
+    size_t size;
+};
+
+// Where writeFileAtomically puts things: the first blob starts at
+// alignFileOffset(headerSize + tableSize), each one after at alignFileOffset(previous end).
+// Empty blobs take no space.
+inline size_t alignFileOffset(size_t offset, size_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+// Write header, table, then the blobs zero-padded to their aligned offsets. The file is
+// written under a temporary name and renamed over path once complete, so a crash never
+// leaves half a file behind. On failure path is left as it was and false is returned.
+bool writeFileAtomically(const std::string& path, const void* header, size_t headerSize,
+                         const void* table, size_t tableSize, const std::vector<FileBlob>& blobs,
+                         size_t alignment);
+
+#endif // ATOMIC_FILE_HPP
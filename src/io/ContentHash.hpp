@@ -0,0 +1,11 @@
+#ifndef CONTENT_HASH_HPP
+#define CONTENT_HASH_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// 64-bit hash of a block of memory (XXH64), for telling whether cached data still
+// matches its source. Fast enough to run over a whole mapped file, not cryptographic.
+uint64_t hashContent(const void* data, size_t size, uint64_t seed = 0);
+
+#endif // CONTENT_HASH_HPP
@@ -0,0 +1,44 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <cstddef>
+#include <string>
+
+// Read-only memory mapping of a whole file.
+// The mapping stays valid until close() or destruction, so anything holding
+// pointers into data() must keep the MappedFile alive.
+// A copy-on-write mapping can also be written through mutableData(). Touched pages
+// become private copies and the file on disk is never modified.
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // Map the file at 'filename'. Returns false if it can't be opened or mapped.
+    bool open(const std::string& filename, bool copyOnWrite = false);
+    void close();
+
+    bool isOpen() const { return m_isOpen; }
+    const std::byte* data() const { return m_data; }
+    size_t size() const { return m_size; }
+    // nullptr unless the file was opened copy-on-write
+    std::byte* mutableData() const { return m_copyOnWrite ? m_data : nullptr; }
+
+private:
+    std::byte* m_data = nullptr;
+    size_t m_size = 0;
+    bool m_isOpen = false;
+    bool m_copyOnWrite = false;
+
+#ifdef _WIN32
+    void* m_fileHandle = nullptr;
+    void* m_mappingHandle = nullptr;
+#endif
+};
+
+#endif // MAPPED_FILE_HPP
@@ -0,0 +1,239 @@
+#include "Logger.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+namespace {
+
+struct LogNode {
+    std::atomic<LogNode*> next{nullptr};
+    LogCategory category = LogCategory::General;
+    LogLevel level = LogLevel::Info;
+    double seconds = 0.0;
+    std::string message;
+};
+
+// Vyukov's intrusive multi-producer single-consumer queue. Pushing is one exchange and
+// one store, no locks and no retry loops. Only the writer thread pops.
+class LogQueue {
+public:
+    LogQueue() : head(&stub), tail(&stub) {}
+
+    void push(LogNode* node) {
+        node->next.store(nullptr, std::memory_order_relaxed);
+        LogNode* previous = head.exchange(node, std::memory_order_acq_rel);
+        previous->next.store(node, std::memory_order_release);
+    }
+
+    // nullptr when empty, or when a producer is halfway through pushing the next node
+    LogNode* pop() {
+        LogNode* first = tail;
+        LogNode* next = first->next.load(std::memory_order_acquire);
+        if (first == &stub) {
+            if (!next) {
+                return nullptr;
+            }
+            tail = next;
+            first = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+        if (next) {
+            tail = next;
+            return first;
+        }
+        if (first != head.load(std::memory_order_acquire)) {
+            return nullptr;
+        }
+
+        // Last node, put the stub back behind it so it can be handed out
+        push(&stub);
+        next = first->next.load(std::memory_order_acquire);
+        if (next) {
+            tail = next;
+            return first;
+        }
+        return nullptr;
+    }
+
+private:
+    std::atomic<LogNode*> head;
+    LogNode* tail;
+    LogNode stub;
+};
+
+void writeLine(const LogNode& node) {
+    std::FILE* out = node.level >= LogLevel::Warning ? stderr : stdout;
+    std::fprintf(out, "[%9.3f] %-7s %s: %s\n", node.seconds, Logger::levelName(node.level),
+                 Logger::categoryName(node.category), node.message.c_str());
+}
+
+struct LogState {
+    std::atomic<uint8_t> levels[static_cast<size_t>(LogCategory::Count)];
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+    LogQueue queue;
+    std::atomic<uint64_t> queued{0};
+    std::atomic<uint64_t> written{0};
+    std::atomic<uint32_t> wakeups{0}; // The writer sleeps on this
+    std::atomic<bool> running{true};
+    std::atomic<bool> stopping{false};
+    std::mutex syncMutex; // Writing directly once the thread is gone
+    std::thread writer;
+
+    LogState() {
+        for (auto& level : levels) {
+            level.store(static_cast<uint8_t>(LogLevel::Info), std::memory_order_relaxed);
+        }
+        writer = std::thread(&LogState::run, this);
+    }
+
+    ~LogState() {
+        stop();
+    }
+
+    void run() {
+        while (true) {
+            uint32_t seenWakeups = wakeups.load(std::memory_order_acquire);
+            uint64_t count = 0;
+            while (LogNode* node = queue.pop()) {
+                writeLine(*node);
+                delete node;
+                count++;
+            }
+            if (count > 0) {
+                std::fflush(stdout);
+                std::fflush(stderr);
+                written.fetch_add(count, std::memory_order_release);
+                written.notify_all();
+            }
+
+            if (written.load(std::memory_order_relaxed) < queued.load(std::memory_order_acquire)) {
+                std::this_thread::yield(); // A push is still linking its node in
+                continue;
+            }
+            if (stopping.load(std::memory_order_acquire)) {
+                return;
+            }
+            wakeups.wait(seenWakeups, std::memory_order_acquire);
+        }
+    }
+
+    void stop() {
+        if (!running.exchange(false)) {
+            return;
+        }
+        stopping.store(true, std::memory_order_release);
+        wakeups.fetch_add(1, std::memory_order_release);
+        wakeups.notify_one();
+        writer.join();
+
+        // Anything a racing write() managed to queue after the thread left
+        std::lock_guard<std::mutex> lock(syncMutex);
+        while (LogNode* node = queue.pop()) {
+            writeLine(*node);
+            delete node;
+        }
+        std::fflush(stdout);
+    }
+};
+
+LogState& state() {
+    static LogState logState;
+    return logState;
+}
+
+} // namespace
+
+void Logger::setLevel(LogLevel level) {
+    for (auto& categoryLevel : state().levels) {
+        categoryLevel.store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+    }
+}
+
+void Logger::setLevel(LogCategory category, LogLevel level) {
+    state().levels[static_cast<size_t>(category)].store(static_cast<uint8_t>(level), std::memory_order_relaxed);
+}
+
+bool Logger::isEnabled(LogCategory category, LogLevel level) {
+    return static_cast<uint8_t>(level) >= state().levels[static_cast<size_t>(category)].load(std::memory_order_relaxed);
+}
+
+void Logger::write(LogCategory category, LogLevel level, std::string message) {
+    LogState& log = state();
+    auto* node = new LogNode();
+    node->category = category;
+    node->level = level;
+    node->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - log.startTime).count();
+    node->message = std::move(message);
+
+    if (!log.running.load(std::memory_order_acquire)) {
+        std::lock_guard<std::mutex> lock(log.syncMutex);
+        writeLine(*node);
+        std::fflush(node->level >= LogLevel::Warning ? stderr : stdout);
+        delete node;
+        return;
+    }
+
+    log.queue.push(node);
+    log.queued.fetch_add(1, std::memory_order_release);
+    log.wakeups.fetch_add(1, std::memory_order_release);
+    log.wakeups.notify_one();
+
+    if (level >= LogLevel::Error) {
+        flush();
+    }
+}
+
+void Logger::flush() {
+    LogState& log = state();
+    uint64_t target = log.queued.load(std::memory_order_acquire);
+    uint64_t written = log.written.load(std::memory_order_acquire);
+    while (written < target && log.running.load(std::memory_order_acquire)) {
+        log.written.wait(written, std::memory_order_acquire);
+        written = log.written.load(std::memory_order_acquire);
+    }
+}
+
+void Logger::shutdown() {
+    state().stop();
+}
+
+const char* Logger::levelName(LogLevel level) {
+    switch (level) {
+        case LogLevel::Trace: return "Trace";
+        case LogLevel::Debug: return "Debug";
+        case LogLevel::Info: return "Info";
+        case LogLevel::Warning: return "Warning";
+        case LogLevel::Error: return "Error";
+        default: return "Off";
+    }
+}
+
+const char* Logger::categoryName(LogCategory category) {
+    switch (category) {
+        case LogCategory::Game: return "Game";
+        case LogCategory::Map: return "TMAP";
+        case LogCategory::Physics: return "Physics";
+        case LogCategory::Render: return "Render";
+        case LogCategory::Texture: return "TextureManager";
+        case LogCategory::Window: return "Window";
+        case LogCategory::Input: return "Input";
+        case LogCategory::Streaming: return "WorldStreamer";
+        case LogCategory::Profiler: return "Profiler";
+        default: return "General";
+    }
+}
+
+bool Logger::parseLevel(const std::string& name, LogLevel& outLevel) {
+    static const char* const NAMES[] = {"trace", "debug", "info", "warning", "error", "off"};
+    for (size_t i = 0; i < sizeof(NAMES) / sizeof(NAMES[0]); i++) {
+        if (name == NAMES[i]) {
+            outLevel = static_cast<LogLevel>(i);
+            return true;
+        }
+    }
+    return false;
+}
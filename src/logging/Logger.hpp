@@ -0,0 +1,112 @@
+#ifndef LOGGER_HPP
+#define LOGGER_HPP
+
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+// Asynchronous logger. Messages are formatted on the calling thread, pushed onto a
+// lock-free queue and written out by a background thread, so logging from load jobs
+// or the game loop never waits on the console.
+//
+//   LOG_INFO(LogCategory::Physics, "Loaded " << count << " shapes");
+//
+// Levels below MANASTORM_LOG_LEVEL are compiled out entirely, including the formatting.
+// Above that, each category can be raised or lowered at runtime with setLevel.
+
+#define MANASTORM_LOG_LEVEL_TRACE 0
+#define MANASTORM_LOG_LEVEL_DEBUG 1
+#define MANASTORM_LOG_LEVEL_INFO 2
+#define MANASTORM_LOG_LEVEL_WARNING 3
+#define MANASTORM_LOG_LEVEL_ERROR 4
+
+#ifndef MANASTORM_LOG_LEVEL
+#ifdef NDEBUG
+#define MANASTORM_LOG_LEVEL MANASTORM_LOG_LEVEL_INFO
+#else
+#define MANASTORM_LOG_LEVEL MANASTORM_LOG_LEVEL_DEBUG
+#endif
+#endif
+
+enum class LogLevel : uint8_t {
+    Trace = MANASTORM_LOG_LEVEL_TRACE,
+    Debug = MANASTORM_LOG_LEVEL_DEBUG,
+    Info = MANASTORM_LOG_LEVEL_INFO,
+    Warning = MANASTORM_LOG_LEVEL_WARNING,
+    Error = MANASTORM_LOG_LEVEL_ERROR,
+    Off
+};
+
+enum class LogCategory : uint8_t {
+    General,
+    Game,
+    Map,       // TMAP reading and writing
+    Physics,
+    Render,
+    Texture,
+    Window,
+    Input,
+    Streaming,
+    Profiler,
+    Count
+};
+
+class Logger {
+public:
+    // Messages below this level are dropped before formatting. Info by default.
+    static void setLevel(LogLevel level);
+    static void setLevel(LogCategory category, LogLevel level);
+    static bool isEnabled(LogCategory category, LogLevel level);
+
+    // Queue a message for the writer thread. Errors are flushed before returning so
+    // they're on screen even if the process dies right after.
+    static void write(LogCategory category, LogLevel level, std::string message);
+
+    // Block until everything queued so far has been written
+    static void flush();
+
+    // Flush and stop the writer thread, later messages are written synchronously.
+    // Also runs at exit.
+    static void shutdown();
+
+    static const char* levelName(LogLevel level);
+    static const char* categoryName(LogCategory category);
+    static bool parseLevel(const std::string& name, LogLevel& outLevel);
+};
+
+#define LOG_AT(category, level, message) \
+    do { \
+        if (Logger::isEnabled(category, level)) { \
+            std::ostringstream logStream_; \
+            logStream_ << message; \
+            Logger::write(category, level, logStream_.str()); \
+        } \
+    } while (0)
+
+#if MANASTORM_LOG_LEVEL <= MANASTORM_LOG_LEVEL_TRACE
+#define LOG_TRACE(category, message) LOG_AT(category, LogLevel::Trace, message)
+#else
+#define LOG_TRACE(category, message) ((void)0)
+#endif
+
+#if MANASTORM_LOG_LEVEL <= MANASTORM_LOG_LEVEL_DEBUG
+#define LOG_DEBUG(category, message) LOG_AT(category, LogLevel::Debug, message)
+#else
+#define LOG_DEBUG(category, message) ((void)0)
+#endif
+
+#if MANASTORM_LOG_LEVEL <= MANASTORM_LOG_LEVEL_INFO
+#define LOG_INFO(category, message) LOG_AT(category, LogLevel::Info, message)
+#else
+#define LOG_INFO(category, message) ((void)0)
+#endif
+
+#if MANASTORM_LOG_LEVEL <= MANASTORM_LOG_LEVEL_WARNING
+#define LOG_WARNING(category, message) LOG_AT(category, LogLevel::Warning, message)
+#else
+#define LOG_WARNING(category, message) ((void)0)
+#endif
+
+#define LOG_ERROR(category, message) LOG_AT(category, LogLevel::Error, message)
+
+#endif // LOGGER_HPP
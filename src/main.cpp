@@ -2,8 +2,11 @@
 // I will be flummoxed if anyone ever finds this in the games memory dump
 const char thankyou[32] __attribute__((used, section(".rodata"))) = "Thank you for playing our game!";
 
+#include <algorithm>
 #include <chrono>
-#include <iostream>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
 #include <thread>
 #include <unordered_map>
 #include <windows.h>
@@ -13,6 +16,7 @@ const char thankyou[32] __attribute__((used, section(".rodata"))) = "Thank you f
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
 
+#include "FixedStepScheduler.hpp"
 #include "GameMeta.hpp"
 #include "game_process.hpp"
 #include "config/EngineConfig.hpp"
@@ -20,13 +24,38 @@ const char thankyou[32] __attribute__((used, section(".rodata"))) = "Thank you f
 #include "graphics/TextureManager.hpp"
 #include "graphics/window.hpp"
 #include "input/input_manager.hpp"
+#include "input/input_recording.hpp"
+#include "logging/Logger.hpp"
+#include "profiling/Profiler.hpp"
 
 const std::string CONFIG_FILE_NAME = "engine_config.json";
 const std::string META_FILE_NAME = "game_meta.json";
-const double TICK_RATE = 1.0 / 60.0; // Game runs at 60 ticks per second, interpolated rendering
 int framerateLimit = 120; // TODO: Make this configurable later, if 0 then uncapped
+const double LOAD_FINALIZE_BUDGET = 0.004; // Seconds per frame spent uploading a freshly loaded level
+
+// Command line:
+//   --record <file>     Save every tick's input once the level is loaded
+//   --replay <file>     Play a recording back instead of reading devices, exits when it ends
+//   --frame-log <file>  CSV of frame time, tick time, culling and draw counts for every frame
+//   --trace <file>      Chrome trace of the last profiled frames, written on exit
+int main(int argc, char* argv[]) {
+    Profiler::setThreadName("Main");
+    std::string recordPath, replayPath, frameLogPath, tracePath;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string arg = argv[i];
+        if (arg == "--record") {
+            recordPath = argv[i + 1];
+        } else if (arg == "--replay") {
+            replayPath = argv[i + 1];
+        } else if (arg == "--frame-log") {
+            frameLogPath = argv[i + 1];
+        } else if (arg == "--trace") {
+            tracePath = argv[i + 1];
+        } else {
+            LOG_WARNING(LogCategory::Game, "Unknown option " << arg);
+        }
+    }
 
-int main() {
     // Initialize game development libraries
     if (!glfwInit()) {
         MessageBoxA(nullptr, "Failed to initialize GLFW.", "Fatal Error", MB_ICONERROR);
@@ -43,6 +72,12 @@ int main() {
     // Load engine configuration
     EngineConfig engineConfig;
     engineConfig.loadFromFile("../dat/" + CONFIG_FILE_NAME);
+    LogLevel logLevel;
+    if (Logger::parseLevel(engineConfig.getLogLevel(), logLevel)) {
+        Logger::setLevel(logLevel);
+    } else {
+        LOG_WARNING(LogCategory::General, "Unknown log level " << engineConfig.getLogLevel());
+    }
 
     // Load game metadata
     GameMeta gameMeta;
@@ -64,12 +99,36 @@ int main() {
 
     // Set up the materials path for the renderer
     SetMaterialsPath("../" + gameMeta.getDirectory() + "/materials");
-
-    // Set the TMAP file
-    if (!setTmap("../" + gameMeta.getDirectory() + "/maps/test.tmap")) {
-        std::cerr << "Failed to load TMAP file." << std::endl;
+    SetShaderPath("../" + gameMeta.getDirectory() + "/shaders");
+    SetShaderHotReload(engineConfig.isShaderHotReloadEnabled());
+    SetViewDistance(engineConfig.getViewDistance());
+    SetTextureUploadBudget(static_cast<size_t>(std::max(engineConfig.getTextureUploadBudgetKB(), 1)) * 1024);
+    SetTextureMemoryBudget(static_cast<size_t>(std::max(engineConfig.getTextureMemoryBudgetMB(), 1)) * 1024 * 1024);
+
+    StaticCollisionOptions collisionOptions;
+    collisionOptions.merge = engineConfig.isStaticCollisionMerged();
+    collisionOptions.maxPartitionTriangles = static_cast<size_t>(std::max(engineConfig.getStaticPartitionTriangles(), 1));
+    setStaticCollisionOptions(collisionOptions);
+    setMeshOptimizationOnLoad(engineConfig.isMeshOptimizationOnLoadEnabled());
+
+    // Set the TMAP file, it loads in the background while the main loop runs
+    if (!requestTmapLoad("../" + gameMeta.getDirectory() + "/maps/test.tmap")) {
+        LOG_ERROR(LogCategory::Game, "Failed to load TMAP file.");
         return 1;
     }
+    bool levelLoaded = false;
+
+    // Optional streamed world, chunks in maps/world are loaded around the player as they move
+    const std::string worldDirectory = "../" + gameMeta.getDirectory() + "/maps/world";
+    if (std::filesystem::is_directory(worldDirectory)) {
+        WorldStreamerSettings streamingSettings;
+        streamingSettings.loadRadius = engineConfig.getStreamingLoadRadius();
+        streamingSettings.unloadRadius = engineConfig.getStreamingUnloadRadius();
+        streamingSettings.memoryBudgetBytes = static_cast<size_t>(engineConfig.getStreamingMemoryBudgetMB()) * 1024 * 1024;
+        streamingSettings.collision = collisionOptions;
+        streamingSettings.optimizeMeshes = engineConfig.isMeshOptimizationOnLoadEnabled();
+        startWorldStreaming(worldDirectory, streamingSettings);
+    }
 
     /* Old system, don't use. Doesn't account for tick rate and frame rate being separate.
     while (!window.shouldClose()) {
@@ -79,23 +138,84 @@ int main() {
     }
     */
 
+    // Game runs at a fixed tick rate (60 per second by default), frames are drawn interpolated between ticks
+    FixedStepScheduler scheduler(engineConfig.getTickRate(), engineConfig.getMaxTicksPerFrame());
+    uint64_t droppedTicksReported = 0;
+
+    // Recording and replay only cover ticks with the level loaded, load time varies between runs
+    InputRecorder recorder;
+    InputReplay replay;
+    if (!recordPath.empty() && !recorder.open(recordPath, 1.0 / scheduler.getTickSeconds())) {
+        return 1;
+    }
+    if (!replayPath.empty()) {
+        if (!replay.open(replayPath)) {
+            return 1;
+        }
+        if (std::abs(replay.getTickRate() * scheduler.getTickSeconds() - 1.0) > 1e-6) {
+            LOG_WARNING(LogCategory::Input, "Replay recorded at " << replay.getTickRate() << " ticks per second, playing at "
+                                            << 1.0 / scheduler.getTickSeconds() << ", it won't match");
+        }
+    }
+    std::ofstream frameLog;
+    if (!frameLogPath.empty()) {
+        frameLog.open(frameLogPath, std::ios::trunc);
+        frameLog << "frame,frame_ms,ticks,tick_ms,meshes_visible,meshes_culled,draw_calls,texture_binds,vao_binds,triangles,meshes_reduced" << std::endl;
+    }
+    uint64_t frameCount = 0;
+    bool replayFinished = false;
+
     using clock = std::chrono::high_resolution_clock;
     auto previous = clock::now();
-    double lag = 0.0;
-    while (!window.shouldClose()) {
+    while (!window.shouldClose() && !replayFinished) {
+        PROFILE_ZONE("Frame");
         auto current = clock::now();
         std::chrono::duration<double> elapsed = current - previous;
         previous = current;
-        lag += elapsed.count();
 
-        // Process input and update window
-        window.update(windowWidth, windowHeight);
+        // Finish off any level load that's done in the background, a few meshes per frame
+        updateTmapLoad(LOAD_FINALIZE_BUDGET);
+        TmapLoadStatus loadStatus = getTmapLoadStatus();
+        if (loadStatus.stage == LevelLoadStage::Done) {
+            levelLoaded = true;
+        } else if (loadStatus.stage == LevelLoadStage::Failed && !levelLoaded) {
+            LOG_ERROR(LogCategory::Game, "Failed to load TMAP file.");
+            return 1;
+        }
+        updateWorldStreaming(LOAD_FINALIZE_BUDGET);
 
         // Update game logic at fixed tick rate
-        while (lag >= TICK_RATE) {
-            runGameProcess(TICK_RATE);
-            lag -= TICK_RATE;
+        int ticks = scheduler.advance(elapsed.count());
+        auto ticksStart = clock::now();
+        for (int i = 0; i < ticks; i++) {
+            ControllerState input = ProcessInput(); // Always, this also pumps SDL events
+            if (levelLoaded && replay.getTickCount() > 0 && !replay.next(input)) {
+                LOG_INFO(LogCategory::Input, "Replay finished after " << replay.getTicksPlayed() << " ticks");
+                replayFinished = true;
+                break;
+            }
+            if (levelLoaded) {
+                recorder.record(input);
+            }
+            runGameProcess(static_cast<float>(scheduler.getTickSeconds()), input);
         }
+        std::chrono::duration<double, std::milli> tickTime = clock::now() - ticksStart;
+        if (scheduler.getDroppedTicks() != droppedTicksReported) {
+            LOG_WARNING(LogCategory::Game, "Simulation fell behind, dropped " << scheduler.getDroppedTicks() - droppedTicksReported
+                                           << " ticks (" << scheduler.getDroppedTicks() << " total)");
+            droppedTicksReported = scheduler.getDroppedTicks();
+        }
+
+        // Render in between the last two ticks, then process input
+        window.update(windowWidth, windowHeight, scheduler.getAlpha());
+        if (frameLog.is_open()) {
+            const RenderStats& renderStats = GetRenderStats();
+            frameLog << frameCount << ',' << elapsed.count() * 1000.0 << ',' << ticks << ',' << tickTime.count() << ','
+                     << renderStats.meshesVisible << ',' << renderStats.meshesCulled << ',' << renderStats.drawCalls << ','
+                     << renderStats.textureBinds << ',' << renderStats.vertexArrayBinds << ',' << renderStats.triangles << ','
+                     << renderStats.meshesReduced << '\n';
+        }
+        frameCount++;
 
         // Sleep to maintain frame rate limit
         if (framerateLimit > 0) {
@@ -103,5 +223,11 @@ int main() {
         }
     }
 
+    Profiler::printZoneStats();
+    if (!tracePath.empty()) {
+        Profiler::writeChromeTrace(tracePath);
+    }
+    Logger::shutdown();
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,234 @@
+#include "Profiler.hpp"
+#include "../logging/Logger.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+
+// Written only by the owning thread, read by whoever exports. Every field is atomic
+// (relaxed, so plain stores on x86) so reading a slot that's being overwritten is
+// merely stale rather than a data race. Readers check the write count afterwards
+// and drop anything that may have been overwritten while they read.
+struct ProfileEvent {
+    std::atomic<uint64_t> start{0};
+    std::atomic<uint64_t> end{0};
+    std::atomic<uint32_t> zoneId{0};
+    std::atomic<uint32_t> depth{0};
+};
+
+struct ThreadBuffer {
+    uint32_t threadId = 0;
+    std::string name;
+    std::atomic<uint64_t> written{0};
+    uint32_t depth = 0; // Owning thread only
+    std::unique_ptr<ProfileEvent[]> events{new ProfileEvent[Profiler::EVENTS_PER_THREAD]};
+};
+
+struct EventCopy {
+    uint64_t start;
+    uint64_t end;
+    uint32_t zoneId;
+    uint32_t depth;
+    uint32_t threadId;
+};
+
+std::mutex g_registryMutex;
+std::vector<const char*> g_zoneNames;
+// Buffers are never freed, a thread's events stay exportable after it exits
+std::vector<ThreadBuffer*> g_threadBuffers;
+
+ThreadBuffer& threadBuffer() {
+    thread_local ThreadBuffer* buffer = [] {
+        auto* created = new ThreadBuffer();
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        created->threadId = static_cast<uint32_t>(g_threadBuffers.size());
+        created->name = "Thread " + std::to_string(created->threadId);
+        g_threadBuffers.push_back(created);
+        return created;
+    }();
+    return *buffer;
+}
+
+// Consistent copy of the events in every ring buffer
+std::vector<EventCopy> snapshotEvents(std::vector<std::string>* threadNames) {
+    std::vector<ThreadBuffer*> buffers;
+    {
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        buffers = g_threadBuffers;
+        if (threadNames) {
+            for (ThreadBuffer* buffer : buffers) {
+                threadNames->push_back(buffer->name);
+            }
+        }
+    }
+    
+    std::vector<EventCopy> events;
+    for (ThreadBuffer* buffer : buffers) {
+        uint64_t writtenBefore = buffer->written.load(std::memory_order_acquire);
+        uint64_t first = writtenBefore > Profiler::EVENTS_PER_THREAD ? writtenBefore - Profiler::EVENTS_PER_THREAD : 0;
+        size_t copiedFrom = events.size();
+        for (uint64_t i = first; i < writtenBefore; i++) {
+            const ProfileEvent& event = buffer->events[i % Profiler::EVENTS_PER_THREAD];
+            events.push_back({event.start.load(std::memory_order_relaxed), event.end.load(std::memory_order_relaxed),
+                              event.zoneId.load(std::memory_order_relaxed), event.depth.load(std::memory_order_relaxed),
+                              buffer->threadId});
+        }
+        
+        // Slots the owner lapped while we were copying hold newer events now, drop them.
+        // The +1 covers the slot it may be halfway through writing.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t writtenAfter = buffer->written.load(std::memory_order_relaxed);
+        uint64_t lapped = writtenAfter + 1 > first + Profiler::EVENTS_PER_THREAD ? writtenAfter + 1 - first - Profiler::EVENTS_PER_THREAD : 0;
+        lapped = std::min<uint64_t>(lapped, writtenBefore - first);
+        events.erase(events.begin() + copiedFrom, events.begin() + copiedFrom + lapped);
+    }
+    return events;
+}
+
+} // namespace
+
+uint32_t Profiler::registerZone(const char* name) {
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    g_zoneNames.push_back(name);
+    return static_cast<uint32_t>(g_zoneNames.size() - 1);
+}
+
+uint64_t Profiler::now() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+uint32_t Profiler::enterZone() {
+    return threadBuffer().depth++;
+}
+
+void Profiler::leaveZone() {
+    threadBuffer().depth--;
+}
+
+void Profiler::record(uint32_t zoneId, uint64_t start, uint64_t end, uint32_t depth) {
+    ThreadBuffer& buffer = threadBuffer();
+    uint64_t index = buffer.written.load(std::memory_order_relaxed);
+    ProfileEvent& event = buffer.events[index % EVENTS_PER_THREAD];
+    event.start.store(start, std::memory_order_relaxed);
+    event.end.store(end, std::memory_order_relaxed);
+    event.zoneId.store(zoneId, std::memory_order_relaxed);
+    event.depth.store(depth, std::memory_order_relaxed);
+    buffer.written.store(index + 1, std::memory_order_release);
+}
+
+void Profiler::setThreadName(const std::string& name) {
+    ThreadBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(g_registryMutex);
+    buffer.name = name;
+}
+
+std::vector<ProfileZoneStats> Profiler::getZoneStats() {
+    std::vector<EventCopy> events = snapshotEvents(nullptr);
+    std::vector<const char*> names;
+    {
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        names = g_zoneNames;
+    }
+    
+    // Zone sites sharing a name (PROFILE_FUNCTION in overloads) are reported together
+    std::unordered_map<std::string, std::vector<double>> durations;
+    for (const auto& event : events) {
+        if (event.zoneId < names.size()) {
+            durations[names[event.zoneId]].push_back((event.end - event.start) / 1e6);
+        }
+    }
+    
+    std::vector<ProfileZoneStats> stats;
+    for (auto& [name, times] : durations) {
+        std::sort(times.begin(), times.end());
+        ProfileZoneStats zone;
+        zone.name = name;
+        zone.count = times.size();
+        zone.p50Ms = times[times.size() / 2];
+        zone.p99Ms = times[std::min(times.size() - 1, times.size() * 99 / 100)];
+        zone.maxMs = times.back();
+        for (double time : times) {
+            zone.totalMs += time;
+        }
+        stats.push_back(zone);
+    }
+    std::sort(stats.begin(), stats.end(), [](const ProfileZoneStats& a, const ProfileZoneStats& b) {
+        return a.totalMs > b.totalMs;
+    });
+    return stats;
+}
+
+void Profiler::printZoneStats() {
+    Logger::flush(); // Keep the table below anything already logged
+    std::vector<ProfileZoneStats> stats = getZoneStats();
+    if (stats.empty()) {
+        return;
+    }
+    std::printf("%-32s %8s %10s %10s %10s %12s\n", "Zone", "Count", "p50 ms", "p99 ms", "max ms", "total ms");
+    for (const auto& zone : stats) {
+        std::printf("%-32s %8llu %10.3f %10.3f %10.3f %12.3f\n", zone.name.c_str(),
+                    static_cast<unsigned long long>(zone.count), zone.p50Ms, zone.p99Ms, zone.maxMs, zone.totalMs);
+    }
+}
+
+bool Profiler::writeChromeTrace(const std::string& filename) {
+    std::vector<std::string> threadNames;
+    std::vector<EventCopy> events = snapshotEvents(&threadNames);
+    std::vector<const char*> names;
+    {
+        std::lock_guard<std::mutex> lock(g_registryMutex);
+        names = g_zoneNames;
+    }
+    
+    std::FILE* file = std::fopen(filename.c_str(), "w");
+    if (!file) {
+        LOG_ERROR(LogCategory::Profiler, "Unable to write " << filename);
+        return false;
+    }
+    
+    // Timestamps relative to the first event, in microseconds as the format wants
+    uint64_t origin = UINT64_MAX;
+    for (const auto& event : events) {
+        origin = std::min(origin, event.start);
+    }
+    
+    // Zone and thread names come from code, quotes and backslashes are all that needs escaping
+    auto writeString = [&](const std::string& text) {
+        std::fputc('"', file);
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                std::fputc('\\', file);
+            }
+            std::fputc(c, file);
+        }
+        std::fputc('"', file);
+    };
+    
+    std::fprintf(file, "{\"traceEvents\":[\n");
+    bool first = true;
+    for (size_t i = 0; i < threadNames.size(); i++) {
+        std::fprintf(file, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":", first ? "" : ",\n", i);
+        writeString(threadNames[i]);
+        std::fprintf(file, "}}");
+        first = false;
+    }
+    for (const auto& event : events) {
+        std::fprintf(file, "%s{\"ph\":\"X\",\"name\":", first ? "" : ",\n");
+        writeString(event.zoneId < names.size() ? names[event.zoneId] : "?");
+        std::fprintf(file, ",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", event.threadId,
+                     (event.start - origin) / 1e3, (event.end - event.start) / 1e3);
+        first = false;
+    }
+    std::fprintf(file, "\n]}\n");
+    bool ok = std::fclose(file) == 0;
+    
+    LOG_INFO(LogCategory::Profiler, "Wrote " << events.size() << " events to " << filename);
+    return ok;
+}
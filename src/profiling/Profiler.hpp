@@ -0,0 +1,77 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Scoped-zone profiler. Each thread records zone begin/end times into its own ring
+// buffer (no locks or allocation on the hot path), and the newest events can be
+// exported as a Chrome trace (chrome://tracing, Perfetto) or summarised per zone.
+//
+// Instrument code with PROFILE_ZONE("Name") or PROFILE_FUNCTION() at the top of a
+// scope. Building without MANASTORM_PROFILING compiles every zone out.
+
+struct ProfileZoneStats {
+    std::string name;
+    uint64_t count = 0;  // Events still in the ring buffers
+    double p50Ms = 0.0;
+    double p99Ms = 0.0;
+    double maxMs = 0.0;
+    double totalMs = 0.0;
+};
+
+class Profiler {
+public:
+    // Events kept per thread, older ones are overwritten
+    static const size_t EVENTS_PER_THREAD = 1 << 16;
+
+    // Zone ids are handed out once per PROFILE_ZONE site, the name must outlive the program
+    static uint32_t registerZone(const char* name);
+
+    static uint64_t now();
+    static void record(uint32_t zoneId, uint64_t start, uint64_t end, uint32_t depth);
+    static uint32_t enterZone(); // Returns the nesting depth of the new zone
+    static void leaveZone();
+
+    // Shown in the trace instead of the thread number
+    static void setThreadName(const std::string& name);
+
+    // Rolling statistics over what's currently in the ring buffers, sorted by total time
+    static std::vector<ProfileZoneStats> getZoneStats();
+    static void printZoneStats();
+
+    // Chrome trace-event JSON of everything in the ring buffers
+    static bool writeChromeTrace(const std::string& filename);
+};
+
+class ProfileScope {
+public:
+    explicit ProfileScope(uint32_t zoneId) : zoneId(zoneId), depth(Profiler::enterZone()), start(Profiler::now()) {}
+    ~ProfileScope() {
+        Profiler::record(zoneId, start, Profiler::now(), depth);
+        Profiler::leaveZone();
+    }
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    uint32_t zoneId;
+    uint32_t depth;
+    uint64_t start;
+};
+
+#ifdef MANASTORM_PROFILING
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_ZONE(name) \
+    static const uint32_t PROFILE_CONCAT(profileZoneId_, __LINE__) = Profiler::registerZone(name); \
+    ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(PROFILE_CONCAT(profileZoneId_, __LINE__))
+#define PROFILE_FUNCTION() PROFILE_ZONE(__func__)
+#else
+#define PROFILE_ZONE(name) ((void)0)
+#define PROFILE_FUNCTION() ((void)0)
+#endif
+
+#endif // PROFILER_HPP
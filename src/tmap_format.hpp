@@ -0,0 +1,68 @@
+#ifndef TMAP_FORMAT_HPP
+#define TMAP_FORMAT_HPP
+
+#include <cstdint>
+
+#include "tmap_parser.hpp"
+
+// On-disk layout of TMAP v2, shared by the parser and the writer.
+// Everything is little-endian, see tmap_struct.txt for the full description.
+
+const uint32_t TMAP_V2_ALIGNMENT = 16;
+
+struct TMAPHeaderV2 {
+    char magic[4];              // 'TMAP'
+    uint32_t version;           // 2
+    uint32_t meshCount;
+    uint32_t flags;             // TMAP_FLAG_*
+    Vec3 spawnPosition;
+    Vec3 spawnRotation;
+    Vec3 mapOffset;
+    Vec3 boundsMin;             // Union of all mesh bounds
+    Vec3 boundsMax;
+    uint32_t reserved;
+};
+
+// One per mesh, directly after the header
+struct TMAPMeshEntryV2 {
+    uint64_t offset;            // From the start of the file, 16-byte aligned
+    uint64_t size;              // Size of the whole mesh record including its arrays
+};
+
+// Start of every mesh record, followed by the name and material strings and then the arrays.
+// Array offsets are relative to the start of the record and 16-byte aligned, 0 means absent.
+struct TMAPMeshRecordV2 {
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint16_t indexSize;         // 0 (unindexed), 2 or 4 bytes
+    uint16_t nameLength;
+    uint16_t materialLength;
+    uint16_t reserved0;
+    Vec3 boundsMin;
+    Vec3 boundsMax;
+    uint32_t positionsOffset;   // Vec3[vertexCount]
+    uint32_t normalsOffset;     // Vec3[vertexCount]
+    uint32_t uvsOffset;         // Vec2[vertexCount]
+    uint32_t indicesOffset;     // uint16/uint32[indexCount]
+    uint32_t lodsOffset;        // TMAPLodV2[lodCount], 0 when there are none
+    uint32_t lodCount;
+};
+
+// Level of detail table entry, the indices use the record's indexSize
+struct TMAPLodV2 {
+    uint32_t indexCount;
+    uint32_t indicesOffset;     // Relative to the record like the other arrays
+    float error;                // Map units
+    uint32_t reserved;
+};
+
+static_assert(sizeof(TMAPHeaderV2) == 80, "TMAP v2 header layout changed");
+static_assert(sizeof(TMAPMeshEntryV2) == 16, "TMAP v2 mesh table layout changed");
+static_assert(sizeof(TMAPMeshRecordV2) == 64, "TMAP v2 mesh record layout changed");
+static_assert(sizeof(TMAPLodV2) == 16, "TMAP v2 LOD table layout changed");
+
+inline uint64_t alignTMAPOffset(uint64_t offset) {
+    return (offset + TMAP_V2_ALIGNMENT - 1) & ~uint64_t(TMAP_V2_ALIGNMENT - 1);
+}
+
+#endif // TMAP_FORMAT_HPP
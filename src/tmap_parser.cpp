@@ -1,113 +1,392 @@
 #include "tmap_parser.hpp"
-#include <fstream>
-#include <iostream>
+#include "tmap_format.hpp"
+#include "ThreadPool.hpp"
+#include "logging/Logger.hpp"
+#include "profiling/Profiler.hpp"
+#include <algorithm>
 
-std::string readString(std::ifstream& file) {
-    uint16_t length;
-    file.read(reinterpret_cast<char*>(&length), sizeof(length));
-    
-    std::string str(length, '\0');
-    file.read(&str[0], length);
-    return str;
+// Bounds-checked cursor over the mapped file
+struct TMAPReader {
+    const std::byte* data;
+    size_t size;
+    size_t offset = 0;
+    bool failed = false;
+
+    const std::byte* take(size_t bytes) {
+        if (failed || bytes > size - offset) {
+            failed = true;
+            return nullptr;
+        }
+        const std::byte* ptr = data + offset;
+        offset += bytes;
+        return ptr;
+    }
+
+    template <typename T>
+    T read() {
+        T value{};
+        if (const std::byte* ptr = take(sizeof(T))) {
+            std::memcpy(&value, ptr, sizeof(T));
+        }
+        return value;
+    }
+};
+
+static std::string readString(TMAPReader& reader) {
+    uint16_t length = reader.read<uint16_t>();
+    const std::byte* chars = reader.take(length);
+    if (!chars) {
+        return std::string();
+    }
+    return std::string(reinterpret_cast<const char*>(chars), length);
 }
 
-Vec3 readVec3(std::ifstream& file) {
-    Vec3 v;
-    file.read(reinterpret_cast<char*>(&v.x), sizeof(float));
-    file.read(reinterpret_cast<char*>(&v.y), sizeof(float));
-    file.read(reinterpret_cast<char*>(&v.z), sizeof(float));
-    return v;
+static Vec3 readVec3(TMAPReader& reader) {
+    return reader.read<Vec3>();
 }
 
-Vec2 readVec2(std::ifstream& file) {
-    Vec2 v;
-    file.read(reinterpret_cast<char*>(&v.u), sizeof(float));
-    file.read(reinterpret_cast<char*>(&v.v), sizeof(float));
-    return v;
+static void computeBounds(Mesh& mesh) {
+    if (mesh.vertices.empty()) {
+        mesh.boundsMin = mesh.boundsMax = Vec3{0.0f, 0.0f, 0.0f};
+        return;
+    }
+    Vec3 lo = mesh.vertices[0];
+    Vec3 hi = mesh.vertices[0];
+    for (const Vec3& v : mesh.vertices) {
+        lo.x = std::min(lo.x, v.x); hi.x = std::max(hi.x, v.x);
+        lo.y = std::min(lo.y, v.y); hi.y = std::max(hi.y, v.y);
+        lo.z = std::min(lo.z, v.z); hi.z = std::max(hi.z, v.z);
+    }
+    mesh.boundsMin = lo;
+    mesh.boundsMax = hi;
 }
 
-Mesh readMesh(std::ifstream& file) {
+// View 'count' elements of T in place, or copy them into storage if the file position isn't aligned for T
+template <typename T>
+static std::span<const T> readArray(TMAPReader& reader, TMAPStorage& storage) {
+    uint32_t count = reader.read<uint32_t>();
+    if (count > (reader.size - reader.offset) / sizeof(T)) {
+        reader.failed = true;
+        return {};
+    }
+    const std::byte* ptr = reader.take(count * sizeof(T));
+    if (!ptr) {
+        return {};
+    }
+    if (reinterpret_cast<uintptr_t>(ptr) % alignof(T) != 0) {
+        return storage.store<T>(ptr, count);
+    }
+    return std::span<const T>(reinterpret_cast<const T*>(ptr), count);
+}
+
+static Mesh readMesh(TMAPReader& reader, TMAPStorage& storage) {
     Mesh mesh;
     
-    mesh.name = readString(file);
+    mesh.name = readString(reader);
+    mesh.vertices = readArray<Vec3>(reader, storage);
+    mesh.normals = readArray<Vec3>(reader, storage);
+    mesh.uvs = readArray<Vec2>(reader, storage);
+    mesh.material = readString(reader);
+    computeBounds(mesh);
     
-    // Read vertices
-    uint32_t vertCount;
-    file.read(reinterpret_cast<char*>(&vertCount), sizeof(vertCount));
-    mesh.vertices.reserve(vertCount);
-    for(uint32_t i = 0; i < vertCount; i++) {
-        mesh.vertices.push_back(readVec3(file));
+    return mesh;
+}
+
+// Step over one v1 mesh record without decoding it, used to find where each mesh starts
+static void skipMesh(TMAPReader& reader) {
+    reader.take(reader.read<uint16_t>());                       // Name
+    reader.take(size_t(reader.read<uint32_t>()) * sizeof(Vec3)); // Vertices
+    reader.take(size_t(reader.read<uint32_t>()) * sizeof(Vec3)); // Normals
+    reader.take(size_t(reader.read<uint32_t>()) * sizeof(Vec2)); // UVs
+    reader.take(reader.read<uint16_t>());                       // Material
+}
+
+static void logMeshes(const TMAPData& data) {
+    for (size_t i = 0; i < data.meshes.size(); i++) {
+        const Mesh& mesh = data.meshes[i];
+        LOG_DEBUG(LogCategory::Map, "Mesh " << i << ": " << mesh.name
+                                    << " (" << mesh.vertices.size() << " verts, " << mesh.indexCount() << " indices)");
     }
+}
+
+// v1: meshes are stored back to back, spawn data comes after the last one.
+// A quick serial pass finds where every mesh starts, then they are decoded in parallel.
+static bool loadTMAPv1(TMAPReader& reader, TMAPStorage& storage, TMAPData& data, TMAPLoadProgress* progress) {
+    // Read mesh count
+    uint32_t meshCount = reader.read<uint32_t>();
+    LOG_INFO(LogCategory::Map, "Mesh count: " << meshCount);
     
-    // Read normals
-    uint32_t normalCount;
-    file.read(reinterpret_cast<char*>(&normalCount), sizeof(normalCount));
-    mesh.normals.reserve(normalCount);
-    for(uint32_t i = 0; i < normalCount; i++) {
-        mesh.normals.push_back(readVec3(file));
+    // Every mesh record is at least 16 bytes so a bogus count can't make us over-reserve
+    std::vector<size_t> meshOffsets;
+    meshOffsets.reserve(std::min<size_t>(meshCount, reader.size / 16));
+    for (uint32_t i = 0; i < meshCount && !reader.failed; i++) {
+        meshOffsets.push_back(reader.offset);
+        skipMesh(reader);
     }
     
-    // Read UVs
-    uint32_t uvCount;
-    file.read(reinterpret_cast<char*>(&uvCount), sizeof(uvCount));
-    mesh.uvs.reserve(uvCount);
-    for(uint32_t i = 0; i < uvCount; i++) {
-        mesh.uvs.push_back(readVec2(file));
+    // Read spawn data
+    data.spawnPosition = readVec3(reader);
+    data.spawnRotation = readVec3(reader);
+    data.mapOffset = readVec3(reader);
+    
+    if (reader.failed) {
+        return false;
+    }
+    
+    if (progress) {
+        progress->meshCount = static_cast<uint32_t>(meshOffsets.size());
     }
     
-    // Read material
-    mesh.material = readString(file);
+    data.meshes.resize(meshOffsets.size());
+    getThreadPool().parallelFor(meshOffsets.size(), [&](size_t i) {
+        TMAPReader meshReader{reader.data, reader.size, meshOffsets[i]};
+        data.meshes[i] = readMesh(meshReader, storage);
+        if (progress) {
+            progress->meshesDecoded++;
+        }
+    });
     
-    return mesh;
+    logMeshes(data);
+    return true;
+}
+
+// Check that an array of 'count' T at 'offset' lies inside a record of 'recordSize' bytes and is aligned.
+// Offset 0 means absent, so it's only valid for an empty array: viewArray would give no elements.
+template <typename T>
+static bool arrayInRecord(uint32_t offset, uint64_t count, uint64_t recordSize) {
+    return (offset != 0 || count == 0) && offset % TMAP_V2_ALIGNMENT == 0 && offset <= recordSize &&
+           count <= (recordSize - offset) / sizeof(T);
+}
+
+template <typename T>
+static std::span<const T> viewArray(const std::byte* record, uint32_t offset, uint32_t count) {
+    if (offset == 0) {
+        return {};
+    }
+    return std::span<const T>(reinterpret_cast<const T*>(record + offset), count);
 }
 
-bool loadTMAP(const std::string& filename, TMAPData& outData) {
-    std::cout << "TMAP: Loading " << filename << std::endl;
+template <typename T>
+static bool indicesInRange(std::span<const T> indices, uint32_t vertexCount) {
+    T maxIndex = 0;
+    for (T index : indices) {
+        maxIndex = std::max(maxIndex, index);
+    }
+    return indices.empty() || maxIndex < vertexCount;
+}
+
+// v2: decode one mesh record through the offset table, the arrays are viewed in place
+static bool readMeshV2(const TMAPReader& reader, const TMAPMeshEntryV2& entry, Mesh& mesh) {
+    if (entry.offset % TMAP_V2_ALIGNMENT != 0 || entry.offset > reader.size ||
+        entry.size > reader.size - entry.offset || entry.size < sizeof(TMAPMeshRecordV2)) {
+        return false;
+    }
     
-    std::ifstream file(filename, std::ios::binary);
+    const std::byte* recordBase = reader.data + entry.offset;
+    TMAPMeshRecordV2 record;
+    std::memcpy(&record, recordBase, sizeof(record));
     
-    if(!file.is_open()) {
-        std::cerr << "TMAP: Failed to open file" << std::endl;
+    uint64_t stringBytes = uint64_t(record.nameLength) + record.materialLength;
+    if (stringBytes > entry.size - sizeof(record)) {
         return false;
     }
+    const char* strings = reinterpret_cast<const char*>(recordBase + sizeof(record));
+    mesh.name.assign(strings, record.nameLength);
+    mesh.material.assign(strings + record.nameLength, record.materialLength);
+    
+    bool valid = arrayInRecord<Vec3>(record.positionsOffset, record.vertexCount, entry.size) &&
+                 arrayInRecord<Vec3>(record.normalsOffset, record.normalsOffset ? record.vertexCount : 0, entry.size) &&
+                 arrayInRecord<Vec2>(record.uvsOffset, record.uvsOffset ? record.vertexCount : 0, entry.size) &&
+                 record.indexCount % 3 == 0;
+    if (record.indexSize == 2) {
+        valid = valid && arrayInRecord<uint16_t>(record.indicesOffset, record.indexCount, entry.size);
+    } else if (record.indexSize == 4) {
+        valid = valid && arrayInRecord<uint32_t>(record.indicesOffset, record.indexCount, entry.size);
+    } else {
+        valid = valid && record.indexSize == 0 && record.indexCount == 0;
+    }
+    if (!valid) {
+        return false;
+    }
+    
+    mesh.vertices = viewArray<Vec3>(recordBase, record.positionsOffset, record.vertexCount);
+    mesh.normals = viewArray<Vec3>(recordBase, record.normalsOffset, record.vertexCount);
+    mesh.uvs = viewArray<Vec2>(recordBase, record.uvsOffset, record.vertexCount);
+    if (record.indexSize == 2) {
+        mesh.indices16 = viewArray<uint16_t>(recordBase, record.indicesOffset, record.indexCount);
+    } else if (record.indexSize == 4) {
+        mesh.indices32 = viewArray<uint32_t>(recordBase, record.indicesOffset, record.indexCount);
+    }
+    mesh.boundsMin = record.boundsMin;
+    mesh.boundsMax = record.boundsMax;
+    
+    // A bad index would have the renderer and Bullet read past the vertex arrays
+    valid = indicesInRange(mesh.indices16, record.vertexCount) && indicesInRange(mesh.indices32, record.vertexCount);
+    
+    // Levels of detail, older files have zeros here
+    if (record.lodCount > 0) {
+        if (record.indexSize == 0 || record.lodCount > TMAP_MAX_LODS ||
+            !arrayInRecord<TMAPLodV2>(record.lodsOffset, record.lodCount, entry.size)) {
+            return false;
+        }
+        mesh.lods.resize(record.lodCount);
+        for (uint32_t i = 0; i < record.lodCount && valid; i++) {
+            TMAPLodV2 lodEntry;
+            std::memcpy(&lodEntry, recordBase + record.lodsOffset + i * sizeof(TMAPLodV2), sizeof(lodEntry));
+            MeshLod& lod = mesh.lods[i];
+            lod.error = lodEntry.error;
+            valid = lodEntry.indexCount % 3 == 0;
+            if (record.indexSize == 2) {
+                valid = valid && arrayInRecord<uint16_t>(lodEntry.indicesOffset, lodEntry.indexCount, entry.size);
+                lod.indices16 = viewArray<uint16_t>(recordBase, lodEntry.indicesOffset, lodEntry.indexCount);
+            } else {
+                valid = valid && arrayInRecord<uint32_t>(lodEntry.indicesOffset, lodEntry.indexCount, entry.size);
+                lod.indices32 = viewArray<uint32_t>(recordBase, lodEntry.indicesOffset, lodEntry.indexCount);
+            }
+            valid = valid && indicesInRange(lod.indices16, record.vertexCount) && indicesInRange(lod.indices32, record.vertexCount);
+        }
+    }
+    return valid;
+}
+
+// v2: fixed header with the spawn data, then an offset table pointing at each mesh record
+static bool loadTMAPv2(TMAPReader& reader, TMAPData& data, TMAPLoadProgress* progress) {
+    TMAPHeaderV2 header;
+    if (reader.size < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, reader.data, sizeof(header));
+    LOG_INFO(LogCategory::Map, "Mesh count: " << header.meshCount);
+    
+    if (header.meshCount > (reader.size - sizeof(header)) / sizeof(TMAPMeshEntryV2)) {
+        return false;
+    }
+    const std::byte* table = reader.data + sizeof(header);
+    
+    data.spawnPosition = header.spawnPosition;
+    data.spawnRotation = header.spawnRotation;
+    data.mapOffset = header.mapOffset;
+    data.flags = header.flags;
+    
+    if (progress) {
+        progress->meshCount = header.meshCount;
+    }
+    
+    // Records are found through the offset table, so every mesh decodes independently
+    data.meshes.resize(header.meshCount);
+    std::vector<char> meshValid(header.meshCount, 0);
+    getThreadPool().parallelFor(header.meshCount, [&](size_t i) {
+        TMAPMeshEntryV2 entry;
+        std::memcpy(&entry, table + i * sizeof(entry), sizeof(entry));
+        meshValid[i] = readMeshV2(reader, entry, data.meshes[i]);
+        if (progress) {
+            progress->meshesDecoded++;
+        }
+    });
+    
+    for (uint32_t i = 0; i < header.meshCount; i++) {
+        if (!meshValid[i]) {
+            LOG_ERROR(LogCategory::Map, "Mesh " << i << " has a corrupt record");
+            return false;
+        }
+    }
+    
+    logMeshes(data);
+    return true;
+}
+
+bool readTMAPSummary(const std::string& filename, TMAPSummary& outSummary) {
+    MappedFile file;
+    if (!file.open(filename)) {
+        LOG_ERROR(LogCategory::Map, "Failed to open " << filename);
+        return false;
+    }
+    
+    TMAPReader reader{file.data(), file.size()};
+    const std::byte* magic = reader.take(4);
+    if (!magic || std::memcmp(magic, "TMAP", 4) != 0) {
+        LOG_ERROR(LogCategory::Map, "Invalid magic bytes in " << filename);
+        return false;
+    }
+    
+    TMAPSummary summary{};
+    summary.version = reader.read<uint32_t>();
+    summary.meshCount = reader.read<uint32_t>();
+    summary.fileSize = file.size();
+    
+    if (summary.version == TMAP_VERSION_INDEXED) {
+        TMAPHeaderV2 header;
+        if (file.size() < sizeof(header)) {
+            return false;
+        }
+        std::memcpy(&header, file.data(), sizeof(header));
+        summary.mapOffset = header.mapOffset;
+        summary.hasBounds = true;
+        summary.boundsMin = header.boundsMin;
+        summary.boundsMax = header.boundsMax;
+    } else if (summary.version == TMAP_VERSION_SEQUENTIAL) {
+        // v1 ends with the map offset
+        if (reader.failed || file.size() < 12 + sizeof(Vec3)) {
+            return false;
+        }
+        std::memcpy(&summary.mapOffset, file.data() + file.size() - sizeof(Vec3), sizeof(Vec3));
+        summary.hasBounds = false;
+    } else {
+        LOG_ERROR(LogCategory::Map, "Unsupported version " << summary.version << " in " << filename);
+        return false;
+    }
+    
+    outSummary = summary;
+    return !reader.failed;
+}
+
+bool loadTMAP(const std::string& filename, TMAPData& outData, TMAPLoadProgress* progress) {
+    PROFILE_FUNCTION();
+    LOG_INFO(LogCategory::Map, "Loading " << filename);
+    
+    auto storage = std::make_shared<TMAPStorage>();
+    if (!storage->file.open(filename)) {
+        LOG_ERROR(LogCategory::Map, "Failed to open file");
+        return false;
+    }
+    
+    TMAPReader reader{storage->file.data(), storage->file.size()};
     
     // Check magic bytes
-    char magic[4];
-    file.read(magic, 4);
-    if(std::string(magic, 4) != "TMAP") {
-        std::cerr << "TMAP: Invalid magic bytes" << std::endl;
+    const std::byte* magic = reader.take(4);
+    if (!magic || std::memcmp(magic, "TMAP", 4) != 0) {
+        LOG_ERROR(LogCategory::Map, "Invalid magic bytes");
         return false;
     }
-    std::cout << "TMAP: Magic bytes OK" << std::endl;
+    LOG_DEBUG(LogCategory::Map, "Magic bytes OK");
     
-    // Read version
-    file.read(reinterpret_cast<char*>(&outData.version), sizeof(outData.version));
-    std::cout << "TMAP: Version " << outData.version << std::endl;
+    TMAPData data;
     
-    // Read mesh count
-    uint32_t meshCount;
-    file.read(reinterpret_cast<char*>(&meshCount), sizeof(meshCount));
-    std::cout << "TMAP: Mesh count: " << meshCount << std::endl;
+    // Read version
+    data.version = reader.read<uint32_t>();
+    LOG_DEBUG(LogCategory::Map, "Version " << data.version);
     
-    // Read meshes
-    outData.meshes.reserve(meshCount);
-    for(uint32_t i = 0; i < meshCount; i++) {
-        Mesh mesh = readMesh(file);
-        std::cout << "TMAP:   Mesh " << i << ": " << mesh.name 
-                  << " (" << mesh.vertices.size() << " verts)" << std::endl;
-        outData.meshes.push_back(mesh);
+    bool ok;
+    if (data.version == TMAP_VERSION_SEQUENTIAL) {
+        ok = loadTMAPv1(reader, *storage, data, progress);
+    } else if (data.version == TMAP_VERSION_INDEXED) {
+        ok = loadTMAPv2(reader, data, progress);
+    } else {
+        LOG_ERROR(LogCategory::Map, "Unsupported version " << data.version);
+        return false;
     }
     
-    // Read spawn data
-    outData.spawnPosition = readVec3(file);
-    outData.spawnRotation = readVec3(file);
-    outData.mapOffset = readVec3(file);
+    if (!ok) {
+        LOG_ERROR(LogCategory::Map, "File is truncated or corrupt");
+        return false;
+    }
     
-    std::cout << "TMAP: Spawn at (" << outData.spawnPosition.x << ", " 
-              << outData.spawnPosition.y << ", " << outData.spawnPosition.z << ")" << std::endl;
+    LOG_INFO(LogCategory::Map, "Spawn at (" << data.spawnPosition.x << ", "
+                               << data.spawnPosition.y << ", " << data.spawnPosition.z << ")");
     
-    file.close();
+    data.storage = std::move(storage);
+    outData = std::move(data);
     
-    std::cout << "TMAP: Load successful!" << std::endl;
+    LOG_INFO(LogCategory::Map, "Load successful!");
     return true;
-}
\ No newline at end of file
+}
@@ -4,6 +4,14 @@
 #include <vector>
 #include <string>
 #include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <span>
+
+#include "io/MappedFile.hpp"
 
 struct Vec3 {
     float x, y, z;
@@ -13,12 +21,51 @@ struct Vec2 {
     float u, v;
 };
 
+// Memory that the Mesh views point into.
+// Arrays are viewed straight out of the file mapping when they are suitably
+// aligned, anything that isn't gets copied into 'copies' instead.
+struct TMAPStorage {
+    MappedFile file;
+    std::vector<std::vector<std::byte>> copies;
+    std::mutex copiesMutex;
+
+    // Copy 'count' elements into storage owned by this object and return a view of the copy.
+    // Safe to call from several decode threads at once.
+    template <typename T>
+    std::span<const T> store(const void* src, size_t count);
+};
+
+// A simplified version of a mesh: another index buffer into the same vertices
+struct MeshLod {
+    std::span<const uint16_t> indices16; // Same index size as the mesh's own
+    std::span<const uint32_t> indices32;
+    float error; // How far the simplified surface strays from the full mesh, in map units
+    
+    size_t indexCount() const { return indices16.empty() ? indices32.size() : indices16.size(); }
+};
+
 struct Mesh {
     std::string name;
-    std::vector<Vec3> vertices;
-    std::vector<Vec3> normals;
-    std::vector<Vec2> uvs;
+    std::span<const Vec3> vertices;
+    std::span<const Vec3> normals;
+    std::span<const Vec2> uvs;
     std::string material;
+    
+    // Index buffer (v2 only), at most one of these is non-empty.
+    // Unindexed meshes are triangle soups where every 3 vertices make a triangle.
+    std::span<const uint16_t> indices16;
+    std::span<const uint32_t> indices32;
+    
+    // Coarser levels of detail (v2 only), finest first, see MeshSimplifier
+    std::vector<MeshLod> lods;
+    
+    // Axis-aligned bounds of the vertices, in map space (before mapOffset)
+    Vec3 boundsMin;
+    Vec3 boundsMax;
+    
+    bool isIndexed() const { return !indices16.empty() || !indices32.empty(); }
+    size_t indexCount() const { return indices16.empty() ? indices32.size() : indices16.size(); }
+    size_t triangleCount() const { return (isIndexed() ? indexCount() : vertices.size()) / 3; }
 };
 
 struct TMAPData {
@@ -27,8 +74,60 @@ struct TMAPData {
     Vec3 spawnPosition;
     Vec3 spawnRotation;
     Vec3 mapOffset;
+    uint32_t flags = 0; // TMAP_FLAG_* from the v2 header, 0 for v1
+    // MESH_OPTIMIZER_VERSION if the meshes were reordered after loading (see MeshOptimizer),
+    // anything cached from the triangle order has to tell that apart from the file's order
+    uint32_t loadTimeOptimizerVersion = 0;
+
+    // Keeps the mesh views valid, share it with anything that outlives this TMAPData
+    std::shared_ptr<TMAPStorage> storage;
+};
+
+// TMAP format versions understood by loadTMAP (see tmap_struct.txt)
+const uint32_t TMAP_VERSION_SEQUENTIAL = 1;
+const uint32_t TMAP_VERSION_INDEXED = 2;
+
+// v2 header flags
+const uint32_t TMAP_FLAG_OPTIMIZED = 1; // Meshes went through tmap_convert --optimize
+
+// Most levels of detail a v2 mesh record may carry
+const uint32_t TMAP_MAX_LODS = 8;
+
+// What can be learned about a TMAP without decoding its meshes
+struct TMAPSummary {
+    uint32_t version;
+    uint32_t meshCount;
+    uint64_t fileSize;
+    Vec3 mapOffset;
+    // Map bounds in map space, only v2 stores them
+    bool hasBounds;
+    Vec3 boundsMin;
+    Vec3 boundsMax;
 };
 
-bool loadTMAP(const std::string& filename, TMAPData& outData);
+// Read just the header (and for v1, the trailing spawn/offset block)
+bool readTMAPSummary(const std::string& filename, TMAPSummary& outSummary);
+
+// Counters a loader thread updates while loadTMAP runs, readable from any thread
+struct TMAPLoadProgress {
+    std::atomic<uint32_t> meshCount{0};
+    std::atomic<uint32_t> meshesDecoded{0};
+};
+
+// Loads both v1 and v2 files. Meshes are decoded in parallel on the shared
+// thread pool but always come back in file order.
+bool loadTMAP(const std::string& filename, TMAPData& outData, TMAPLoadProgress* progress = nullptr);
+
+template <typename T>
+std::span<const T> TMAPStorage::store(const void* src, size_t count) {
+    std::vector<std::byte> copy(count * sizeof(T));
+    if (count > 0) {
+        std::memcpy(copy.data(), src, count * sizeof(T));
+    }
+    const T* data = reinterpret_cast<const T*>(copy.data());
+    std::lock_guard<std::mutex> lock(copiesMutex);
+    copies.push_back(std::move(copy));
+    return std::span<const T>(data, count);
+}
 
-#endif // TMAP_PARSER_HPP
\ No newline at end of file
+#endif // TMAP_PARSER_HPP
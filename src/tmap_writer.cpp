@@ -0,0 +1,147 @@
+#include "tmap_writer.hpp"
+#include "tmap_format.hpp"
+#include "logging/Logger.hpp"
+#include <algorithm>
+#include <fstream>
+#include <vector>
+
+// Copy 'bytes' bytes to 'offset' in the output buffer
+static void put(std::vector<std::byte>& out, uint64_t offset, const void* src, size_t bytes) {
+    if (bytes > 0) {
+        std::memcpy(out.data() + offset, src, bytes);
+    }
+}
+
+bool saveTMAP(const std::string& filename, const TMAPData& mapData) {
+    uint32_t meshCount = static_cast<uint32_t>(mapData.meshes.size());
+    
+    // Lay out every mesh record first so the whole file can be written in one go
+    std::vector<TMAPMeshEntryV2> table(meshCount);
+    std::vector<TMAPMeshRecordV2> records(meshCount);
+    std::vector<std::vector<TMAPLodV2>> lodTables(meshCount);
+    uint64_t fileSize = alignTMAPOffset(sizeof(TMAPHeaderV2) + meshCount * sizeof(TMAPMeshEntryV2));
+    
+    Vec3 boundsMin{0.0f, 0.0f, 0.0f};
+    Vec3 boundsMax{0.0f, 0.0f, 0.0f};
+    
+    for (uint32_t i = 0; i < meshCount; i++) {
+        const Mesh& mesh = mapData.meshes[i];
+        TMAPMeshRecordV2& record = records[i];
+        record = TMAPMeshRecordV2{};
+        
+        if (mesh.name.size() > UINT16_MAX || mesh.material.size() > UINT16_MAX ||
+            mesh.vertices.size() > UINT32_MAX || mesh.indexCount() > UINT32_MAX) {
+            LOG_ERROR(LogCategory::Map, "Mesh " << mesh.name << " is too large for the v2 format");
+            return false;
+        }
+        
+        record.vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+        record.indexCount = static_cast<uint32_t>(mesh.indexCount());
+        record.indexSize = !mesh.indices16.empty() ? 2 : !mesh.indices32.empty() ? 4 : 0;
+        record.nameLength = static_cast<uint16_t>(mesh.name.size());
+        record.materialLength = static_cast<uint16_t>(mesh.material.size());
+        record.boundsMin = mesh.boundsMin;
+        record.boundsMax = mesh.boundsMax;
+        
+        uint64_t size = sizeof(TMAPMeshRecordV2) + mesh.name.size() + mesh.material.size();
+        auto placeArray = [&size](size_t bytes) -> uint32_t {
+            if (bytes == 0) {
+                return 0;
+            }
+            size = alignTMAPOffset(size);
+            uint32_t offset = static_cast<uint32_t>(size);
+            size += bytes;
+            return offset;
+        };
+        record.positionsOffset = placeArray(mesh.vertices.size_bytes());
+        // Normals and UVs are per vertex in v2, anything else is dropped
+        record.normalsOffset = mesh.normals.size() == mesh.vertices.size() ? placeArray(mesh.normals.size_bytes()) : 0;
+        record.uvsOffset = mesh.uvs.size() == mesh.vertices.size() ? placeArray(mesh.uvs.size_bytes()) : 0;
+        record.indicesOffset = placeArray(mesh.indexCount() * record.indexSize);
+        if (record.indexSize != 0 && !mesh.lods.empty()) {
+            record.lodCount = static_cast<uint32_t>(std::min<size_t>(mesh.lods.size(), TMAP_MAX_LODS));
+            record.lodsOffset = placeArray(record.lodCount * sizeof(TMAPLodV2));
+            for (uint32_t lod = 0; lod < record.lodCount; lod++) {
+                lodTables[i].push_back({static_cast<uint32_t>(mesh.lods[lod].indexCount()),
+                                        placeArray(mesh.lods[lod].indexCount() * record.indexSize),
+                                        mesh.lods[lod].error, 0});
+            }
+        }
+        
+        if (size > UINT32_MAX) {
+            LOG_ERROR(LogCategory::Map, "Mesh " << mesh.name << " is too large for the v2 format");
+            return false;
+        }
+        
+        table[i].offset = fileSize;
+        table[i].size = size;
+        fileSize = alignTMAPOffset(fileSize + size);
+        
+        if (i == 0) {
+            boundsMin = mesh.boundsMin;
+            boundsMax = mesh.boundsMax;
+        } else {
+            boundsMin = Vec3{std::min(boundsMin.x, mesh.boundsMin.x), std::min(boundsMin.y, mesh.boundsMin.y), std::min(boundsMin.z, mesh.boundsMin.z)};
+            boundsMax = Vec3{std::max(boundsMax.x, mesh.boundsMax.x), std::max(boundsMax.y, mesh.boundsMax.y), std::max(boundsMax.z, mesh.boundsMax.z)};
+        }
+    }
+    
+    std::vector<std::byte> out(fileSize);
+    
+    TMAPHeaderV2 header{};
+    std::memcpy(header.magic, "TMAP", 4);
+    header.version = TMAP_VERSION_INDEXED;
+    header.meshCount = meshCount;
+    header.flags = mapData.flags;
+    header.spawnPosition = mapData.spawnPosition;
+    header.spawnRotation = mapData.spawnRotation;
+    header.mapOffset = mapData.mapOffset;
+    header.boundsMin = boundsMin;
+    header.boundsMax = boundsMax;
+    put(out, 0, &header, sizeof(header));
+    put(out, sizeof(header), table.data(), table.size() * sizeof(TMAPMeshEntryV2));
+    
+    for (uint32_t i = 0; i < meshCount; i++) {
+        const Mesh& mesh = mapData.meshes[i];
+        const TMAPMeshRecordV2& record = records[i];
+        uint64_t base = table[i].offset;
+        
+        put(out, base, &record, sizeof(record));
+        put(out, base + sizeof(record), mesh.name.data(), mesh.name.size());
+        put(out, base + sizeof(record) + mesh.name.size(), mesh.material.data(), mesh.material.size());
+        if (record.positionsOffset) put(out, base + record.positionsOffset, mesh.vertices.data(), mesh.vertices.size_bytes());
+        if (record.normalsOffset) put(out, base + record.normalsOffset, mesh.normals.data(), mesh.normals.size_bytes());
+        if (record.uvsOffset) put(out, base + record.uvsOffset, mesh.uvs.data(), mesh.uvs.size_bytes());
+        if (record.indexSize == 2) put(out, base + record.indicesOffset, mesh.indices16.data(), mesh.indices16.size_bytes());
+        if (record.indexSize == 4) put(out, base + record.indicesOffset, mesh.indices32.data(), mesh.indices32.size_bytes());
+        if (record.lodCount) put(out, base + record.lodsOffset, lodTables[i].data(), lodTables[i].size() * sizeof(TMAPLodV2));
+        for (uint32_t lod = 0; lod < record.lodCount; lod++) {
+            // Levels are written with the mesh's index size, whatever they were built with
+            const MeshLod& meshLod = mesh.lods[lod];
+            uint64_t lodBase = base + lodTables[i][lod].indicesOffset;
+            if (record.indexSize == 2 && !meshLod.indices16.empty()) {
+                put(out, lodBase, meshLod.indices16.data(), meshLod.indices16.size_bytes());
+            } else if (record.indexSize == 2) {
+                std::vector<uint16_t> narrowed(meshLod.indices32.begin(), meshLod.indices32.end());
+                put(out, lodBase, narrowed.data(), narrowed.size() * sizeof(uint16_t));
+            } else if (!meshLod.indices32.empty()) {
+                put(out, lodBase, meshLod.indices32.data(), meshLod.indices32.size_bytes());
+            } else {
+                std::vector<uint32_t> widened(meshLod.indices16.begin(), meshLod.indices16.end());
+                put(out, lodBase, widened.data(), widened.size() * sizeof(uint32_t));
+            }
+        }
+    }
+    
+    std::ofstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        LOG_ERROR(LogCategory::Map, "Failed to open " << filename << " for writing");
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+    if (!file) {
+        LOG_ERROR(LogCategory::Map, "Failed to write " << filename);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,12 @@
+#ifndef TMAP_WRITER_HPP
+#define TMAP_WRITER_HPP
+
+#include <string>
+
+#include "tmap_parser.hpp"
+
+// Write mapData as a TMAP v2 file. Mesh bounds must already be filled in.
+// Unindexed meshes are written as they are, weld them first to get indexed output.
+bool saveTMAP(const std::string& filename, const TMAPData& mapData);
+
+#endif // TMAP_WRITER_HPP
@@ -1,3 +1,4 @@
+import argparse
 import struct
 
 def write_string(f, s):
@@ -26,6 +27,140 @@ def write_mesh(f, name, vertices, normals, uvs, material):
     # Material
     write_string(f, material)
 
+def align16(n):
+    return (n + 15) & ~15
+
+def read_string(f):
+    length = struct.unpack('<H', f.read(2))[0]
+    return f.read(length).decode('utf-8')
+
+def read_tmap_v1(path):
+    """Read a v1 file, returns (meshes, spawn, rotation, offset)"""
+    with open(path, 'rb') as f:
+        if f.read(4) != b'TMAP':
+            raise ValueError(f'{path}: invalid magic bytes')
+        version, mesh_count = struct.unpack('<II', f.read(8))
+        if version != 1:
+            raise ValueError(f'{path}: expected version 1, got {version}')
+        meshes = []
+        for _ in range(mesh_count):
+            name = read_string(f)
+            arrays = []
+            for components in (3, 3, 2):
+                count = struct.unpack('<I', f.read(4))[0]
+                arrays.append([struct.unpack('<' + 'f' * components, f.read(4 * components)) for _ in range(count)])
+            material = read_string(f)
+            meshes.append({'name': name, 'vertices': arrays[0], 'normals': arrays[1], 'uvs': arrays[2], 'material': material})
+        spawn = struct.unpack('<fff', f.read(12))
+        rotation = struct.unpack('<fff', f.read(12))
+        offset = struct.unpack('<fff', f.read(12))
+    return meshes, spawn, rotation, offset
+
+def weld(vertices, normals, uvs):
+    """Merge identical vertices of a triangle soup, returns (vertices, normals, uvs, indices)"""
+    has_normals = len(normals) == len(vertices)
+    has_uvs = len(uvs) == len(vertices)
+    lookup = {}
+    out_vertices, out_normals, out_uvs, indices = [], [], [], []
+    for i in range(len(vertices) - len(vertices) % 3):
+        key = (tuple(vertices[i]), tuple(normals[i]) if has_normals else None, tuple(uvs[i]) if has_uvs else None)
+        if key not in lookup:
+            lookup[key] = len(out_vertices)
+            out_vertices.append(key[0])
+            if has_normals:
+                out_normals.append(key[1])
+            if has_uvs:
+                out_uvs.append(key[2])
+        indices.append(lookup[key])
+    return out_vertices, out_normals, out_uvs, indices
+
+def bounds(vertices):
+    if not vertices:
+        return (0.0, 0.0, 0.0), (0.0, 0.0, 0.0)
+    return tuple(min(v[i] for v in vertices) for i in range(3)), tuple(max(v[i] for v in vertices) for i in range(3))
+
+def write_tmap_v2(path, meshes, spawn, rotation, offset):
+    """Write meshes as an indexed, 16-byte aligned v2 file (layout in tmap_struct.txt)"""
+    records = []
+    for mesh in meshes:
+        vertices, normals, uvs, indices = weld(mesh['vertices'], mesh['normals'], mesh['uvs'])
+        index_size = 2 if len(vertices) <= 65536 else 4
+        name = mesh['name'].encode('utf-8')
+        material = mesh['material'].encode('utf-8')
+        lo, hi = bounds(vertices)
+
+        # Lay out the arrays after the 64 byte record header and the two strings
+        size = 64 + len(name) + len(material)
+        blobs = []
+        def place(data):
+            nonlocal size
+            if not data:
+                return 0
+            size = align16(size)
+            blobs.append((size, data))
+            offset_in_record = size
+            size += len(data)
+            return offset_in_record
+        positions_offset = place(b''.join(struct.pack('<fff', *v) for v in vertices))
+        normals_offset = place(b''.join(struct.pack('<fff', *n) for n in normals))
+        uvs_offset = place(b''.join(struct.pack('<ff', *uv) for uv in uvs))
+        indices_offset = place(struct.pack('<%d%s' % (len(indices), 'H' if index_size == 2 else 'I'), *indices))
+
+        record = bytearray(size)
+        struct.pack_into('<IIHHHH', record, 0, len(vertices), len(indices), index_size if indices else 0,
+                         len(name), len(material), 0)
+        struct.pack_into('<6f', record, 16, *lo, *hi)
+        struct.pack_into('<6I', record, 40, positions_offset, normals_offset, uvs_offset, indices_offset, 0, 0)
+        record[64:64 + len(name)] = name
+        record[64 + len(name):64 + len(name) + len(material)] = material
+        for blob_offset, data in blobs:
+            record[blob_offset:blob_offset + len(data)] = data
+        records.append((record, lo, hi))
+
+    # Header and offset table, then every record on a 16-byte boundary
+    position = align16(80 + 16 * len(records))
+    table = []
+    for record, _, _ in records:
+        table.append((position, len(record)))
+        position = align16(position + len(record))
+
+    map_lo = tuple(min(r[1][i] for r in records) for i in range(3)) if records else (0.0, 0.0, 0.0)
+    map_hi = tuple(max(r[2][i] for r in records) for i in range(3)) if records else (0.0, 0.0, 0.0)
+
+    out = bytearray(position)
+    struct.pack_into('<4sIII', out, 0, b'TMAP', 2, len(records), 0)
+    struct.pack_into('<15fI', out, 16, *spawn, *rotation, *offset, *map_lo, *map_hi, 0)
+    for i, ((record, _, _), (record_offset, record_size)) in enumerate(zip(records, table)):
+        struct.pack_into('<QQ', out, 80 + 16 * i, record_offset, record_size)
+        out[record_offset:record_offset + record_size] = record
+
+    with open(path, 'wb') as f:
+        f.write(out)
+
+def write_tmap_v1(path, meshes, spawn, rotation, offset):
+    with open(path, 'wb') as f:
+        # Magic bytes
+        f.write(b'TMAP')
+        
+        # Version
+        f.write(struct.pack('<I', 1))
+        
+        # Number of meshes
+        f.write(struct.pack('<I', len(meshes)))
+        
+        # Write meshes
+        for mesh in meshes:
+            write_mesh(f, mesh['name'], mesh['vertices'], mesh['normals'], mesh['uvs'], mesh['material'])
+
+        # Spawn position
+        f.write(struct.pack('<fff', *spawn))
+        
+        # Spawn rotation
+        f.write(struct.pack('<fff', *rotation))
+        
+        # Map offset
+        f.write(struct.pack('<fff', *offset))
+
 # Create a proper cube with triangulated faces
 # Each face needs 2 triangles (6 vertices per face, 36 total)
 cube_vertices = [
@@ -129,33 +264,33 @@ spawn = (0.0, 0.0, 5.0)
 rotation = (0.0, 0.0, 0.0)
 offset = (0.0, 0.0, 0.0)
 
-with open('test.tmap', 'wb') as f:
-    # Magic bytes
-    f.write(b'TMAP')
-    
-    # Version
-    f.write(struct.pack('<I', 1))
-    
-    # Number of meshes
-    f.write(struct.pack('<I', len(meshes)))
-    
-    # Write meshes
+def apply_offsets(meshes):
+    """Bake the per-mesh 'offset' of the test meshes into their vertices"""
+    out = []
     for mesh in meshes:
-        # Apply offset to vertices if present
+        mesh = dict(mesh)
         if 'offset' in mesh:
-            offset_vec = mesh['offset']
-            adjusted_vertices = [(v[0] + offset_vec[0], v[1] + offset_vec[1], v[2] + offset_vec[2]) for v in mesh['vertices']]
-        write_mesh(f, mesh['name'], adjusted_vertices if 'offset' in mesh else mesh['vertices'], mesh['normals'], mesh['uvs'], mesh['material'])
+            offset_vec = mesh.pop('offset')
+            mesh['vertices'] = [(v[0] + offset_vec[0], v[1] + offset_vec[1], v[2] + offset_vec[2]) for v in mesh['vertices']]
+        out.append(mesh)
+    return out
 
-    # Spawn position
-    f.write(struct.pack('<fff', *spawn))
-    
-    # Spawn rotation
-    f.write(struct.pack('<fff', *rotation))
-    
-    # Map offset
-    f.write(struct.pack('<fff', *offset))
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description='Generate the test TMAP, or upgrade a v1 TMAP to v2')
+    parser.add_argument('--format', type=int, choices=(1, 2), default=1, help='TMAP version to generate')
+    parser.add_argument('--upgrade', nargs=2, metavar=('INPUT', 'OUTPUT'), help='convert a v1 file to v2')
+    args = parser.parse_args()
+
+    if args.upgrade:
+        in_meshes, in_spawn, in_rotation, in_offset = read_tmap_v1(args.upgrade[0])
+        write_tmap_v2(args.upgrade[1], in_meshes, in_spawn, in_rotation, in_offset)
+        print(f'Upgraded {args.upgrade[0]} to v2 as {args.upgrade[1]}')
+    else:
+        if args.format == 2:
+            write_tmap_v2('test.tmap', apply_offsets(meshes), spawn, rotation, offset)
+        else:
+            write_tmap_v1('test.tmap', apply_offsets(meshes), spawn, rotation, offset)
 
-print('Test TMAP file generated as test.tmap')
-print(f'  - Cube: {len(cube_vertices)} vertices')
-print(f'  - Floor: {len(floor_vertices)} vertices')
\ No newline at end of file
+        print(f'Test TMAP file generated as test.tmap (v{args.format})')
+        print(f'  - Cube: {len(cube_vertices)} vertices')
+        print(f'  - Floor: {len(floor_vertices)} vertices')
@@ -0,0 +1,25 @@
+#ifndef CHECK_HPP
+#define CHECK_HPP
+
+// Shared by the CPU check executables in tools/. Each check prints its failures and
+// main() returns checkResult(), non-zero if any check failed.
+
+#include <cstdio>
+
+inline int g_failures = 0;
+
+#define CHECK(condition)                                                         \
+    do {                                                                         \
+        if (!(condition)) {                                                      \
+            std::printf("  FAILED %s:%d: %s\n", __FILE__, __LINE__, #condition); \
+            g_failures++;                                                        \
+        }                                                                        \
+    } while (0)
+
+// The summary line and exit code for main()
+inline int checkResult(const char* name) {
+    std::printf("%s: %d failed\n", name, g_failures);
+    return g_failures == 0 ? 0 : 1;
+}
+
+#endif // CHECK_HPP
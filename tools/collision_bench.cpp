@@ -0,0 +1,120 @@
+// Compares static collision built one shape per mesh against merged partitions.
+// Drops a grid of spheres onto the map and reports broadphase pairs, contact
+// manifolds and step time for both modes.
+//
+// Usage: collision_bench <map.tmap> [bodies=256] [ticks=600]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "PhysicsManager.hpp"
+#include "logging/Logger.hpp"
+#include "tmap_parser.hpp"
+
+struct BenchResult {
+    double cookMs = 0.0;
+    int staticBodies = 0;
+    double averagePairs = 0.0;
+    double averageManifolds = 0.0;
+    double stepMeanMs = 0.0;
+    double stepP50Ms = 0.0;
+    double stepP99Ms = 0.0;
+};
+
+static BenchResult runMode(const TMAPData& mapData, bool merge, int bodyCount, int ticks) {
+    using clock = std::chrono::steady_clock;
+    BenchResult result;
+    
+    StaticCollisionOptions options;
+    options.merge = merge;
+    auto cookStart = clock::now();
+    CookedStaticCollision cooked = PhysicsManager::cookStaticMeshCollision(mapData, options);
+    result.cookMs = std::chrono::duration<double, std::milli>(clock::now() - cookStart).count();
+    
+    btSphereShape sphere(0.5f);
+    {
+        PhysicsManager physics;
+        physics.addStaticMeshCollision(std::move(cooked));
+        btDiscreteDynamicsWorld* world = physics.getDynamicsWorld();
+        result.staticBodies = world->getNumCollisionObjects();
+        
+        // Same drop positions for both modes, spread over the map above its highest point
+        Vec3 boundsMin = mapData.meshes.empty() ? Vec3{0, 0, 0} : mapData.meshes[0].boundsMin;
+        Vec3 boundsMax = mapData.meshes.empty() ? Vec3{0, 0, 0} : mapData.meshes[0].boundsMax;
+        for (const auto& mesh : mapData.meshes) {
+            boundsMin = {std::min(boundsMin.x, mesh.boundsMin.x), std::min(boundsMin.y, mesh.boundsMin.y), std::min(boundsMin.z, mesh.boundsMin.z)};
+            boundsMax = {std::max(boundsMax.x, mesh.boundsMax.x), std::max(boundsMax.y, mesh.boundsMax.y), std::max(boundsMax.z, mesh.boundsMax.z)};
+        }
+        std::mt19937 random(1234);
+        std::uniform_real_distribution<float> x(boundsMin.x, boundsMax.x);
+        std::uniform_real_distribution<float> y(boundsMax.y + 1.0f, boundsMax.y + 10.0f);
+        std::uniform_real_distribution<float> z(boundsMin.z, boundsMax.z);
+        btVector3 inertia(0, 0, 0);
+        sphere.calculateLocalInertia(1.0f, inertia);
+        for (int i = 0; i < bodyCount; i++) {
+            btTransform transform;
+            transform.setIdentity();
+            transform.setOrigin(btVector3(x(random) + mapData.mapOffset.x, y(random) + mapData.mapOffset.y, z(random) + mapData.mapOffset.z));
+            btRigidBody::btRigidBodyConstructionInfo info(1.0f, new btDefaultMotionState(transform), &sphere, inertia);
+            world->addRigidBody(new btRigidBody(info));
+        }
+        
+        std::vector<double> stepTimes;
+        double pairs = 0.0;
+        double manifolds = 0.0;
+        for (int tick = 0; tick < ticks; tick++) {
+            auto stepStart = clock::now();
+            physics.step(1.0f / 60.0f);
+            stepTimes.push_back(std::chrono::duration<double, std::milli>(clock::now() - stepStart).count());
+            pairs += world->getBroadphase()->getOverlappingPairCache()->getNumOverlappingPairs();
+            manifolds += world->getDispatcher()->getNumManifolds();
+        }
+        
+        if (ticks > 0) {
+            result.averagePairs = pairs / ticks;
+            result.averageManifolds = manifolds / ticks;
+            for (double time : stepTimes) {
+                result.stepMeanMs += time / ticks;
+            }
+            std::sort(stepTimes.begin(), stepTimes.end());
+            result.stepP50Ms = stepTimes[stepTimes.size() / 2];
+            result.stepP99Ms = stepTimes[std::min(stepTimes.size() - 1, stepTimes.size() * 99 / 100)];
+        }
+        // The world deletes the spheres' bodies and motion states, the shape outlives it
+    }
+    return result;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argc > 4) {
+        std::cerr << "Usage: collision_bench <map.tmap> [bodies=256] [ticks=600]" << std::endl;
+        return 1;
+    }
+    int bodyCount = argc > 2 ? std::stoi(argv[2]) : 256;
+    int ticks = argc > 3 ? std::stoi(argv[3]) : 600;
+    
+    TMAPData mapData;
+    if (!loadTMAP(argv[1], mapData)) {
+        std::cerr << "collision_bench: Failed to load " << argv[1] << std::endl;
+        return 1;
+    }
+    
+    BenchResult perMesh = runMode(mapData, false, bodyCount, ticks);
+    BenchResult merged = runMode(mapData, true, bodyCount, ticks);
+    Logger::flush(); // Keep the table below anything loading and cooking logged
+    
+    std::printf("\ncollision_bench: %s, %zu meshes, %d bodies, %d ticks\n", argv[1], mapData.meshes.size(), bodyCount, ticks);
+    std::printf("%-12s %10s %8s %10s %10s %10s %10s %10s\n", "mode", "cook ms", "statics", "pairs", "manifolds", "step ms", "p50 ms", "p99 ms");
+    auto print = [](const char* name, const BenchResult& r) {
+        std::printf("%-12s %10.2f %8d %10.1f %10.1f %10.3f %10.3f %10.3f\n", name, r.cookMs,
+                    r.staticBodies, r.averagePairs, r.averageManifolds, r.stepMeanMs, r.stepP50Ms, r.stepP99Ms);
+    };
+    print("per-mesh", perMesh);
+    print("merged", merged);
+    return 0;
+}
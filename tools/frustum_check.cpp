@@ -0,0 +1,200 @@
+// CPU checks for frustum culling: plane extraction from a known camera, boxes inside,
+// outside and straddling each plane, the box or sphere reach choice, and Frustum::cull
+// against isVisible on a random set. No GL context needed.
+//
+// Usage: frustum_check
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "graphics/Frustum.hpp"
+#include "check.hpp"
+
+static const char* PLANE_NAMES[6] = {"left", "right", "bottom", "top", "near", "far"};
+
+// Camera at EYE looking down +x with y up, so its right is +z. A 90 degree square
+// projection makes every side plane a 45 degree slope: a point is inside when
+// |right| <= depth and |up| <= depth, with depth between 1 and 100.
+static const glm::vec3 EYE(10.0f, 2.0f, -5.0f);
+
+static Frustum cameraFrustum() {
+    glm::mat4 view = glm::lookAt(EYE, EYE + glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 1.0f, 100.0f);
+    return Frustum::fromMatrix(projection * view);
+}
+
+// A volume placed in camera terms, the camera axes line up with the world ones
+static BoundingVolume volumeAt(float right, float up, float depth, glm::vec3 halfSize, float radius) {
+    BoundingVolume volume;
+    volume.center = EYE + glm::vec3(depth, up, right);
+    volume.extents = glm::vec3(halfSize.z, halfSize.y, halfSize.x);
+    volume.radius = radius;
+    return volume;
+}
+
+static BoundingVolume cubeAt(float right, float up, float depth, float halfSize) {
+    return volumeAt(right, up, depth, glm::vec3(halfSize), halfSize * std::sqrt(3.0f));
+}
+
+static FrustumOverlap classifyAgainst(const Frustum& frustum, const BoundingVolume& volume, uint8_t planeMask) {
+    return frustum.classify(volume.center, volume.extents, planeMask);
+}
+
+static void checkBoundingVolume() {
+    std::printf("computeBoundingVolume\n");
+    // Corners of the box from (1, 2, 3) to (3, 6, 11), with a padding float after each
+    const float corners[] = {
+        1, 2, 3, 0, 3, 2, 3, 0, 1, 6, 3, 0, 3, 6, 3, 0,
+        1, 2, 11, 0, 3, 2, 11, 0, 1, 6, 11, 0, 3, 6, 11, 0,
+    };
+    BoundingVolume volume = computeBoundingVolume(corners, 8, 4);
+    CHECK(volume.center == glm::vec3(2.0f, 4.0f, 7.0f));
+    CHECK(volume.extents == glm::vec3(1.0f, 2.0f, 4.0f));
+    CHECK(std::fabs(volume.radius - std::sqrt(21.0f)) < 1e-5f);
+}
+
+static void checkInside(const Frustum& frustum) {
+    std::printf("Boxes fully inside\n");
+    const BoundingVolume inside[] = {
+        cubeAt(0.0f, 0.0f, 50.0f, 1.0f),
+        cubeAt(-40.0f, 40.0f, 60.0f, 5.0f),
+        cubeAt(0.0f, 0.0f, 2.0f, 0.5f),
+        cubeAt(0.0f, 0.0f, 98.0f, 1.0f),
+    };
+    for (const BoundingVolume& volume : inside) {
+        CHECK(frustum.isVisible(volume));
+        uint8_t planeMask = Frustum::ALL_PLANES;
+        CHECK(frustum.classify(volume.center, volume.extents, planeMask) == FrustumOverlap::Inside);
+        CHECK(planeMask == 0);
+    }
+}
+
+static void checkOutsideEachPlane(const Frustum& frustum) {
+    // Each box is outside exactly one plane, in the order Frustum stores them
+    const BoundingVolume outside[6] = {
+        cubeAt(-60.0f, 0.0f, 50.0f, 1.0f),
+        cubeAt(60.0f, 0.0f, 50.0f, 1.0f),
+        cubeAt(0.0f, -60.0f, 50.0f, 1.0f),
+        cubeAt(0.0f, 60.0f, 50.0f, 1.0f),
+        cubeAt(0.0f, 0.0f, 0.5f, 0.2f),
+        cubeAt(0.0f, 0.0f, 150.0f, 1.0f),
+    };
+    for (int p = 0; p < 6; p++) {
+        std::printf("Box outside the %s plane\n", PLANE_NAMES[p]);
+        CHECK(!frustum.isVisible(outside[p]));
+        CHECK(classifyAgainst(frustum, outside[p], Frustum::ALL_PLANES) == FrustumOverlap::Outside);
+        for (int other = 0; other < 6; other++) {
+            FrustumOverlap overlap = classifyAgainst(frustum, outside[p], static_cast<uint8_t>(1 << other));
+            CHECK(other == p ? overlap == FrustumOverlap::Outside : overlap == FrustumOverlap::Inside);
+        }
+    }
+}
+
+static void checkStraddling(const Frustum& frustum) {
+    // Centered on each plane, half the box on either side
+    const BoundingVolume straddling[6] = {
+        cubeAt(-50.0f, 0.0f, 50.0f, 1.0f),
+        cubeAt(50.0f, 0.0f, 50.0f, 1.0f),
+        cubeAt(0.0f, -50.0f, 50.0f, 1.0f),
+        cubeAt(0.0f, 50.0f, 50.0f, 1.0f),
+        cubeAt(0.0f, 0.0f, 1.0f, 0.25f),
+        cubeAt(0.0f, 0.0f, 100.0f, 1.0f),
+    };
+    for (int p = 0; p < 6; p++) {
+        std::printf("Box straddling the %s plane\n", PLANE_NAMES[p]);
+        CHECK(frustum.isVisible(straddling[p]));
+        uint8_t planeMask = Frustum::ALL_PLANES;
+        CHECK(frustum.classify(straddling[p].center, straddling[p].extents, planeMask) == FrustumOverlap::Intersecting);
+        // Only the straddled plane is left for children to test
+        CHECK(planeMask == (1 << p));
+    }
+}
+
+static void checkReach(const Frustum& frustum) {
+    std::printf("Box or sphere, whichever reaches less\n");
+    // A cube with its sphere just inside it: the box reaches 3 * sqrt(2) towards the left
+    // plane, the sphere 3. With the center 3.5 outside, only the sphere culls it.
+    float leftOffset = -3.5f * std::sqrt(2.0f);
+    BoundingVolume round = volumeAt(-50.0f + leftOffset, 0.0f, 50.0f, glm::vec3(3.0f), 3.0f);
+    CHECK(!frustum.isVisible(round));
+    CHECK(classifyAgainst(frustum, round, 1 << 0) == FrustumOverlap::Intersecting);
+    round.radius = 3.0f * std::sqrt(3.0f);
+    CHECK(frustum.isVisible(round));
+
+    // A rod along the camera's right: the sphere reaches 10 towards the top plane, the box
+    // only 0.1 * sqrt(2). With the center 1 outside, only the box culls it.
+    float topOffset = std::sqrt(2.0f);
+    BoundingVolume rod = volumeAt(0.0f, 50.0f + topOffset, 50.0f, glm::vec3(10.0f, 0.1f, 0.1f), 10.0f);
+    CHECK(!frustum.isVisible(rod));
+    rod = volumeAt(0.0f, 50.0f + 0.1f * topOffset, 50.0f, glm::vec3(10.0f, 0.1f, 0.1f), 10.0f);
+    CHECK(frustum.isVisible(rod));
+}
+
+static void checkCullMatchesIsVisible() {
+#ifdef FRUSTUM_NO_SSE
+    std::printf("Scalar Frustum::cull matches isVisible\n");
+#else
+    std::printf("Frustum::cull matches isVisible\n");
+#endif
+    // Not a multiple of 4, so the last group has padding lanes to skip
+    const size_t VOLUME_COUNT = 4099;
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> coordinate(-120.0f, 120.0f);
+    std::uniform_real_distribution<float> halfSize(0.1f, 8.0f);
+    std::uniform_real_distribution<float> direction(-1.0f, 1.0f);
+
+    std::vector<BoundingVolume> volumes(VOLUME_COUNT);
+    CullingSet set;
+    set.reserve(VOLUME_COUNT);
+    for (BoundingVolume& volume : volumes) {
+        volume.center = glm::vec3(coordinate(random), coordinate(random), coordinate(random));
+        volume.extents = glm::vec3(halfSize(random), halfSize(random), halfSize(random));
+        // Anywhere from a sphere inside the box to one around it
+        volume.radius = glm::length(volume.extents) * (0.6f + 0.4f * direction(random));
+        set.add(volume);
+    }
+    CHECK(set.size() == VOLUME_COUNT);
+
+    for (int camera = 0; camera < 16; camera++) {
+        glm::vec3 eye(coordinate(random), coordinate(random), coordinate(random));
+        glm::vec3 front = glm::normalize(glm::vec3(direction(random), direction(random) * 0.5f, direction(random)));
+        glm::mat4 view = glm::lookAt(eye, eye + front, glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::mat4 projection = glm::perspective(glm::radians(70.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+        Frustum frustum = Frustum::fromMatrix(projection * view);
+
+        std::vector<uint32_t> expected;
+        for (uint32_t i = 0; i < VOLUME_COUNT; i++) {
+            if (frustum.isVisible(volumes[i])) {
+                expected.push_back(i);
+            }
+        }
+        std::vector<uint32_t> culled = {0xFFFFFFFFu};
+        size_t added = frustum.cull(set, culled);
+        CHECK(added == culled.size() - 1);
+        CHECK(std::vector<uint32_t>(culled.begin() + 1, culled.end()) == expected);
+        if (camera == 0) {
+            // The set is only a useful comparison if some volumes fall on each side
+            CHECK(!expected.empty() && expected.size() < VOLUME_COUNT);
+        }
+    }
+}
+
+int main() {
+    Frustum frustum = cameraFrustum();
+    checkBoundingVolume();
+    checkInside(frustum);
+    checkOutsideEachPlane(frustum);
+    checkStraddling(frustum);
+    checkReach(frustum);
+    checkCullMatchesIsVisible();
+
+#ifdef FRUSTUM_NO_SSE
+    return checkResult("frustum_check_scalar");
+#else
+    return checkResult("frustum_check");
+#endif
+}
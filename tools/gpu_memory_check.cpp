@@ -0,0 +1,284 @@
+// CPU checks for the renderer's GPU memory bookkeeping. Buffer arenas run on a
+// HostBufferBackend and texture residency is pure bookkeeping, so nothing here needs a
+// GL context.
+//
+// Usage: gpu_memory_check
+
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "graphics/GpuBufferArena.hpp"
+#include "graphics/TextureResidency.hpp"
+#include "check.hpp"
+
+// Host memory that refuses to grow past a limit, like a GL buffer running out of memory
+class LimitedBufferBackend : public HostBufferBackend {
+public:
+    explicit LimitedBufferBackend(size_t limitBytes) : limitBytes(limitBytes) {}
+
+    bool resize(size_t newBytes, size_t keepBytes) override {
+        return newBytes <= limitBytes && HostBufferBackend::resize(newBytes, keepBytes);
+    }
+
+private:
+    size_t limitBytes;
+};
+
+static void checkBestFit() {
+    std::printf("RangeAllocator best fit\n");
+    RangeAllocator allocator(100);
+    size_t a = allocator.allocate(10);
+    size_t b = allocator.allocate(20);
+    size_t c = allocator.allocate(5);
+    size_t d = allocator.allocate(30);
+    size_t e = allocator.allocate(10);
+    CHECK(a == 0 && b == 10 && c == 30 && d == 35 && e == 65);
+    CHECK(allocator.getUsed() == 75);
+
+    // Free blocks of 20 at 10, 30 at 35 and the 25 left at the end
+    allocator.free(b, 20);
+    allocator.free(d, 30);
+    CHECK(allocator.getFreeBlockCount() == 3);
+    CHECK(allocator.getLargestFreeBlock() == 30);
+
+    // Each request goes to the smallest block it fits in, not the first or the biggest
+    CHECK(allocator.allocate(18) == 10);
+    CHECK(allocator.allocate(24) == 75);
+    CHECK(allocator.allocate(30) == 35);
+    CHECK(allocator.allocate(0) == RangeAllocator::INVALID);
+    CHECK(allocator.getUsed() == 75 - 50 + 18 + 24 + 30);
+}
+
+static void checkMerging() {
+    std::printf("RangeAllocator merges freed neighbours\n");
+    RangeAllocator allocator(30);
+    size_t a = allocator.allocate(10);
+    size_t b = allocator.allocate(10);
+    size_t c = allocator.allocate(10);
+    allocator.free(a, 10);
+    allocator.free(c, 10);
+    CHECK(allocator.getFreeBlockCount() == 2);
+    CHECK(allocator.getLargestFreeBlock() == 10);
+
+    // b touches a free block on both sides, all three become one
+    allocator.free(b, 10);
+    CHECK(allocator.getFreeBlockCount() == 1);
+    CHECK(allocator.getLargestFreeBlock() == 30);
+    CHECK(allocator.getUsed() == 0);
+    CHECK(allocator.allocate(30) == 0);
+
+    // Growing merges with free space at the end too
+    RangeAllocator growing(16);
+    size_t first = growing.allocate(8);
+    growing.grow(32);
+    CHECK(growing.getFreeBlockCount() == 1);
+    CHECK(growing.getLargestFreeBlock() == 24);
+    growing.free(first, 8);
+    CHECK(growing.getFreeBlockCount() == 1);
+    CHECK(growing.getLargestFreeBlock() == 32);
+}
+
+static void checkFull() {
+    std::printf("RangeAllocator and GpuBufferArena when full\n");
+    RangeAllocator allocator(16);
+    CHECK(allocator.allocate(16) == 0);
+    CHECK(allocator.allocate(1) == RangeAllocator::INVALID);
+    CHECK(allocator.getUsed() == 16);
+    allocator.grow(32);
+    CHECK(allocator.allocate(16) == 16);
+
+    // The arena can't grow past 64 bytes (16 elements), so it fails without changing anything
+    GpuBufferArena arena(std::make_unique<LimitedBufferBackend>(64), 4, 8);
+    GpuBufferArena::Range range;
+    CHECK(arena.allocate(8, range) && range.first == 0);
+    CHECK(arena.allocate(8, range) && range.first == 8);
+    CHECK(arena.getGeneration() == 1 && arena.getCapacity() == 16);
+    GpuBufferArena::Range failed;
+    CHECK(!arena.allocate(1, failed));
+    CHECK(arena.getGeneration() == 1);
+    CHECK(arena.getCapacity() == 16 && arena.getUsed() == 16);
+    CHECK(!arena.allocate(0, failed));
+
+    // Freeing makes room again without growing
+    arena.free(range);
+    CHECK(arena.allocate(4, range) && range.first == 8);
+    CHECK(arena.getGeneration() == 1);
+}
+
+static void checkGrowth() {
+    std::printf("GpuBufferArena grows by doubling and keeps its contents\n");
+    auto backend = std::make_unique<HostBufferBackend>();
+    const HostBufferBackend* storage = backend.get();
+    GpuBufferArena arena(std::move(backend), sizeof(uint32_t), 8);
+    CHECK(arena.getCapacity() == 8 && arena.getGeneration() == 0);
+    CHECK(storage->getData().size() == 8 * sizeof(uint32_t));
+
+    GpuBufferArena::Range first;
+    CHECK(arena.allocate(8, first));
+    auto* values = static_cast<uint32_t*>(arena.map(first));
+    CHECK(values != nullptr);
+    if (values) {
+        for (uint32_t i = 0; i < 8; i++) {
+            values[i] = 0xC0DE0000u + i;
+        }
+    }
+    arena.unmap();
+    CHECK(arena.getGeneration() == 0);
+
+    // One more element doesn't fit, the arena doubles to 16
+    GpuBufferArena::Range second;
+    CHECK(arena.allocate(1, second) && second.first == 8);
+    CHECK(arena.getCapacity() == 16 && arena.getGeneration() == 1);
+
+    // 20 more needs 16 + 20 elements, doubling twice to 64 in one step
+    GpuBufferArena::Range third;
+    CHECK(arena.allocate(20, third) && third.first == 9);
+    CHECK(arena.getCapacity() == 64 && arena.getGeneration() == 2);
+    CHECK(storage->getData().size() == 64 * sizeof(uint32_t));
+
+    std::vector<uint32_t> kept(8);
+    std::memcpy(kept.data(), storage->getData().data(), kept.size() * sizeof(uint32_t));
+    bool contentsKept = true;
+    for (uint32_t i = 0; i < 8; i++) {
+        contentsKept = contentsKept && kept[i] == 0xC0DE0000u + i;
+    }
+    CHECK(contentsKept);
+}
+
+// Every texture below has levels of 64, 16, 4 and 1 bytes: 85 from level 0, 21 from 1,
+// 5 from 2 and 1 from the 1x1 level
+static const std::vector<size_t> LEVEL_BYTES = {64, 16, 4, 1};
+static const uint32_t LEVEL_COUNT = 4;
+
+// What TextureManager does with the changes once the uploads and drops are done
+static void applyChanges(TextureResidency& residency, const std::vector<TextureResidency::Change>& changes) {
+    for (const TextureResidency::Change& change : changes) {
+        residency.setResidentLevel(change.id, change.targetLevel);
+    }
+}
+
+static size_t sumResident(const TextureResidency& residency, const std::vector<uint32_t>& ids) {
+    size_t total = 0;
+    for (uint32_t id : ids) {
+        total += residency.bytesFrom(id, residency.getResidentLevel(id));
+    }
+    return total;
+}
+
+static void checkResidencyTrimsDetailFirst() {
+    std::printf("TextureResidency drops finer-than-needed levels first\n");
+    TextureResidency residency;
+    uint32_t a = residency.addTexture(LEVEL_BYTES);
+    uint32_t b = residency.addTexture(LEVEL_BYTES);
+    CHECK(residency.getResidentLevel(a) == LEVEL_COUNT && residency.getResidentBytes() == 0);
+
+    residency.requestLevel(a, 0);
+    residency.requestLevel(b, 0);
+    std::vector<TextureResidency::Change> changes = residency.update();
+    CHECK(changes.size() == 2);
+    applyChanges(residency, changes);
+    CHECK(residency.getResidentBytes() == 170);
+    CHECK(residency.getResidentBytes() == sumResident(residency, {a, b}));
+
+    // a only needs level 2 now, but keeps level 0 while there's room
+    residency.requestLevel(a, 2);
+    residency.requestLevel(b, 0);
+    CHECK(residency.update().empty());
+    CHECK(residency.getTargetLevel(a) == 0);
+
+    // Over budget, a's unneeded detail goes and nothing else: 5 + 85 = 90
+    residency.setBudget(100);
+    residency.requestLevel(a, 2);
+    residency.requestLevel(b, 0);
+    changes = residency.update();
+    CHECK(changes.size() == 1);
+    CHECK(!changes.empty() && changes[0].id == a && changes[0].residentLevel == 0 && changes[0].targetLevel == 2);
+    CHECK(residency.getTargetLevel(b) == 0);
+    applyChanges(residency, changes);
+    CHECK(residency.getResidentBytes() == 90);
+    CHECK(residency.getResidentBytes() == sumResident(residency, {a, b}));
+}
+
+static void checkResidencyEvictionOrder() {
+    std::printf("TextureResidency evicts unused textures least recently used first, then coarsens visible ones\n");
+    TextureResidency residency;
+    std::vector<uint32_t> ids;
+    for (int i = 0; i < 4; i++) {
+        ids.push_back(residency.addTexture(LEVEL_BYTES));
+    }
+    uint32_t a = ids[0], b = ids[1], c = ids[2], d = ids[3];
+
+    // a was last drawn a frame before b, c and d are still on screen
+    for (uint32_t id : ids) {
+        residency.requestLevel(id, 0);
+    }
+    applyChanges(residency, residency.update());
+    CHECK(residency.getResidentBytes() == 340);
+    for (uint32_t id : {b, c, d}) {
+        residency.requestLevel(id, 0);
+    }
+    CHECK(residency.update().empty());
+    residency.requestLevel(c, 0);
+    residency.requestLevel(d, 0);
+    CHECK(residency.update().empty());
+
+    // 255 bytes fit once a, the least recently used, is gone
+    residency.setBudget(255);
+    residency.requestLevel(c, 0);
+    residency.requestLevel(d, 0);
+    std::vector<TextureResidency::Change> changes = residency.update();
+    CHECK(changes.size() == 1);
+    CHECK(!changes.empty() && changes[0].id == a && changes[0].targetLevel == LEVEL_COUNT);
+    CHECK(residency.getTargetLevel(b) == 0);
+    applyChanges(residency, changes);
+    CHECK(residency.getResidentBytes() == 255);
+    CHECK(residency.getResidentBytes() == sumResident(residency, ids));
+
+    // b goes next, the visible textures keep every level
+    residency.setBudget(170);
+    residency.requestLevel(c, 0);
+    residency.requestLevel(d, 0);
+    changes = residency.update();
+    CHECK(changes.size() == 1);
+    CHECK(!changes.empty() && changes[0].id == b && changes[0].targetLevel == LEVEL_COUNT);
+    CHECK(residency.getTargetLevel(c) == 0 && residency.getTargetLevel(d) == 0);
+    applyChanges(residency, changes);
+    CHECK(residency.getResidentBytes() == 170);
+    CHECK(residency.getResidentBytes() == sumResident(residency, ids));
+
+    // With nothing unused left, c and d give up their 64 byte levels: 21 + 21 = 42
+    residency.setBudget(100);
+    residency.requestLevel(c, 0);
+    residency.requestLevel(d, 0);
+    changes = residency.update();
+    CHECK(changes.size() == 2);
+    CHECK(residency.getTargetLevel(c) == 1 && residency.getTargetLevel(d) == 1);
+    applyChanges(residency, changes);
+    CHECK(residency.getResidentBytes() == 42);
+    CHECK(residency.getResidentBytes() == sumResident(residency, ids));
+
+    // Even with no budget at all visible textures keep their 1x1 level
+    residency.setBudget(0);
+    residency.requestLevel(c, 0);
+    residency.requestLevel(d, 0);
+    applyChanges(residency, residency.update());
+    CHECK(residency.getResidentLevel(c) == LEVEL_COUNT - 1 && residency.getResidentLevel(d) == LEVEL_COUNT - 1);
+    CHECK(residency.getResidentBytes() == 2);
+    CHECK(residency.getResidentBytes() == sumResident(residency, ids));
+
+    residency.removeTexture(d);
+    CHECK(residency.getResidentBytes() == 1);
+}
+
+int main() {
+    checkBestFit();
+    checkMerging();
+    checkFull();
+    checkGrowth();
+    checkResidencyTrimsDetailFirst();
+    checkResidencyEvictionOrder();
+
+    return checkResult("gpu_memory_check");
+}
@@ -0,0 +1,249 @@
+// Runs the game simulation without a window, GPU or input devices.
+// Loads a TMAP, feeds a scripted ControllerState stream through runGameProcess and
+// reports tick throughput, per-tick latency percentiles and where the player ended up,
+// so gameplay changes can be profiled and regression-tested on CI machines.
+//
+// Usage: ManaStormHeadless <map.tmap> [--script <file> | --replay <file>] [--ticks <n>]
+//                          [--tick-rate <hz>] [--tick-log <file>] [--trace <file>]
+//
+// --replay plays an input recording made with the game's --record option.
+// --tick-log writes a CSV with every tick's time and player position, for diffing runs.
+// --trace writes a Chrome trace of the profiled zones (the newest ticks, up to the ring size).
+//
+// Script lines are "<ticks> [input...]", holding that input for that many ticks.
+// Inputs are button names (forward, backward, left, right, jump, use, slide, grapple)
+// or analog values as name=value (left_x, left_y, right_x, right_y, left_trigger,
+// right_trigger, mouse_x, mouse_y). '#' starts a comment.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "game_process.hpp"
+#include "input/input_manager.hpp"
+#include "input/input_recording.hpp"
+#include "logging/Logger.hpp"
+#include "profiling/Profiler.hpp"
+
+// Used when no script is given: walk a square, jumping along the way, while looking around
+const char* DEFAULT_SCRIPT =
+    "60\n"
+    "120 forward\n"
+    "30 forward jump\n"
+    "90 right mouse_x=4\n"
+    "120 backward left_x=0.5\n"
+    "30 left jump\n"
+    "90 left right_x=0.4\n"
+    "60 forward right_y=-0.3\n";
+
+struct ScriptStep {
+    int ticks = 0;
+    ControllerState state;
+};
+
+static bool parseScript(std::istream& in, std::vector<ScriptStep>& steps) {
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+        std::istringstream tokens(line);
+        ScriptStep step;
+        if (!(tokens >> step.ticks)) {
+            continue; // Blank or comment
+        }
+        
+        std::string token;
+        while (tokens >> token) {
+            ControllerButtonsState& b = step.state.buttons;
+            ControllerAnalogState& a = step.state.analog;
+            size_t equals = token.find('=');
+            if (equals == std::string::npos) {
+                if (token == "forward") b.move_forward = true;
+                else if (token == "backward") b.move_backward = true;
+                else if (token == "left") b.move_left = true;
+                else if (token == "right") b.move_right = true;
+                else if (token == "jump") b.jump = true;
+                else if (token == "use") b.use = true;
+                else if (token == "slide") b.slide = true;
+                else if (token == "grapple") b.grapple = true;
+                else {
+                    std::cerr << "Headless: Unknown input '" << token << "' on script line " << lineNumber << std::endl;
+                    return false;
+                }
+                continue;
+            }
+            
+            std::string name = token.substr(0, equals);
+            float value = std::strtof(token.c_str() + equals + 1, nullptr);
+            if (name == "left_x") a.left_x = value;
+            else if (name == "left_y") a.left_y = value;
+            else if (name == "right_x") a.right_x = value;
+            else if (name == "right_y") a.right_y = value;
+            else if (name == "left_trigger") a.left_trigger = value;
+            else if (name == "right_trigger") a.right_trigger = value;
+            else if (name == "mouse_x") step.state.mouse.delta_x = value;
+            else if (name == "mouse_y") step.state.mouse.delta_y = value;
+            else {
+                std::cerr << "Headless: Unknown input '" << name << "' on script line " << lineNumber << std::endl;
+                return false;
+            }
+        }
+        if (step.ticks > 0) {
+            steps.push_back(step);
+        }
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    Profiler::setThreadName("Main");
+    std::string mapPath;
+    std::string scriptPath;
+    std::string replayPath;
+    std::string tickLogPath;
+    std::string tracePath;
+    long long tickLimit = -1;
+    double tickRate = 0.0;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--script" && i + 1 < argc) {
+            scriptPath = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (arg == "--tick-log" && i + 1 < argc) {
+            tickLogPath = argv[++i];
+        } else if (arg == "--trace" && i + 1 < argc) {
+            tracePath = argv[++i];
+        } else if (arg == "--ticks" && i + 1 < argc) {
+            tickLimit = std::stoll(argv[++i]);
+        } else if (arg == "--tick-rate" && i + 1 < argc) {
+            tickRate = std::max(std::stod(argv[++i]), 1.0);
+        } else if (mapPath.empty() && arg[0] != '-') {
+            mapPath = arg;
+        } else {
+            mapPath.clear();
+            break;
+        }
+    }
+    if (mapPath.empty() || (!scriptPath.empty() && !replayPath.empty())) {
+        std::cerr << "Usage: ManaStormHeadless <map.tmap> [--script <file> | --replay <file>] [--ticks <n>]\n"
+                  << "                         [--tick-rate <hz>] [--tick-log <file>] [--trace <file>]" << std::endl;
+        return 1;
+    }
+    
+    // A recording is just a script with one step per run of identical ticks
+    std::vector<ScriptStep> script;
+    bool parsed = true;
+    if (!replayPath.empty()) {
+        InputReplay replay;
+        if (!replay.open(replayPath)) {
+            return 1;
+        }
+        if (tickRate == 0.0) {
+            tickRate = replay.getTickRate();
+        }
+        ControllerState state;
+        while (replay.next(state)) {
+            script.push_back({1, state});
+        }
+    } else if (scriptPath.empty()) {
+        std::istringstream in(DEFAULT_SCRIPT);
+        parsed = parseScript(in, script);
+    } else {
+        std::ifstream in(scriptPath);
+        if (!in) {
+            std::cerr << "Headless: Unable to open script " << scriptPath << std::endl;
+            return 1;
+        }
+        parsed = parseScript(in, script);
+    }
+    if (tickRate == 0.0) {
+        tickRate = 60.0;
+    }
+    if (!parsed || script.empty()) {
+        std::cerr << "Headless: Script has no input to play" << std::endl;
+        return 1;
+    }
+    
+    // Expand the script to one state per tick, looping it if --ticks asks for more
+    std::vector<const ControllerState*> inputs;
+    long long scriptTicks = 0;
+    for (const auto& step : script) {
+        scriptTicks += step.ticks;
+    }
+    long long totalTicks = tickLimit >= 0 ? tickLimit : scriptTicks;
+    inputs.reserve(static_cast<size_t>(totalTicks));
+    while (static_cast<long long>(inputs.size()) < totalTicks) {
+        for (const auto& step : script) {
+            for (int i = 0; i < step.ticks && static_cast<long long>(inputs.size()) < totalTicks; i++) {
+                inputs.push_back(&step.state);
+            }
+        }
+    }
+    
+    if (!setTmap(mapPath)) {
+        std::cerr << "Headless: Failed to load " << mapPath << std::endl;
+        return 1;
+    }
+    
+    using clock = std::chrono::steady_clock;
+    const float tickSeconds = static_cast<float>(1.0 / tickRate);
+    std::vector<double> tickTimes;
+    std::vector<glm::vec3> positions; // Kept in memory, writing the log mid-run would skew the timings
+    tickTimes.reserve(inputs.size());
+    positions.reserve(tickLogPath.empty() ? 0 : inputs.size());
+    auto runStart = clock::now();
+    for (const ControllerState* input : inputs) {
+        auto tickStart = clock::now();
+        runGameProcess(tickSeconds, *input);
+        tickTimes.push_back(std::chrono::duration<double, std::micro>(clock::now() - tickStart).count());
+        if (!tickLogPath.empty()) {
+            positions.push_back(g_player.position);
+        }
+    }
+    double runSeconds = std::chrono::duration<double>(clock::now() - runStart).count();
+    Logger::flush();
+    
+    if (!tickLogPath.empty()) {
+        std::FILE* log = std::fopen(tickLogPath.c_str(), "w");
+        if (!log) {
+            std::cerr << "Headless: Unable to write " << tickLogPath << std::endl;
+            return 1;
+        }
+        std::fprintf(log, "tick,tick_us,x,y,z\n");
+        for (size_t i = 0; i < tickTimes.size(); i++) {
+            std::fprintf(log, "%zu,%.2f,%.9g,%.9g,%.9g\n", i, tickTimes[i], positions[i].x, positions[i].y, positions[i].z);
+        }
+        std::fclose(log);
+    }
+    
+    std::printf("\nHeadless: %s, %zu ticks at %.0f Hz\n", mapPath.c_str(), tickTimes.size(), tickRate);
+    if (!tickTimes.empty()) {
+        std::vector<double> sorted = tickTimes;
+        std::sort(sorted.begin(), sorted.end());
+        auto percentile = [&](double p) {
+            return sorted[std::min(sorted.size() - 1, static_cast<size_t>(p * sorted.size()))];
+        };
+        std::printf("Headless: %.0f ticks/s (%.1fx real time)\n", tickTimes.size() / runSeconds,
+                    tickTimes.size() / tickRate / runSeconds);
+        std::printf("Headless: tick us  p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n",
+                    percentile(0.50), percentile(0.90), percentile(0.99), sorted.back());
+    }
+    // Same build, map and script should always end in exactly the same place
+    std::printf("Headless: final position %.9g %.9g %.9g, rotation %.9g %.9g\n",
+                g_player.position.x, g_player.position.y, g_player.position.z,
+                g_player.rotation.x, g_player.rotation.y);
+    
+    Profiler::printZoneStats();
+    if (!tracePath.empty() && !Profiler::writeChromeTrace(tracePath)) {
+        return 1;
+    }
+    return 0;
+}
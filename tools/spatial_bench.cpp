@@ -0,0 +1,192 @@
+// Compares SpatialIndex traversal against a linear scan as the mesh count grows.
+// Scatters random boxes at a constant density, then times frustum culling (the
+// renderer's SSE linear scan vs the BVH) and ray queries (brute force vs the BVH)
+// from random cameras. Every frustum, sphere and ray query is also checked against
+// brute force, and the exit code is non-zero if any disagree.
+//
+// Usage: spatial_bench [max meshes=262144] [queries=200]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "SpatialIndex.hpp"
+#include "graphics/Frustum.hpp"
+
+struct Camera {
+    glm::vec3 position;
+    glm::vec3 front;
+};
+
+// Same projection as RenderFrame
+static Frustum cameraFrustum(const Camera& camera) {
+    glm::mat4 view = glm::lookAt(camera.position, camera.position + camera.front, glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 projection = glm::perspective(glm::radians(90.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    return Frustum::fromMatrix(projection * view);
+}
+
+// Brute force for queryRay, rays as long as the far plane
+static void scanRay(const std::vector<BoundingVolume>& volumes, const Camera& camera, std::vector<SpatialRayHit>& hits) {
+    glm::vec3 inverse = glm::vec3(1.0f) / camera.front;
+    for (uint32_t m = 0; m < volumes.size(); m++) {
+        glm::vec3 t0 = (volumes[m].center - volumes[m].extents - camera.position) * inverse;
+        glm::vec3 t1 = (volumes[m].center + volumes[m].extents - camera.position) * inverse;
+        glm::vec3 tNear = glm::min(t0, t1);
+        glm::vec3 tFar = glm::max(t0, t1);
+        float entry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+        float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, 100.0f));
+        if (entry <= exit) {
+            hits.push_back({m, entry});
+        }
+    }
+    std::sort(hits.begin(), hits.end(), [](const SpatialRayHit& a, const SpatialRayHit& b) {
+        return a.distance < b.distance;
+    });
+}
+
+// Brute force for querySphere, boxes within radius of center
+static void scanSphere(const std::vector<BoundingVolume>& volumes, const glm::vec3& center, float radius,
+                       std::vector<uint32_t>& ids) {
+    for (uint32_t m = 0; m < volumes.size(); m++) {
+        glm::vec3 boundsMin = volumes[m].center - volumes[m].extents;
+        glm::vec3 boundsMax = volumes[m].center + volumes[m].extents;
+        glm::vec3 offset = center - glm::clamp(center, boundsMin, boundsMax);
+        if (glm::dot(offset, offset) <= radius * radius) {
+            ids.push_back(m);
+        }
+    }
+}
+
+// Hits sorted by distance can tie, compare them by id
+static std::vector<uint32_t> hitIds(const std::vector<SpatialRayHit>& hits) {
+    std::vector<uint32_t> ids;
+    for (const SpatialRayHit& hit : hits) {
+        ids.push_back(hit.id);
+    }
+    std::sort(ids.begin(), ids.end());
+    return ids;
+}
+
+template <typename F>
+static double microsecondsPerCall(int calls, F&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < calls; i++) {
+        fn(i);
+    }
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / calls;
+}
+
+int main(int argc, char* argv[]) {
+    size_t maxMeshes = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 262144;
+    int queries = argc > 2 ? std::max(std::atoi(argv[2]), 1) : 200;
+
+    std::printf("\nspatial_bench: %d queries per size\n", queries);
+    std::printf("%10s %9s %8s %10s %10s %8s %10s %10s %8s\n", "meshes", "build ms", "visible",
+                "scan us", "bvh us", "speedup", "ray scan", "ray bvh", "speedup");
+
+    bool mismatch = false;
+    for (size_t meshCount = 256; meshCount <= maxMeshes; meshCount *= 4) {
+        // About one mesh per 8x8x8 cell, so the far plane sees a similar number at every size
+        float worldSize = 8.0f * std::cbrt(static_cast<float>(meshCount));
+        std::mt19937 random(static_cast<unsigned>(meshCount));
+        std::uniform_real_distribution<float> coordinate(0.0f, worldSize);
+        std::uniform_real_distribution<float> halfSize(0.25f, 4.0f);
+        std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+
+        std::vector<BoundingVolume> volumes(meshCount);
+        CullingSet cullingSet;
+        cullingSet.reserve(meshCount);
+        for (auto& volume : volumes) {
+            volume.center = glm::vec3(coordinate(random), coordinate(random), coordinate(random));
+            volume.extents = glm::vec3(halfSize(random), halfSize(random), halfSize(random));
+            volume.radius = glm::length(volume.extents);
+            cullingSet.add(volume);
+        }
+
+        SpatialIndex index;
+        auto buildStart = std::chrono::steady_clock::now();
+        index.build(volumes);
+        double buildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - buildStart).count();
+
+        std::vector<Camera> cameras(queries);
+        for (auto& camera : cameras) {
+            float yaw = angle(random);
+            float pitch = (angle(random) - 3.1415926f) * 0.25f;
+            camera.position = glm::vec3(coordinate(random), coordinate(random), coordinate(random));
+            camera.front = glm::vec3(std::cos(yaw) * std::cos(pitch), std::sin(pitch), std::sin(yaw) * std::cos(pitch));
+        }
+        std::vector<Frustum> frustums;
+        for (const auto& camera : cameras) {
+            frustums.push_back(cameraFrustum(camera));
+        }
+
+        std::vector<uint32_t> visible;
+        size_t visibleTotal = 0;
+        double scanUs = microsecondsPerCall(queries, [&](int i) {
+            visible.clear();
+            visibleTotal += frustums[i].cull(cullingSet, visible);
+        });
+        double bvhUs = microsecondsPerCall(queries, [&](int i) {
+            visible.clear();
+            index.queryFrustum(frustums[i], visible);
+        });
+
+        // Brute force is one slab test per mesh
+        std::vector<SpatialRayHit> hits;
+        double rayScanUs = microsecondsPerCall(queries, [&](int i) {
+            hits.clear();
+            scanRay(volumes, cameras[i], hits);
+        });
+        double rayBvhUs = microsecondsPerCall(queries, [&](int i) {
+            hits.clear();
+            index.queryRay(cameras[i].position, cameras[i].front, 100.0f, hits);
+        });
+
+        // The BVH must give exactly the brute force answer for every query kind
+        auto disagree = [&](const char* query, int i, size_t traversed, size_t scanned) {
+            std::printf("spatial_bench: BVH and scan %s queries disagree at %zu meshes, query %d (%zu vs %zu)\n",
+                        query, meshCount, i, traversed, scanned);
+            mismatch = true;
+        };
+        for (int i = 0; i < queries; i++) {
+            std::vector<uint32_t> scanned, traversed;
+            frustums[i].cull(cullingSet, scanned);
+            index.queryFrustum(frustums[i], traversed);
+            std::sort(traversed.begin(), traversed.end());
+            if (scanned != traversed) {
+                disagree("frustum", i, traversed.size(), scanned.size());
+            }
+
+            // A findMeshesNear style lookup around the camera, a couple of cells wide
+            scanned.clear();
+            traversed.clear();
+            scanSphere(volumes, cameras[i].position, 16.0f, scanned);
+            index.querySphere(cameras[i].position, 16.0f, traversed);
+            std::sort(traversed.begin(), traversed.end());
+            if (scanned != traversed) {
+                disagree("sphere", i, traversed.size(), scanned.size());
+            }
+
+            std::vector<SpatialRayHit> scannedHits, traversedHits;
+            scanRay(volumes, cameras[i], scannedHits);
+            index.queryRay(cameras[i].position, cameras[i].front, 100.0f, traversedHits);
+            bool nearestFirst = std::is_sorted(traversedHits.begin(), traversedHits.end(),
+                                               [](const SpatialRayHit& a, const SpatialRayHit& b) {
+                                                   return a.distance < b.distance;
+                                               });
+            if (!nearestFirst || hitIds(scannedHits) != hitIds(traversedHits)) {
+                disagree("ray", i, traversedHits.size(), scannedHits.size());
+            }
+        }
+
+        std::printf("%10zu %9.2f %8zu %10.1f %10.1f %7.1fx %10.1f %10.1f %7.1fx\n", meshCount, buildMs,
+                    visibleTotal / queries, scanUs, bvhUs, scanUs / bvhUs, rayScanUs, rayBvhUs, rayScanUs / rayBvhUs);
+    }
+    return mismatch ? 1 : 0;
+}
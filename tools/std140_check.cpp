@@ -0,0 +1,97 @@
+// CPU checks for Std140Writer: writes blocks member by member and compares the bytes
+// at the offsets GLSL std140 gives them. Std140.hpp's static_asserts cover the layout
+// arithmetic, this covers the bytes the writer actually places.
+//
+// Usage: std140_check
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "graphics/Std140.hpp"
+#include "check.hpp"
+
+// Bytes the writer doesn't write keep this, so padding shows up untouched
+static const std::byte FILL{0xAB};
+
+template <typename T>
+static bool bytesAt(const std::vector<std::byte>& block, size_t offset, const T& expected) {
+    return offset + sizeof(T) <= block.size() && std::memcmp(block.data() + offset, &expected, sizeof(T)) == 0;
+}
+
+static bool untouched(const std::vector<std::byte>& block, size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+        if (block[i] != FILL) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void checkMat3Block() {
+    std::printf("float, vec3, float, mat3, vec2\n");
+    // layout(std140) uniform Block { float a; vec3 b; float c; mat3 d; vec2 e; };
+    // a at 0, b at 16, c packs into b's last 4 bytes at 28, d's columns at 32, 48 and 64,
+    // e at 80, 96 bytes in all
+    glm::mat3 d;
+    for (int column = 0; column < 3; column++) {
+        for (int row = 0; row < 3; row++) {
+            d[column][row] = static_cast<float>(10 * (column + 1) + row);
+        }
+    }
+    std::vector<std::byte> block(128, FILL);
+    Std140Writer writer(block.data());
+    writer.write(1.5f);
+    writer.write(glm::vec3(2.0f, 3.0f, 4.0f));
+    writer.write(5.0f);
+    writer.write(d);
+    writer.write(glm::vec2(6.0f, 7.0f));
+
+    CHECK(writer.size() == 96);
+    CHECK(bytesAt(block, 0, 1.5f));
+    CHECK(untouched(block, 4, 16));
+    CHECK(bytesAt(block, 16, glm::vec3(2.0f, 3.0f, 4.0f)));
+    CHECK(bytesAt(block, 28, 5.0f));
+    for (int column = 0; column < 3; column++) {
+        // Each column is a vec3 padded out to 16, the padding stays as it was
+        size_t offset = 32 + column * 16;
+        CHECK(bytesAt(block, offset, d[column]));
+        CHECK(untouched(block, offset + 12, offset + 16));
+    }
+    CHECK(bytesAt(block, 80, glm::vec2(6.0f, 7.0f)));
+    CHECK(untouched(block, 88, block.size()));
+}
+
+static void checkMat4Block() {
+    std::printf("int, vec4, mat4, float\n");
+    // int at 0, vec4 at 16, mat4 at 32 with its columns packed, float at 96, 112 bytes in all
+    glm::mat4 m;
+    for (int column = 0; column < 4; column++) {
+        for (int row = 0; row < 4; row++) {
+            m[column][row] = static_cast<float>(10 * (column + 1) + row);
+        }
+    }
+    std::vector<std::byte> block(128, FILL);
+    Std140Writer writer(block.data());
+    writer.write(int32_t(-7));
+    writer.write(glm::vec4(1.0f, 2.0f, 3.0f, 4.0f));
+    writer.write(m);
+    writer.write(8.0f);
+
+    CHECK(writer.size() == 112);
+    CHECK(bytesAt(block, 0, int32_t(-7)));
+    CHECK(untouched(block, 4, 16));
+    CHECK(bytesAt(block, 16, glm::vec4(1.0f, 2.0f, 3.0f, 4.0f)));
+    for (int column = 0; column < 4; column++) {
+        CHECK(bytesAt(block, 32 + column * 16, m[column]));
+    }
+    CHECK(bytesAt(block, 96, 8.0f));
+    CHECK(untouched(block, 100, block.size()));
+}
+
+int main() {
+    checkMat3Block();
+    checkMat4Block();
+
+    return checkResult("std140_check");
+}
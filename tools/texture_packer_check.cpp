@@ -0,0 +1,78 @@
+// CPU checks for TexturePacker: which textures share array pages, how pages grow, and
+// the numbers in its report. No GL context needed.
+//
+// Usage: texture_packer_check
+
+#include <cmath>
+#include <cstdio>
+
+#include "graphics/TexturePacker.hpp"
+#include "check.hpp"
+
+// All mip levels of one layer, as TextureManager passes them in
+static const size_t RGBA8_64_BYTES = 4 * (64 * 64 + 32 * 32 + 16 * 16 + 8 * 8 + 4 * 4 + 2 * 2 + 1);  // 21844
+static const size_t RGBA8_128_BYTES = 4 * 128 * 128 + RGBA8_64_BYTES;                                // 87380
+static const size_t BC1_64_BYTES = 8 * (16 * 16 + 8 * 8 + 4 * 4 + 2 * 2 + 1 + 1 + 1);                // 2744
+
+int main() {
+    TexturePacker packer; // Up to 256x256, 16 layers a page
+
+    std::printf("Same size and format share a page\n");
+    for (uint32_t i = 0; i < 4; i++) {
+        TexturePacker::Placement placement = packer.add(64, 64, TextureFormat::RGBA8, RGBA8_64_BYTES);
+        CHECK(placement.page == 0 && placement.layer == i);
+    }
+    CHECK(packer.getPages().size() == 1);
+
+    std::printf("Pages of a kind grow 4, 8, 16 layers, then stay at 16\n");
+    // 4 are in page 0 already, 8 more fill page 1, 16 more page 2, the last starts page 3
+    const uint32_t expectedPage[] = {1, 2, 3};
+    const uint32_t expectedCapacity[] = {8, 16, 16};
+    const uint32_t fill[] = {8, 16, 1};
+    for (int step = 0; step < 3; step++) {
+        for (uint32_t i = 0; i < fill[step]; i++) {
+            TexturePacker::Placement placement = packer.add(64, 64, TextureFormat::RGBA8, RGBA8_64_BYTES);
+            CHECK(placement.page == expectedPage[step] && placement.layer == i);
+        }
+        CHECK(packer.getPages().size() > expectedPage[step] &&
+              packer.getPages()[expectedPage[step]].capacity == expectedCapacity[step]);
+    }
+    CHECK(packer.getPages()[0].capacity == 4 && packer.getPages()[0].used == 4);
+    CHECK(packer.getPages()[3].used == 1);
+
+    std::printf("Big textures and other formats or sizes stay out\n");
+    CHECK(packer.canPack(256, 256));
+    CHECK(!packer.canPack(512, 512) && !packer.canPack(257, 16));
+    CHECK(packer.add(512, 512, TextureFormat::RGBA8, 4 * 512 * 512).page == TexturePacker::INVALID);
+    CHECK(packer.add(16, 257, TextureFormat::RGBA8, 4 * 16 * 257).page == TexturePacker::INVALID);
+    TexturePacker::Placement compressed = packer.add(64, 64, TextureFormat::BC1, BC1_64_BYTES);
+    CHECK(compressed.page == 4 && compressed.layer == 0);
+    CHECK(packer.getPages().size() > 4 && packer.getPages()[4].capacity == 4);
+    TexturePacker::Placement larger = packer.add(128, 128, TextureFormat::RGBA8, RGBA8_128_BYTES);
+    CHECK(larger.page == 5 && larger.layer == 0);
+    // New 64x64 RGBA8 textures still go to the page with room, not the others
+    TexturePacker::Placement next = packer.add(64, 64, TextureFormat::RGBA8, RGBA8_64_BYTES);
+    CHECK(next.page == 3 && next.layer == 1);
+
+    std::printf("Report figures\n");
+    // Pages: 64x64 RGBA8 with 4/4, 8/8, 16/16 and 2/16 layers used, 64x64 BC1 1/4, 128x128 RGBA8 1/4
+    TexturePacker::Report report = packer.getReport();
+    CHECK(report.texturesPacked == 32);
+    CHECK(report.texturesSkipped == 2);
+    CHECK(report.pages == 6);
+    CHECK(report.layersAllocated == 52);
+    CHECK(report.bytesAllocated == 44 * RGBA8_64_BYTES + 4 * BC1_64_BYTES + 4 * RGBA8_128_BYTES);
+    CHECK(report.bytesAllocated == 1321632);
+    CHECK(report.bytesUsed == 30 * RGBA8_64_BYTES + BC1_64_BYTES + RGBA8_128_BYTES);
+    CHECK(report.bytesUsed == 745444);
+    CHECK(std::fabs(report.efficiency() - 745444.0f / 1321632.0f) < 1e-6f);
+    CHECK(report.bindsSaved() == 26);
+    std::printf("  %s\n", report.toString().c_str());
+
+    std::printf("An empty packer reports nothing\n");
+    TexturePacker::Report empty = TexturePacker().getReport();
+    CHECK(empty.texturesPacked == 0 && empty.pages == 0 && empty.bytesAllocated == 0);
+    CHECK(empty.efficiency() == 1.0f && empty.bindsSaved() == 0);
+
+    return checkResult("texture_packer_check");
+}
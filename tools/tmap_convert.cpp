@@ -0,0 +1,94 @@
+// Upgrades TMAP files to the v2 format.
+// Unindexed meshes are welded into shared vertices plus an index buffer on the way.
+// --optimize also reorders every mesh for the vertex cache, overdraw and vertex fetch
+// (see MeshOptimizer) and flags the file so the engine doesn't do it again on load.
+// --lods adds simplified levels of detail to every indexed mesh (see MeshSimplifier).
+//
+// Usage: tmap_convert [--optimize] [--lods] <input.tmap> <output.tmap>
+
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "MeshOptimizer.hpp"
+#include "MeshSimplifier.hpp"
+#include "logging/Logger.hpp"
+#include "tmap_parser.hpp"
+#include "tmap_writer.hpp"
+
+int main(int argc, char* argv[]) {
+    bool optimize = false;
+    bool lods = false;
+    bool usageError = argc < 3;
+    for (int i = 1; i < argc - 2; i++) {
+        if (std::strcmp(argv[i], "--optimize") == 0) {
+            optimize = true;
+        } else if (std::strcmp(argv[i], "--lods") == 0) {
+            lods = true;
+        } else {
+            usageError = true;
+        }
+    }
+    if (usageError) {
+        std::cerr << "Usage: tmap_convert [--optimize] [--lods] <input.tmap> <output.tmap>" << std::endl;
+        return 1;
+    }
+    const char* inputPath = argv[argc - 2];
+    const char* outputPath = argv[argc - 1];
+    
+    TMAPData mapData;
+    if (!loadTMAP(inputPath, mapData)) {
+        std::cerr << "tmap_convert: Failed to load " << inputPath << std::endl;
+        return 1;
+    }
+    
+    // Welded arrays are stored here, unchanged meshes keep viewing the source mapping
+    auto storage = std::make_shared<TMAPStorage>();
+    size_t verticesBefore = 0;
+    size_t verticesAfter = 0;
+    MeshOptimizeStats optimizeStats;
+    size_t meshesWithLods = 0;
+    size_t lodLevels = 0;
+    for (Mesh& mesh : mapData.meshes) {
+        verticesBefore += mesh.vertices.size();
+        if (optimize) {
+            optimizeStats.add(optimizeMesh(mesh, *storage));
+        } else if (!mesh.isIndexed()) {
+            weldMesh(mesh, *storage);
+        }
+        // After optimizing, so the levels index the final vertex order
+        if (lods) {
+            size_t levels = generateMeshLods(mesh, *storage);
+            meshesWithLods += levels > 0 ? 1 : 0;
+            lodLevels += levels;
+        }
+        verticesAfter += mesh.vertices.size();
+    }
+    if (optimize) {
+        mapData.flags |= TMAP_FLAG_OPTIMIZED;
+    }
+    
+    bool saved = saveTMAP(outputPath, mapData);
+    Logger::flush(); // Keep the summary below anything the loader and writer logged
+    if (!saved) {
+        std::cerr << "tmap_convert: Failed to write " << outputPath << std::endl;
+        return 1;
+    }
+    
+    std::cout << "tmap_convert: " << inputPath << " (v" << mapData.version << ", "
+              << std::filesystem::file_size(inputPath) << " bytes) -> " << outputPath << " (v2, "
+              << std::filesystem::file_size(outputPath) << " bytes)" << std::endl;
+    std::cout << "tmap_convert: " << mapData.meshes.size() << " meshes, vertices "
+              << verticesBefore << " -> " << verticesAfter << std::endl;
+    if (optimize) {
+        std::cout << "tmap_convert: ACMR (" << VERTEX_CACHE_SIZE << " entry FIFO) " << optimizeStats.acmrBefore()
+                  << " -> " << optimizeStats.acmrAfter() << " over " << optimizeStats.triangles << " triangles, "
+                  << optimizeStats.overdrawOrdered << " of " << optimizeStats.meshes << " meshes overdraw ordered" << std::endl;
+    }
+    if (lods) {
+        std::cout << "tmap_convert: " << lodLevels << " levels of detail on " << meshesWithLods << " meshes" << std::endl;
+    }
+    return 0;
+}